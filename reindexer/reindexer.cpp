@@ -12,6 +12,8 @@
 
 #include <algorithm>
 #include <array>
+#include <cerrno>
+#include <chrono>
 #include <cmath>
 #include <cstdint>
 #include <cstdlib>
@@ -20,37 +22,58 @@
 #include <functional>
 #include <iomanip>
 #include <iostream>
-#include <map>
-#include <numeric>
-#include <regex>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
+#if defined(__unix__) || defined(__APPLE__)
+#define REINDEXER_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 using vec2 = std::array<float, 2>;
 using vec3 = std::array<float, 3>;
-using flat = std::vector<float>;
-using multi_index = std::vector<std::uint16_t>;
-using face = std::vector<multi_index>;
+using multi_index = std::array<std::uint16_t, 3>;
 
 
 
 
 /**
- *  Mesh container.
+ *  Mesh container. Faces are stored flat - corners of all
+ *  faces are kept in one array, every face is described by
+ *  position of its first corner and by its width (number of
+ *  used indices in its corners: 1 - "v", 2 - "v//vn",
+ *  3 - "v/vt/vn", unused indices are zero).
  */
 typedef struct {
     std::vector<vec3> verts;
     std::vector<vec2> uvs;
     std::vector<vec3> normals;
-    std::vector<face> faces;
-    std::vector<multi_index> multi_indices;
+    std::vector<multi_index> corners;
+    std::vector<std::uint32_t> face_offsets;
+    std::vector<std::uint8_t> face_widths;
     std::vector<std::uint16_t> indices;
 } mesh;
 
 
 
 
+/**
+ *  Position behind the last corner of a given face.
+ */
+inline std::size_t face_end (const mesh &m, std::size_t f) {
+    return
+        f + 1 < m.face_offsets.size() ?
+            m.face_offsets[f + 1] : m.corners.size();
+}
+
+
+
+
 /**
  *  Equality test with allowed error.
  */
@@ -63,119 +86,167 @@ inline bool close_to (T a, T b) {
 
 
 /**
- *  Vector concatenator ( vector<T>  <-  vector<vector<T>> ).
+ *  Allocate space in a given vector.
  */
-template <typename T>
-void vector_flatten (
-    std::vector<T> &out,
-    const std::vector<std::vector<T>> &in
-) {
-    out.clear();
-    out.reserve(std::accumulate(
-        in.begin(), in.end(), 0,
-        [] (
-            const typename std::vector<T>::size_type &acc,
-            const std::vector<T> &el
-        ) -> typename std::vector<T>::size_type {
-            return acc + el.size();
-        }
-    ));
-    std::for_each(in.begin(), in.end(), [&] (const std::vector<T> &vec_el) {
-        std::for_each(vec_el.begin(), vec_el.end(), [&] (const T &el) {
-            out.push_back(el);
-        });
-    });
+template <typename V>
+V& vector_allocate (V &c, std::size_t len) {
+    c.clear(); c.reserve(len);
+    c.insert(c.end(), len, { 0 });
+    c.shrink_to_fit();
+    return c;
 }
 
 
 
 
 /**
- *  Create std::vector from any iterable.
+ *  Character classes of the OBJ scanner ("\s", "\d" and "\w").
  */
-template <
-    template <class, std::size_t...> class I,
-    class T,
-    std::size_t... Rest
->
-inline std::vector<T> make_vector (const I<T, Rest...> &i) {
-    return { i.begin(), i.end() };
+inline bool is_space (char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+
+inline bool is_digit (char c) {
+    return static_cast<unsigned char>(c - '0') < 10;
+}
+
+
+inline bool is_word (char c) {
+    return
+        is_digit(c) || c == '_' ||
+        static_cast<unsigned char>((c | 0x20) - 'a') < 26;
 }
 
 
 
 
 /**
- *  Allocate space in a given vector.
+ *  Number token ("-?[0-9]+(\.[0-9]+)?"). Significant digits are
+ *  accumulated in "digits" ("exact" is cleared if there are too
+ *  many of them), "scale" is the number of fractional digits and
+ *  "whole" is the (saturated) integer part.
  */
-template <typename V>
-V& vector_allocate (V &c, std::size_t len) {
-    c.clear(); c.reserve(len);
-    c.insert(c.end(), len, { 0 });
-    c.shrink_to_fit();
-    return c;
+struct number {
+    const char *begin, *end;
+    std::uint64_t digits, whole;
+    std::size_t scale;
+    bool negative, exact;
+};
+
+
+
+
+/**
+ *  Scan a number token at "p" (no allocation, no backtracking).
+ */
+inline bool scan_number (const char *p, const char *end, number &n) {
+    static const std::uint64_t max_digits { 1000000000000000000ull };
+
+    n.begin = p;
+    n.digits = 0;  n.whole = 0;  n.scale = 0;
+    n.negative = false;  n.exact = true;
+
+    if (p != end && *p == '-') { n.negative = true;  p++; }
+    if (p == end || !is_digit(*p)) { return false; }
+
+    for (;  p != end && is_digit(*p);  p++) {
+        if (n.digits < max_digits) {
+            n.digits = n.digits * 10 + static_cast<unsigned>(*p - '0');
+        } else { n.exact = false; }
+    }
+    n.whole = n.exact ? n.digits : max_digits;
+
+    if (p + 1 < end && *p == '.' && is_digit(p[1])) {
+        for (p++;  p != end && is_digit(*p);  p++) {
+            if (n.digits < max_digits) {
+                n.digits = n.digits * 10 + static_cast<unsigned>(*p - '0');
+                n.scale++;
+            } else { n.exact = false; }
+        }
+    }
+
+    n.end = p;
+    return true;
 }
 
 
 
 
 /**
- *  Construct regex matching "n" numbers (floats or ints).
+ *  Float value of a number token (same result as "std::stof").
+ *  Short tokens take the exact path - both the significand
+ *  (< 2^24) and the power of ten (<= 10^10) are representable
+ *  in a float, so a single division is correctly rounded.
+ *  Anything else is handed over to "strtof".
  */
-std::string construct_number_regex_string (
-    std::size_t n,
-    const std::string &sep_regex,
-    const std::string &end_regex
-) {
-    static const std::string number_regex { "(-?[0-9]+(\\.?[0-9]+)?)" };
-    std::string full_regex;
+inline bool number_to_float (const number &n, float &out) {
+    static const float pow10[] {
+        1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f,
+        1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+    };
+    static const std::size_t max_token { 64 };
 
-    for (std::size_t i = 0;  i < n;  i++) {
-        full_regex += number_regex;
-        if (i < n-1) { full_regex += sep_regex; }
+    if (n.exact  &&  n.digits <= (1u << 24)  &&  n.scale <= 10) {
+        out = static_cast<float>(n.digits) / pow10[n.scale];
+        if (n.negative) { out = -out; }
+        return true;
     }
-    full_regex += end_regex;
 
-    return full_regex;
+    const std::size_t length = static_cast<std::size_t>(n.end - n.begin);
+    if (length >= max_token) { return false; }
+    char token[max_token];
+    std::memcpy(token, n.begin, length);
+    token[length] = '\0';
+    errno = 0;
+    out = std::strtof(token, nullptr);
+    return errno != ERANGE;
+}
+
+
+
+
+/**
+ *  Index value of a number token (fraction truncated, negative
+ *  and too large values wrap around as in double -> uint16).
+ */
+inline std::uint16_t number_to_index (const number &n) {
+    const std::int64_t whole = static_cast<std::int64_t>(n.whole);
+    return static_cast<std::uint16_t>(n.negative ? -whole : whole);
 }
 
 
 
 
 /**
- *  Try to parse N values of T in a line and push it back to "vecs" vector.
+ *  Try to parse N values of T (separated by optional whitespace,
+ *  anything behind them is ignored) and push it back to "vecs".
  */
 template <typename T, std::size_t N>
 std::size_t try_parse_vec (
     std::vector<std::array<T, N>> &vecs,
-    const std::string &strbuf
+    const char *p, const char *end
 ) {
-    static const std::regex vec_regex {
-        construct_number_regex_string(N, "\\s*", ".*")
-    };
-    std::smatch match;
     std::array<T, N> out;
-
-    if (std::regex_match(strbuf, match, vec_regex)) {
-        if (match.size() == N*2+1) {
-            try {
-                for (std::size_t i = 1;  i < match.size();  i += 2) {
-                    T val = std::stof(match[i].str());
-                    // convert e.g. "0.999999" to "1.0"
-                    if (close_to(val, std::round(val))) {
-                        val = std::round(val);
-                    }
-                    // get rid of "-0.0"
-                    if (val == 0) { val = std::fabs(val); }
-                    out[(i-1)/2] = val;
-                }
-            } catch (...) { return 0; }
-            vecs.push_back(out);
-            return 1;
+    number n;
+
+    for (std::size_t i = 0;  i < N;  i++) {
+        while (p != end && is_space(*p)) { p++; }
+        if (!scan_number(p, end, n)) { return 0; }
+        T val;
+        if (!number_to_float(n, val)) { return 0; }
+        // convert e.g. "0.999999" to "1.0"
+        if (close_to(val, std::round(val))) {
+            val = std::round(val);
         }
+        // get rid of "-0.0"
+        if (val == 0) { val = std::fabs(val); }
+        out[i] = val;
+        p = n.end;
     }
 
-    return 0;
+    vecs.push_back(out);
+    return 1;
 }
 
 
@@ -183,35 +254,43 @@ std::size_t try_parse_vec (
 
 /**
  *  Try to parse line with any number of index-vectors
- *  (a/b/c a/b/c ... or a//c a//c ... or a a ...).
+ *  (a/b/c a/b/c ... or a//c a//c ... or a a ...). Every
+ *  position of the line is tried, so (as with a regex search)
+ *  index-vectors of a different form are skipped.
  */
 template <const char sep1 = '\0', const char sep2 = '\0'>
 std::size_t try_parse_face (
-    std::vector<face> &faces,
-    const std::string &strbuf
+    mesh &m,
+    const char *p, const char *end
 ) {
     static const char sep[3] { sep1, sep2, '\0' };
-    static const size_t n { (3 - std::strlen(sep)) % 3 + 1 };
-    static const std::regex vec_regex {
-        construct_number_regex_string(n, sep, "")
-    };
-    face current_face;
-
-    std::for_each(
-        std::sregex_iterator(strbuf.begin(), strbuf.end(), vec_regex),
-        std::sregex_iterator(),
-        [&] (const std::smatch &match) {
-            multi_index mi;
-            if (match.size() == 1+2*n) {
-                for (std::size_t i = 1;  i < 1+2*n;  i += 2) {
-                    mi.push_back(std::stod(match[i].str()));
-                }
-                current_face.push_back(mi);
+    static const std::size_t n { (3 - std::strlen(sep)) % 3 + 1 };
+    const std::size_t first = m.corners.size();
+    multi_index mi {{ 0, 0, 0 }};
+    number num;
+
+    while (p != end) {
+        const char *q = p;
+        std::size_t i = 0;
+        for (;  i < n;  i++) {
+            if (i > 0) {
+                const char *s = sep;
+                for (;  *s != '\0' && q != end && *q == *s;  s++, q++);
+                if (*s != '\0') { break; }
             }
-    });
+            if (!scan_number(q, end, num)) { break; }
+            mi[i] = number_to_index(num);
+            q = num.end;
+        }
+        if (i == n) {
+            m.corners.push_back(mi);
+            p = q;
+        } else { p++; }
+    }
 
-    if (current_face.size() != 0) {
-        faces.push_back(current_face);
+    if (m.corners.size() != first) {
+        m.face_offsets.push_back(static_cast<std::uint32_t>(first));
+        m.face_widths.push_back(static_cast<std::uint8_t>(n));
         return 1;
     }
 
@@ -222,132 +301,457 @@ std::size_t try_parse_face (
 
 
 /**
- *  Parse input file line-by-line.
+ *  Keyword test (keywords are not null-terminated).
  */
-void parse_mesh (mesh &m, std::ifstream &file_input) {
-    const unsigned int max_line_size { 8192 };
-    std::array<char, max_line_size> buffer;
-    std::string strbuf;
-    std::regex line_regex { "^\\s*(\\w+)\\s*(.*)$" };
-    std::smatch match;
-
-    while (!file_input.eof()) {
-        file_input.getline(buffer.data(), max_line_size);
-        strbuf = buffer.data();
-        if (std::regex_match(strbuf, match, line_regex)) {
-            if (match.size() == 3) {
-                if (match[1].str() == "v") {
-                    try_parse_vec(m.verts, match[2].str());
-                } else if (match[1].str() == "vn") {
-                    try_parse_vec(m.normals, match[2].str());
-                } else if (match[1].str() == "vt") {
-                    try_parse_vec(m.uvs, match[2].str());
-                } else if (match[1].str() == "f") {
-                    // try to parse face with 'vertex/uv/normal' structure
-                    if (
-                        try_parse_face<'/'>(
-                            m.faces, match[2].str()
-                        ) == 0
-                    ) {
-                        // or try to parse face with 'vertex//normal' structure
-                        if (
-                            try_parse_face<'/', '/'>(
-                                m.faces, match[2].str()
-                            ) == 0
-                        ) {
-                            // or try to parse face with 'vertex' structure
-                            if (
-                                try_parse_face(
-                                    m.faces, match[2].str()
-                                ) == 0
-                            ) {
-                                std::cerr
-                                    << "Unrecognized face line."
-                                    << std::endl;
-                            }
-                        }
-                    }
-                } else {
-                    std::cerr
-                        << "Ignoring line starting with "
-                        << "\"" << match[1].str() << "\"."
-                        << std::endl;
-                }
+inline bool keyword_is (
+    const char *keyword, std::size_t length, const char *expected
+) {
+    return
+        length == std::strlen(expected)  &&
+        std::memcmp(keyword, expected, length) == 0;
+}
+
+
+
+
+/**
+ *  Parse a single line ("\r" of CRLF line endings is dropped).
+ */
+void parse_line (
+    mesh &m,
+    const char *p, const char *end,
+    std::ostream &log
+) {
+    if (p != end && *(end - 1) == '\r') { end--; }
+
+    while (p != end && is_space(*p)) { p++; }
+    const char *keyword = p;
+    while (p != end && is_word(*p)) { p++; }
+    const std::size_t length = static_cast<std::size_t>(p - keyword);
+    while (p != end && is_space(*p)) { p++; }
+
+    if (length == 0) {
+        log
+            << "Ignoring comment, empty or some garbage line."
+            << std::endl;
+    } else if (keyword_is(keyword, length, "v")) {
+        try_parse_vec(m.verts, p, end);
+    } else if (keyword_is(keyword, length, "vn")) {
+        try_parse_vec(m.normals, p, end);
+    } else if (keyword_is(keyword, length, "vt")) {
+        try_parse_vec(m.uvs, p, end);
+    } else if (keyword_is(keyword, length, "f")) {
+        // try to parse face with 'vertex/uv/normal' structure
+        // or with 'vertex//normal' structure or with 'vertex' structure
+        if (
+            try_parse_face<'/'>(m, p, end) == 0  &&
+            try_parse_face<'/', '/'>(m, p, end) == 0  &&
+            try_parse_face(m, p, end) == 0
+        ) {
+            log << "Unrecognized face line." << std::endl;
+        }
+    } else {
+        log << "Ignoring line starting with \"";
+        log.write(keyword, static_cast<std::streamsize>(length));
+        log << "\"." << std::endl;
+    }
+}
+
+
+
+
+/**
+ *  Parse input buffer line-by-line (single pass, no regular
+ *  expressions and no copies of the lines - the aim is to be
+ *  limited by memory bandwidth rather than by the tokenizer,
+ *  i.e. hundreds of MB/s on a single core).
+ */
+void parse_lines (
+    mesh &m,
+    const char *begin, const char *end,
+    std::ostream &log
+) {
+    for (const char *line = begin;  ;  ) {
+        const char *eol = line == end ? nullptr :
+            static_cast<const char*>(std::memchr(
+                line, '\n', static_cast<std::size_t>(end - line)
+            ));
+        parse_line(m, line, eol != nullptr ? eol : end, log);
+        if (eol == nullptr) { break; }
+        line = eol + 1;
+    }
+}
+
+
+
+
+/**
+ *  Move "member" arrays of all parts to their places in "out"
+ *  (given by prefix sums of their sizes), one thread per part.
+ *  Returns the places.
+ */
+template <typename T>
+std::vector<std::size_t> merge_parts (
+    std::vector<T> &out,
+    std::vector<mesh> &parts,
+    std::vector<T> mesh::*member
+) {
+    std::vector<std::size_t> offsets { 0 };
+    for (const mesh &part : parts) {
+        offsets.push_back(offsets.back() + (part.*member).size());
+    }
+    out.resize(offsets.back());
+
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0;  i < parts.size();  i++) {
+        workers.emplace_back([&, i] () {
+            std::move(
+                (parts[i].*member).begin(), (parts[i].*member).end(),
+                out.begin() + static_cast<std::ptrdiff_t>(offsets[i])
+            );
+            std::vector<T>().swap(parts[i].*member);
+        });
+    }
+    for (std::thread &worker : workers) { worker.join(); }
+
+    return offsets;
+}
+
+
+
+
+/**
+ *  Parse input buffer (using up to "max_threads" threads).
+ *
+ *  Buffer is split into chunks ending at newlines, which are
+ *  parsed in parallel into separate meshes and merged in order
+ *  (OBJ indices are absolute, so data of every chunk is simply
+ *  moved behind data of previous chunks, only face offsets
+ *  are shifted by the number of preceding corners). Diagnostics are
+ *  collected per chunk and written out in order too - result
+ *  is the same as that of the serial parse.
+ */
+void parse_mesh (
+    mesh &m,
+    const char *begin, const char *end,
+    std::ostream &log,
+    std::size_t max_threads = 1
+) {
+    static const std::size_t min_chunk_size { 1 << 20 };
+    const std::size_t length = static_cast<std::size_t>(end - begin);
+    const std::size_t count = std::max<std::size_t>(1, std::min(
+        max_threads, length / min_chunk_size
+    ));
+
+    // beginnings of chunks (every chunk but last ends at a newline)
+    std::vector<const char*> chunks { begin };
+    for (std::size_t i = 1;  i < count;  i++) {
+        const char *from = std::max(begin + length / count * i, chunks.back());
+        const char *eol = from == end ? nullptr :
+            static_cast<const char*>(std::memchr(
+                from, '\n', static_cast<std::size_t>(end - from)
+            ));
+        if (eol == nullptr) { break; }
+        chunks.push_back(eol + 1);
+    }
+
+    if (chunks.size() == 1) {
+        parse_lines(m, begin, end, log);
+    } else {
+        std::vector<mesh> parts(chunks.size());
+        std::vector<std::string> logs(parts.size());
+        std::vector<std::thread> workers;
+
+        for (std::size_t i = 0;  i < parts.size();  i++) {
+            workers.emplace_back([&, i] () {
+                std::ostringstream part_log;
+                parse_lines(
+                    parts[i], chunks[i],
+                    i + 1 < chunks.size() ? chunks[i+1] - 1 : end,
+                    part_log
+                );
+                logs[i] = part_log.str();
+            });
+        }
+        for (std::thread &worker : workers) { worker.join(); }
+
+        for (const std::string &part_log : logs) { log << part_log; }
+        log.flush();
+
+        merge_parts(m.verts, parts, &mesh::verts);
+        merge_parts(m.uvs, parts, &mesh::uvs);
+        merge_parts(m.normals, parts, &mesh::normals);
+        merge_parts(m.face_widths, parts, &mesh::face_widths);
+        const std::vector<std::size_t>
+            corners { merge_parts(m.corners, parts, &mesh::corners) },
+            faces { merge_parts(m.face_offsets, parts, &mesh::face_offsets) };
+        for (std::size_t i = 1;  i < parts.size();  i++) {
+            for (std::size_t f = faces[i];  f < faces[i+1];  f++) {
+                m.face_offsets[f] += static_cast<std::uint32_t>(corners[i]);
             }
-        } else {
-            std::cerr
-                << "Ignoring comment, empty or some garbage line."
-                << std::endl;
         }
     }
+}
+
 
-    // "flatten" faces to indices vector.
-    vector_flatten(m.multi_indices, m.faces);
+
+
+/**
+ *  Read whole input file into memory.
+ */
+void read_file (std::vector<char> &contents, std::ifstream &file_input) {
+    file_input.seekg(0, std::ios::end);
+    const std::streamoff length = file_input.tellg();
+    if (length < 0) {
+        // not seekable (e.g. a pipe)
+        file_input.clear();
+        contents.assign(
+            std::istreambuf_iterator<char>(file_input),
+            std::istreambuf_iterator<char>()
+        );
+        return;
+    }
+    file_input.seekg(0, std::ios::beg);
+    contents.resize(static_cast<std::size_t>(length));
+    file_input.read(contents.data(), static_cast<std::streamsize>(
+        contents.size()
+    ));
+    contents.resize(static_cast<std::size_t>(file_input.gcount()));
 }
 
 
 
 
 /**
- *  Index <- multi-index.
+ *  Read-only view of the whole input file. Regular files are
+ *  memory mapped (with a hint for sequential access), so the
+ *  parser runs directly over the page cache. Otherwise (or if
+ *  mapping fails) the file is read into memory.
  */
-void reindex (mesh &out, const mesh &in) {
-    std::map<flat, std::uint16_t> dict;
-    std::uint16_t current_index { 0 };
-
-    std::for_each (
-        in.multi_indices.begin(),
-        in.multi_indices.end(),
-        [&] (const multi_index &mi) {
-            vec3 const *current_vertex = nullptr;
-            vec3 const *current_normal = nullptr;
-            vec2 const *current_uv = nullptr;
-            flat current_flat;
-
-            current_vertex = &in.verts[mi[0] - 1];
-            if (mi.size() == 1) {
-                vector_flatten(current_flat, [&] () -> std::vector<flat> {
-                    return {
-                        make_vector(*current_vertex),
-                    };
-                }());
-            } else if (mi.size() == 2) {
-                current_normal = &in.normals[mi[1] - 1];
-                vector_flatten(current_flat, [&] () -> std::vector<flat> {
-                    return {
-                        make_vector(*current_vertex),
-                        make_vector(*current_normal)
-                    };
-                }());
-            } else {
-                current_uv = &in.uvs[mi[1] - 1];
-                current_normal = &in.normals[mi[2] - 1];
-                vector_flatten(current_flat, [&] () -> std::vector<flat> {
-                    return {
-                        make_vector(*current_vertex),
-                        make_vector(*current_uv),
-                        make_vector(*current_normal)
-                    };
-                }());
+class input_file {
+
+    std::vector<char> contents;
+    void *region { nullptr };
+    const char *data { nullptr };
+    std::size_t length { 0 };
+
+
+public:
+
+    input_file () = default;
+    input_file (const input_file &) = delete;
+    input_file& operator= (const input_file &) = delete;
+
+
+    ~input_file () {
+#if defined(REINDEXER_MMAP)
+        if (this->region != nullptr) { munmap(this->region, this->length); }
+#endif
+    }
+
+
+    bool open (const char *path) {
+#if defined(REINDEXER_MMAP)
+        const int fd = ::open(path, O_RDONLY);
+        if (fd == -1) { return false; }
+        struct stat info;
+        if (
+            fstat(fd, &info) == 0  &&  S_ISREG(info.st_mode)  &&
+            info.st_size > 0
+        ) {
+            const std::size_t size = static_cast<std::size_t>(info.st_size);
+            void *region = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (region != MAP_FAILED) {
+                madvise(region, size, MADV_SEQUENTIAL);
+                close(fd);
+                this->region = region;
+                this->data = static_cast<const char*>(region);
+                this->length = size;
+                return true;
             }
+        }
+        close(fd);
+#endif
+        std::ifstream file_input(path, std::ios::in | std::ios::binary);
+        if (!file_input) { return false; }
+        read_file(this->contents, file_input);
+        this->data = this->contents.data();
+        this->length = this->contents.size();
+        return true;
+    }
 
-            auto current = dict.find(current_flat);
 
-            if (current == dict.end()) {
-                dict.insert({current_flat, current_index});
-                out.verts.push_back(*current_vertex);
-                if (current_uv != nullptr) {
-                    out.uvs.push_back(*current_uv);
-                }
-                if (current_normal != nullptr) {
-                    out.normals.push_back(*current_normal);
-                }
-                out.indices.push_back(current_index);
-                current_index += 1;
-            } else {
-                out.indices.push_back(std::get<1>(*current));
+    inline const char* begin () const { return this->data; }
+    inline const char* end () const { return this->data + this->length; }
+    inline std::size_t size () const { return this->length; }
+
+};
+
+
+
+
+/**
+ *  Deduplication key - attribute bits of a vertex (position,
+ *  uv, normal, unused words are zero) and number of used words.
+ *  Parsed values are never "-0.0" or NaN, so equal bits mean
+ *  equal values.
+ */
+struct vertex_key {
+    std::array<std::uint32_t, 8> bits;
+    std::uint32_t size;
+
+    inline bool operator== (const vertex_key &k) const {
+        return this->size == k.size && this->bits == k.bits;
+    }
+};
+
+
+
+
+/**
+ *  Open-addressing (linear probing) hash table assigning
+ *  consecutive indices to distinct vertex keys. Keys are kept
+ *  densely in insertion order (position of a key is its index),
+ *  slots hold positions of keys plus one (zero means empty).
+ */
+class vertex_table {
+
+    std::vector<vertex_key> keys;
+    std::vector<std::uint32_t> hashes;
+    std::vector<std::uint32_t> slots;
+    std::size_t mask;
+
+
+    static std::uint32_t hash (const vertex_key &k) {
+        std::uint64_t h { k.size };
+        for (std::uint32_t word : k.bits) {
+            h = (h ^ word) * 0x9e3779b97f4a7c15ull;
+            h ^= h >> 29;
+        }
+        return static_cast<std::uint32_t>(h ^ (h >> 32));
+    }
+
+
+    void grow () {
+        std::vector<std::uint32_t>(this->slots.size() * 2, 0).swap(
+            this->slots
+        );
+        this->mask = this->slots.size() - 1;
+        for (std::size_t i = 0;  i < this->keys.size();  i++) {
+            std::size_t s = this->hashes[i] & this->mask;
+            while (this->slots[s] != 0) { s = (s + 1) & this->mask; }
+            this->slots[s] = static_cast<std::uint32_t>(i + 1);
+        }
+    }
+
+
+public:
+
+    /**
+     *  Create table for a given (expected) number of keys.
+     */
+    explicit vertex_table (std::size_t expected) {
+        std::size_t capacity { 16 };
+        while (capacity < 2 * expected) { capacity *= 2; }
+        this->slots.assign(capacity, 0);
+        this->mask = capacity - 1;
+        this->keys.reserve(expected);
+        this->hashes.reserve(expected);
+    }
+
+
+    /**
+     *  Find index of a given key or add it (as the next index).
+     *  Returns true if the key was added.
+     */
+    bool insert (const vertex_key &k, std::uint16_t &index) {
+        const std::uint32_t h = hash(k);
+        std::size_t s = h & this->mask;
+
+        for (;  this->slots[s] != 0;  s = (s + 1) & this->mask) {
+            const std::size_t i = this->slots[s] - 1;
+            if (this->hashes[i] == h && this->keys[i] == k) {
+                index = static_cast<std::uint16_t>(i);
+                return false;
             }
-    });
+        }
+
+        index = static_cast<std::uint16_t>(this->keys.size());
+        this->keys.push_back(k);
+        this->hashes.push_back(h);
+        this->slots[s] = static_cast<std::uint32_t>(this->keys.size());
+        if (2 * this->keys.size() > this->slots.size()) { this->grow(); }
+        return true;
+    }
+
+};
+
+
+
+
+/**
+ *  Index <- multi-index (single corner of a face of a given width).
+ */
+inline void reindex_corner (
+    mesh &out, const mesh &in, vertex_table &dict,
+    const multi_index &mi, std::size_t width
+) {
+    const vec3 &current_vertex = in.verts[mi[0] - 1];
+    const vec2 *current_uv = nullptr;
+    const vec3 *current_normal = nullptr;
+    vertex_key key;
+    std::uint16_t index;
+
+    if (width == 2) {
+        current_normal = &in.normals[mi[1] - 1];
+    } else if (width > 2) {
+        current_uv = &in.uvs[mi[1] - 1];
+        current_normal = &in.normals[mi[2] - 1];
+    }
+
+    key.bits.fill(0);
+    key.size = 0;
+    const auto append = [&key] (const float *values, std::size_t n) {
+        std::memcpy(&key.bits[key.size], values, n * sizeof(float));
+        key.size += static_cast<std::uint32_t>(n);
+    };
+    append(current_vertex.data(), current_vertex.size());
+    if (current_uv != nullptr) {
+        append(current_uv->data(), current_uv->size());
+    }
+    if (current_normal != nullptr) {
+        append(current_normal->data(), current_normal->size());
+    }
+
+    if (dict.insert(key, index)) {
+        out.verts.push_back(current_vertex);
+        if (current_uv != nullptr) {
+            out.uvs.push_back(*current_uv);
+        }
+        if (current_normal != nullptr) {
+            out.normals.push_back(*current_normal);
+        }
+    }
+    out.indices.push_back(index);
+}
+
+
+
+
+/**
+ *  Index <- multi-index. Vertices with equal attributes
+ *  (not only equal multi-indices) share an index.
+ */
+void reindex (mesh &out, const mesh &in) {
+    vertex_table dict(std::min<std::size_t>(in.corners.size(), 1 << 16));
+
+    out.indices.reserve(in.corners.size());
+
+    for (std::size_t f = 0;  f < in.face_offsets.size();  f++) {
+        for (std::size_t c = in.face_offsets[f];  c < face_end(in, f);  c++) {
+            reindex_corner(out, in, dict, in.corners[c], in.face_widths[f]);
+        }
+    }
 }
 
 
@@ -419,18 +823,24 @@ inline std::string vec_to_string (const V &v) {
 
 
 
+/**
+ *  Corner serializer ("v", "v//vn" or "v/vt/vn").
+ */
+void write_corner (std::ostream &os, const multi_index &mi, std::size_t width) {
+    os << mi[0];
+    for (std::size_t i = 1;  i < width;  i++) {
+        os << (width == 2 ? "//" : "/") << mi[i];
+    }
+}
+
+
+
+
 /**
  *  Mesh serializer.
  */
 std::ostream& operator<< (std::ostream &os, const mesh &m) {
-    auto multi_index_to_string = [] (const multi_index &mi) -> std::string {
-        if (mi.size() == 2) {
-            return iterable_to_string(mi, "", "", "//", "");
-        }
-        return iterable_to_string(mi, "", "", "/", "");
-    };
-
-    return os
+    os
         << higher_iterable_to_string<vec3>(
             m.verts, "", "v ", vec_to_string<vec3>, "\n", "\n"
         )
@@ -439,64 +849,112 @@ std::ostream& operator<< (std::ostream &os, const mesh &m) {
         )
         << higher_iterable_to_string<vec3>(
             m.normals, "", "vn ", vec_to_string<vec3>, "\n", "\n"
-        )
-        << higher_iterable_to_string<face>(
-            m.faces, "", "f ",
-            [&] (const face &f) -> std::string {
-                return higher_iterable_to_string<multi_index>(
-                    f, "", "", multi_index_to_string, " ", ""
-                );
-            }, "\n", "\n"
-        )
-        << higher_iterable_to_string<multi_index>(
-            m.multi_indices, "mi ", "", multi_index_to_string, " ", "\n"
-        )
-        << iterable_to_string(m.indices, "i ", "", " ", "\n");
+        );
+
+    // faces (one per line) ...
+    for (std::size_t f = 0;  f < m.face_offsets.size();  f++) {
+        os << "f ";
+        for (std::size_t c = m.face_offsets[f];  c < face_end(m, f);  c++) {
+            if (c != m.face_offsets[f]) { os << " "; }
+            write_corner(os, m.corners[c], m.face_widths[f]);
+        }
+        os << "\n";
+    }
+
+    // ... and all their corners in one line
+    if (m.corners.size() > 0) {
+        os << "mi ";
+        for (std::size_t f = 0;  f < m.face_offsets.size();  f++) {
+            for (std::size_t c = m.face_offsets[f];  c < face_end(m, f);  c++) {
+                if (c != 0) { os << " "; }
+                write_corner(os, m.corners[c], m.face_widths[f]);
+            }
+        }
+        os << "\n";
+    }
+
+    return os << iterable_to_string(m.indices, "i ", "", " ", "\n");
 }
 
 
 
 
 /**
- *  Serialize mesh to binary format.
+ *  Serialize mesh to binary format. Size of the file is known up
+ *  front, so (where possible) its blocks are allocated at once and
+ *  all sections are copied into a memory mapped region, otherwise
+ *  (e.g. no "posix_fallocate" support) they are written through
+ *  a stream.
  */
-void write_bin_mesh (std::ofstream &file_output, mesh &m) {
+bool write_bin_mesh (const char *path, const mesh &m) {
     static const char magic_string[4] { 'O', 'o', 'O', 'o' };
-    std::uint32_t
-        uint32_s = sizeof(std::uint32_t),
-        vec3_s = sizeof(vec3),
-        vec2_s = sizeof(vec2),
-        ushort_s = sizeof(std::uint16_t),
-        verts_length = static_cast<std::uint32_t>(m.verts.size()),
-        uvs_length = static_cast<std::uint32_t>(m.uvs.size()),
-        normals_length = static_cast<std::uint32_t>(m.normals.size()),
-        indices_length = static_cast<std::uint32_t>(m.indices.size());
-
-    file_output
-        .write(magic_string, 4)
-        .write(reinterpret_cast<const char*>(&vec3_s), uint32_s)
-        .write(reinterpret_cast<const char*>(&vec2_s), uint32_s)
-        .write(reinterpret_cast<const char*>(&ushort_s), uint32_s)
-        .write(reinterpret_cast<const char*>(&verts_length), uint32_s)
-        .write(reinterpret_cast<const char*>(&uvs_length), uint32_s)
-        .write(reinterpret_cast<const char*>(&normals_length), uint32_s)
-        .write(reinterpret_cast<const char*>(&indices_length), uint32_s)
-        .write(
+    const std::uint32_t header[7] {
+        sizeof(vec3),
+        sizeof(vec2),
+        sizeof(std::uint16_t),
+        static_cast<std::uint32_t>(m.verts.size()),
+        static_cast<std::uint32_t>(m.uvs.size()),
+        static_cast<std::uint32_t>(m.normals.size()),
+        static_cast<std::uint32_t>(m.indices.size())
+    };
+    const struct { const char *data; std::size_t size; } sections[] {
+        { magic_string, sizeof(magic_string) },
+        { reinterpret_cast<const char*>(header), sizeof(header) },
+        {
             reinterpret_cast<const char*>(m.verts.data()),
-            verts_length * vec3_s
-        )
-        .write(
+            m.verts.size() * sizeof(vec3)
+        },
+        {
             reinterpret_cast<const char*>(m.uvs.data()),
-            uvs_length * vec2_s
-        )
-        .write(
+            m.uvs.size() * sizeof(vec2)
+        },
+        {
             reinterpret_cast<const char*>(m.normals.data()),
-            normals_length * vec3_s
-        )
-        .write(
+            m.normals.size() * sizeof(vec3)
+        },
+        {
             reinterpret_cast<const char*>(m.indices.data()),
-            indices_length * ushort_s
+            m.indices.size() * sizeof(std::uint16_t)
+        }
+    };
+    std::size_t size { 0 };
+    for (const auto &section : sections) { size += section.size; }
+
+#if defined(REINDEXER_MMAP)
+    const int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (fd == -1) { return false; }
+    // reserve the blocks (not just a sparse size) - writes to a full
+    // disk through the mapping would raise SIGBUS instead of an error
+    if (posix_fallocate(fd, 0, static_cast<off_t>(size)) == 0) {
+        void *region = mmap(
+            nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0
         );
+        if (region != MAP_FAILED) {
+            char *out = static_cast<char*>(region);
+            for (const auto &section : sections) {
+                if (section.size > 0) {
+                    std::memcpy(out, section.data, section.size);
+                    out += section.size;
+                }
+            }
+            const bool synced = msync(region, size, MS_SYNC) == 0;
+            munmap(region, size);
+            return close(fd) == 0  &&  synced;
+        }
+    }
+    close(fd);
+#endif
+
+    std::ofstream file_output(
+        path, std::ios::out | std::ios::binary | std::ios::trunc
+    );
+    for (const auto &section : sections) {
+        file_output.write(
+            section.data, static_cast<std::streamsize>(section.size)
+        );
+    }
+    file_output.close();
+    return !file_output.fail();
 }
 
 
@@ -563,7 +1021,7 @@ void read_bin_mesh (mesh &m, std::ifstream &file_input) {
  */
 int main (int argc, char *argv[]) {
     std::ifstream file_input;
-    std::ofstream file_output;
+    input_file contents;
     mesh input, output, check;
 
     // check for input file ...
@@ -573,19 +1031,37 @@ int main (int argc, char *argv[]) {
     }
 
     // ... and try to open it
-    file_input.open(argv[1]);
-    if (!file_input) {
+    if (!contents.open(argv[1])) {
         std::cerr << "Cannot open input file: " << argv[1] << std::endl;
         std::exit(EXIT_FAILURE);
     }
 
     // parse input file
-    parse_mesh(input, file_input);
-
-    file_input.close();
+    const auto parse_start = std::chrono::steady_clock::now();
+    parse_mesh(
+        input, contents.begin(), contents.end(), std::cerr,
+        std::max(1u, std::thread::hardware_concurrency())
+    );
+    const std::chrono::duration<double> parse_time {
+        std::chrono::steady_clock::now() - parse_start
+    };
+    std::cerr
+        << "Parsed " << contents.size() << " bytes in "
+        << parse_time.count() * 1e3 << " ms ("
+        << contents.size() / 1e6 / parse_time.count() << " MB/s)."
+        << std::endl;
 
     // ...
+    const auto reindex_start = std::chrono::steady_clock::now();
     reindex(output, input);
+    const std::chrono::duration<double> reindex_time {
+        std::chrono::steady_clock::now() - reindex_start
+    };
+    std::cerr
+        << "Reindexed " << input.corners.size() << " corners to "
+        << output.verts.size() << " vertices in "
+        << reindex_time.count() * 1e3 << " ms."
+        << std::endl;
 
     // print-out this stuff
     std::cout
@@ -596,21 +1072,12 @@ int main (int argc, char *argv[]) {
 
     // check for output file ...
     if (argc == 3) {
-        // ... and try to open it
-        file_output.open(
-            argv[2],
-            std::ios::out | std::ios::binary | std::ios::trunc
-        );
-        if (!file_output) {
+        // ... and try to write it
+        if (!write_bin_mesh(argv[2], output)) {
             std::cerr << "Cannot open output file: " << argv[2] << std::endl;
             std::exit(EXIT_FAILURE);
         }
 
-        // ...
-        write_bin_mesh(file_output, output);
-
-        file_output.close();
-
         // check what you did there...
         file_input.open(
             argv[2],
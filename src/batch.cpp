@@ -12,12 +12,42 @@
 
 #include "batch.hpp"
 #include "shader.hpp"
+#include "m3d_kernels.hpp"
 
 namespace machina {
 
 
 
 
+/**
+ *  Upload vertex attribute array to the bound GL_ARRAY_BUFFER
+ *  and describe it ("size" components of "type" per element).
+ */
+template <typename T>
+inline void upload_attribute (
+    const std::vector<T> &data, GLenum usage, GLuint index,
+    GLint size, GLenum type, GLboolean normalized
+) {
+    glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(T), data.data(), usage);
+    glEnableVertexAttribArray(index);
+    glVertexAttribPointer(index, size, type, normalized, sizeof(T), 0);
+}
+
+
+
+
+/**
+ *  Compute bounds of given vertex positions.
+ */
+void Batch::compute_bounds (const std::vector<vec3> &verts) {
+    this->aabb = m3d::GAABB<GLfloat>(verts);
+    this->sphere = m3d::GSphere<GLfloat>(verts);
+    this->obb = m3d::GOBB<GLfloat>(verts);
+}
+
+
+
+
 /**
  *  VertexColorBatch initialization.
  */
@@ -50,15 +80,18 @@ VertexColorBatch::~VertexColorBatch () {
 
 
 /**
- *  ...
+ *  Upload vertices with colors.
  */
 VertexColorBatch& VertexColorBatch::prepare (
     GLenum draw_mode,
     const std::vector<vec3> &verts,
-    const std::vector<vec4> &colors
+    const std::vector<vec4> &colors,
+    bool packed
 ) {
     this->draw_mode = draw_mode;
     this->verts_length = verts.size();
+    this->packed = packed;
+    this->compute_bounds(verts);
 
     // VAO
     glGenVertexArrays(1, &this->vertex_array_object);
@@ -67,32 +100,26 @@ VertexColorBatch& VertexColorBatch::prepare (
     // vertex positions
     glGenBuffers(1, &this->vertex_buffer);
     glBindBuffer(GL_ARRAY_BUFFER, this->vertex_buffer);
-    glBufferData(
-        GL_ARRAY_BUFFER,
-        verts.size() * sizeof(vec3),
-        verts.data(),
-        GL_DYNAMIC_DRAW
-    );
-    glEnableVertexAttribArray(Shader::attrib_index::vertex);
-    glVertexAttribPointer(
-        Shader::attrib_index::vertex,
-        3, GL_FLOAT, GL_FALSE, 0, 0
+    upload_attribute(
+        verts, GL_DYNAMIC_DRAW, Shader::attrib_index::vertex,
+        3, GL_FLOAT, GL_FALSE
     );
 
     // vertex colors
     glGenBuffers(1, &this->color_buffer);
     glBindBuffer(GL_ARRAY_BUFFER, this->color_buffer);
-    glBufferData(
-        GL_ARRAY_BUFFER,
-        colors.size() * sizeof(vec4),
-        colors.data(),
-        GL_DYNAMIC_DRAW
-    );
-    glEnableVertexAttribArray(Shader::attrib_index::color);
-    glVertexAttribPointer(
-        Shader::attrib_index::color,
-        4, GL_FLOAT, GL_FALSE, 0, 0
-    );
+    if (packed) {
+        std::vector<m3d::unorm8x4> c;
+        upload_attribute(
+            m3d::kernels::to_unorm8(c, colors), GL_DYNAMIC_DRAW,
+            Shader::attrib_index::color, 4, GL_UNSIGNED_BYTE, GL_TRUE
+        );
+    } else {
+        upload_attribute(
+            colors, GL_DYNAMIC_DRAW, Shader::attrib_index::color,
+            4, GL_FLOAT, GL_FALSE
+        );
+    }
 
     glBindVertexArray(0);
 
@@ -139,19 +166,22 @@ TriangleBatch::~TriangleBatch () {
 
 
 /**
- *  ...
+ *  Upload vertices, normals, uvs and indices.
  */
 TriangleBatch& TriangleBatch::prepare (
     const std::vector<vec3> &verts,
     const std::vector<vec3> &normals,
     const std::vector<vec2> &uvs,
-    const std::vector<GLushort> &indices
+    const std::vector<GLushort> &indices,
+    bool packed
 ) {
 
     this->length[Batch::buf_index::verts] = verts.size();
     this->length[Batch::buf_index::normals] = normals.size();
     this->length[Batch::buf_index::uvs] = uvs.size();
     this->length[Batch::buf_index::indices] = indices.size();
+    this->packed = packed;
+    this->compute_bounds(verts);
 
     // VAO -- generate and bind
     glGenVertexArrays(1, &this->vertex_array_object);
@@ -160,50 +190,55 @@ TriangleBatch& TriangleBatch::prepare (
     // generate VBOs
     glGenBuffers(this->buff_amount, this->buffer);
 
-    // vertex positions
+    // vertex positions (packed: relative to the bounding box)
     glBindBuffer(GL_ARRAY_BUFFER, this->buffer[Batch::buf_index::verts]);
-    glBufferData(
-        GL_ARRAY_BUFFER,
-        this->length[Batch::buf_index::verts] * sizeof(vec3),
-        verts.data(),
-        GL_STATIC_DRAW
-    );
-    glEnableVertexAttribArray(Shader::attrib_index::vertex);
-    glVertexAttribPointer(
-        Shader::attrib_index::vertex,
-        3, GL_FLOAT, GL_FALSE, 0, 0
-    );
+    if (packed  &&  !this->aabb.empty()) {
+        std::vector<m3d::unorm16x4> q;
+        upload_attribute(
+            m3d::kernels::quantize(q, verts, this->aabb.min, this->aabb.max),
+            GL_STATIC_DRAW, Shader::attrib_index::vertex,
+            3, GL_UNSIGNED_SHORT, GL_TRUE
+        );
+        this->decode = m3d::dequantization(this->aabb.min, this->aabb.max);
+    } else {
+        upload_attribute(
+            verts, GL_STATIC_DRAW, Shader::attrib_index::vertex,
+            3, GL_FLOAT, GL_FALSE
+        );
+    }
 
-    // vertex normals
+    // vertex normals (packed: octahedral)
     if (this->length[Batch::buf_index::normals] != 0) {
         glBindBuffer(GL_ARRAY_BUFFER, this->buffer[Batch::buf_index::normals]);
-        glBufferData(
-            GL_ARRAY_BUFFER,
-            this->length[Batch::buf_index::normals] * sizeof(vec3),
-            normals.data(),
-            GL_STATIC_DRAW
-        );
-        glEnableVertexAttribArray(Shader::attrib_index::normal);
-        glVertexAttribPointer(
-            Shader::attrib_index::normal,
-            3, GL_FLOAT, GL_FALSE, 0, 0
-        );
+        if (packed) {
+            std::vector<m3d::snorm16x2> e;
+            upload_attribute(
+                m3d::kernels::to_octahedral(e, normals), GL_STATIC_DRAW,
+                Shader::attrib_index::normal, 2, GL_SHORT, GL_TRUE
+            );
+        } else {
+            upload_attribute(
+                normals, GL_STATIC_DRAW, Shader::attrib_index::normal,
+                3, GL_FLOAT, GL_FALSE
+            );
+        }
     }
 
-    // vertex uvs
+    // vertex uvs (packed: half floats)
     if (this->length[Batch::buf_index::uvs] != 0) {
         glBindBuffer(GL_ARRAY_BUFFER, this->buffer[Batch::buf_index::uvs]);
-        glBufferData(
-            GL_ARRAY_BUFFER,
-            this->length[Batch::buf_index::uvs] * sizeof(vec2),
-            uvs.data(),
-            GL_STATIC_DRAW
-        );
-        glEnableVertexAttribArray(Shader::attrib_index::uv);
-        glVertexAttribPointer(
-            Shader::attrib_index::uv,
-            2, GL_FLOAT, GL_FALSE, 0, 0
-        );
+        if (packed) {
+            std::vector<m3d::half2> h;
+            upload_attribute(
+                m3d::kernels::to_half(h, uvs), GL_STATIC_DRAW,
+                Shader::attrib_index::uv, 2, GL_HALF_FLOAT, GL_FALSE
+            );
+        } else {
+            upload_attribute(
+                uvs, GL_STATIC_DRAW, Shader::attrib_index::uv,
+                2, GL_FLOAT, GL_FALSE
+            );
+        }
     }
 
     // indices
@@ -11,6 +11,8 @@
 #define __BATCH_HPP_ 1
 
 #include "m3d.hpp"
+#include "gbounds.hpp"
+#include "m3d_codec.hpp"
 #include <vector>
 
 namespace machina {
@@ -23,6 +25,34 @@ namespace machina {
  */
 class Batch {
 
+    using vec3 = m3d::GVector3<GLfloat>;
+
+
+protected:
+
+    /**
+     *  Bounds of vertex positions (model space).
+     */
+    m3d::GAABB<GLfloat> aabb;
+    m3d::GSphere<GLfloat> sphere;
+    m3d::GOBB<GLfloat> obb;
+
+
+    /**
+     *  Vertex attributes uploaded in packed forms (see "prepare")
+     *  and the mapping of stored positions to model space (identity
+     *  unless positions are quantized).
+     */
+    bool packed { false };
+    m3d::GAffine<GLfloat> decode;
+
+
+    /**
+     *  Compute bounds of given vertex positions.
+     */
+    void compute_bounds (const std::vector<vec3> &);
+
+
 public:
 
     /**
@@ -41,6 +71,26 @@ public:
      */
     virtual void draw () const = 0;
 
+
+    /**
+     *  Bounds of vertex positions (model space).
+     */
+    inline const m3d::GAABB<GLfloat>& get_aabb () const { return this->aabb; }
+    inline const m3d::GSphere<GLfloat>& get_sphere () const {
+        return this->sphere;
+    }
+    inline const m3d::GOBB<GLfloat>& get_obb () const { return this->obb; }
+
+
+    /**
+     *  Packed attributes flag and stored-to-model space mapping
+     *  (to be applied before the model matrix).
+     */
+    inline bool is_packed () const { return this->packed; }
+    inline const m3d::GAffine<GLfloat>& get_decode () const {
+        return this->decode;
+    }
+
 };
 
 
@@ -88,12 +138,13 @@ public:
 
 
     /**
-     *  ...
+     *  Upload vertices with colors (packed: colors as unorm8).
      */
     VertexColorBatch& prepare (
         GLenum,
         const std::vector<vec3> &,
-        const std::vector<vec4> &
+        const std::vector<vec4> &,
+        bool packed = false
     );
 
 
@@ -148,13 +199,16 @@ public:
 
 
     /**
-     *  ...
+     *  Upload vertices, normals, uvs and indices (packed: positions
+     *  quantized to unorm16 relative to the bounding box, normals
+     *  octahedral-encoded as snorm16, uvs as half floats).
      */
     TriangleBatch& prepare (
         const std::vector<vec3> &,
         const std::vector<vec3> &,
         const std::vector<vec2> &,
-        const std::vector<GLushort> &
+        const std::vector<GLushort> &,
+        bool packed = false
     );
 
 
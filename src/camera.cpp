@@ -29,15 +29,12 @@ Camera<T>::Camera () {
 
 
 /**
- *  Recompute rotation matrix from dist/pitch/yaw.
+ *  Recompute frame of reference from target/dist/pitch/yaw.
  */
 template <typename T>
 void Camera<T>::recompute_transform () {
-    this->transform.rebuild_from_matrix(
-        mat4().load_translation(this->target) *
-        mat4().load_rotation(this->yaw, 0, 1, 0) *
-        mat4().load_rotation(this->pitch, 1, 0, 0) *
-        mat4().load_translation(0, 0, this->dist)
+    this->transform.rebuild_orbit(
+        this->target, this->dist, this->yaw, this->pitch
     );
 }
 
@@ -168,6 +165,31 @@ typename Camera<T>::mat4 Camera<T>::get_vp_matrix () const {
 
 
 
+/**
+ *  Get view frustum (world space planes).
+ */
+template <typename T>
+typename Camera<T>::frustum Camera<T>::get_frustum () const {
+    return frustum(this->get_vp_matrix());
+}
+
+
+
+
+/**
+ *  Get world space ray through a window point (pixels, origin
+ *  in the top-left corner) of a "width" x "height" viewport.
+ */
+template <typename T>
+typename Camera<T>::ray Camera<T>::get_ray (
+    T x, T y, T width, T height
+) const {
+    return m3d::unproject(this->get_vp_matrix(), x, y, width, height);
+}
+
+
+
+
 /**
  *  Instantiation for allowed types.
  */
@@ -13,6 +13,8 @@
 #include <vector>
 #include "m3d.hpp"
 #include "gframe.hpp"
+#include "gbounds.hpp"
+#include "gray.hpp"
 
 namespace machina {
 
@@ -113,6 +115,8 @@ class Camera {
     using vec4 = m3d::GVector4<T>;
     using mat4 = m3d::GMatrix4<T>;
     using frame = m3d::GFrame<T>;
+    using frustum = m3d::GFrustum<T>;
+    using ray = m3d::GRay<T>;
 
 
 public:
@@ -205,6 +209,19 @@ public:
      */
     mat4 get_vp_matrix () const;
 
+
+    /**
+     *  Get view frustum (world space planes).
+     */
+    frustum get_frustum () const;
+
+
+    /**
+     *  Get world space ray through a window point (pixels, origin
+     *  in the top-left corner) of a "width" x "height" viewport.
+     */
+    ray get_ray (T x, T y, T width, T height) const;
+
 };
 
 
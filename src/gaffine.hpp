@@ -0,0 +1,441 @@
+/**
+ *  machina
+ *
+ *  Copyright (c) 2015, drmats
+ *  All rights reserved.
+ *
+ *  https://github.com/drmats/machina
+ */
+
+#ifndef __GAFFINE_HPP_
+#define __GAFFINE_HPP_ 1
+
+#include "m3d.hpp"
+#include "gquaternion.hpp"
+
+namespace m3d {
+
+
+
+
+/**
+ *  Column-major 3x4 affine composition (out = a * b, implicit
+ *  last row [0, 0, 0, 1]). Elements are summed in the same order
+ *  as in matrix_multiply (so values match 4x4 products).
+ *  Both arguments are fully read before "out" is written.
+ */
+template <typename T>
+constexpr void affine_multiply_scalar (T *out, const T *a, const T *b) {
+    #define mad(i, c) \
+        a[i]*b[c] + a[3 + (i)]*b[(c) + 1] + a[6 + (i)]*b[(c) + 2]
+    const T r[3*4] {
+        mad(0, 0), mad(1, 0), mad(2, 0),
+        mad(0, 3), mad(1, 3), mad(2, 3),
+        mad(0, 6), mad(1, 6), mad(2, 6),
+        mad(0, 9) + a[9], mad(1, 9) + a[10], mad(2, 9) + a[11]
+    };
+    #undef mad
+    for (std::size_t i = 0;  i < 3*4;  i++) {
+        out[i] = r[i];
+    }
+}
+
+
+
+
+/**
+ *  Affine composition entry point (specialized below for SIMD).
+ */
+template <typename T>
+constexpr void affine_multiply (T *out, const T *a, const T *b) {
+    affine_multiply_scalar<T>(out, a, b);
+}
+
+
+
+
+#if defined(M3D_SSE2)
+
+/**
+ *  Float 3x4 affine composition (SSE2).
+ *  Storage is loaded and stored as three full 4-lane vectors
+ *  (so chained products forward stores to loads), columns are
+ *  shuffled out of them. Same summation order as matrix_multiply.
+ */
+template <>
+constexpr void affine_multiply<float> (
+    float *out, const float *a, const float *b
+) {
+    if (m3d_constant_evaluated()) {
+        return affine_multiply_scalar<float>(out, a, b);
+    }
+    const __m128
+        q0 { _mm_loadu_ps(a) },
+        q1 { _mm_loadu_ps(a + 4) },
+        q2 { _mm_loadu_ps(a + 8) },
+        q01 { _mm_shuffle_ps(q0, q1, _MM_SHUFFLE(1, 0, 3, 3)) },
+        a0 { q0 },
+        a1 { _mm_shuffle_ps(q01, q01, _MM_SHUFFLE(3, 3, 2, 0)) },
+        a2 { _mm_shuffle_ps(q1, q2, _MM_SHUFFLE(0, 0, 3, 2)) },
+        a3 { _mm_shuffle_ps(q2, q2, _MM_SHUFFLE(3, 3, 2, 1)) };
+
+    #define column(c) \
+        _mm_add_ps( \
+            _mm_add_ps( \
+                _mm_mul_ps(a0, _mm_set1_ps(b[c])), \
+                _mm_mul_ps(a1, _mm_set1_ps(b[(c) + 1])) \
+            ), \
+            _mm_mul_ps(a2, _mm_set1_ps(b[(c) + 2])) \
+        )
+    const __m128
+        r0 { column(0) },
+        r1 { column(3) },
+        r2 { column(6) },
+        r3 { _mm_add_ps(column(9), a3) },
+        r01 { _mm_shuffle_ps(r0, r1, _MM_SHUFFLE(0, 0, 2, 2)) },
+        r23 { _mm_shuffle_ps(r2, r3, _MM_SHUFFLE(0, 0, 2, 2)) };
+    #undef column
+
+    _mm_storeu_ps(out, _mm_shuffle_ps(r0, r01, _MM_SHUFFLE(2, 0, 1, 0)));
+    _mm_storeu_ps(out + 4, _mm_shuffle_ps(r1, r2, _MM_SHUFFLE(1, 0, 2, 1)));
+    _mm_storeu_ps(out + 8, _mm_shuffle_ps(r23, r3, _MM_SHUFFLE(2, 1, 2, 0)));
+}
+
+#endif
+
+
+
+
+/**
+ *  Affine transformation stored as a column-major 3x4 matrix
+ *  (x, y and z axes followed by the translation - the implicit
+ *  last row of the equivalent 4x4 matrix is [0, 0, 0, 1]).
+ *  Builders produce the same values as their GMatrix4 counterparts,
+ *  composition costs 36 multiplications (instead of 64).
+ */
+template <typename T>
+class GAffine : public GArray<T, 3*4> {
+
+    using vec3 = GVector3<T>;
+    using mat4 = GMatrix4<T>;
+
+
+public:
+
+    /**
+     *  Identity transformation.
+     */
+    constexpr GAffine () { this->load_identity(); }
+
+
+    /**
+     *  ...
+     */
+    constexpr GAffine (const GArray<T, 3*4> &a) { GArray<T, 3*4>::assign(a); }
+
+
+    /**
+     *  Affine part of a 4x4 matrix (last row is ignored).
+     */
+    constexpr GAffine (const GArray<T, 4*4> &m) { this->load_from_matrix(m); }
+
+
+    /**
+     *  ...
+     */
+    using GArray<T, 3*4>::operator=;
+
+
+    /**
+     *  Replace current transformation with identity.
+     */
+    constexpr GAffine<T>& load_identity () {
+        this->reset();
+        this->data[0] = this->data[4] = this->data[8] = static_cast<T>(1);
+        return *this;
+    }
+
+
+    /**
+     *  Replace current transformation with the affine part
+     *  of a given (column-major) 4x4 matrix.
+     */
+    constexpr GAffine<T>& load_from_matrix (const GArray<T, 4*4> &m) {
+        for (std::size_t c = 0;  c < 4;  c++) {
+            for (std::size_t r = 0;  r < 3;  r++) {
+                this->data[c*3 + r] = (*m)[c*4 + r];
+            }
+        }
+        return *this;
+    }
+
+
+    /**
+     *  Replace current transformation with the translation.
+     */
+    constexpr GAffine<T>& load_translation (T x, T y, T z) {
+        this->load_identity();
+        #define set(i, v) this->data[i] = v
+        set(9, x); set(10, y); set(11, z);
+        #undef set
+        return *this;
+    }
+
+
+    constexpr GAffine<T>& load_translation (const GArray<T, 3> &v) {
+        return this->load_translation(v[0], v[1], v[2]);
+    }
+
+
+    /**
+     *  Replace current transformation with the scale.
+     */
+    constexpr GAffine<T>& load_scale (T x, T y, T z) {
+        this->reset();
+        #define set(i, v) this->data[i] = v
+        set(0, x); set(4, y); set(8, z);
+        #undef set
+        return *this;
+    }
+
+
+    constexpr GAffine<T>& load_scale (const GArray<T, 3> &v) {
+        return this->load_scale(v[0], v[1], v[2]);
+    }
+
+
+    /**
+     *  Replace current transformation with the rotation
+     *  about a given axis (angle in degrees).
+     */
+    inline GAffine<T>& load_rotation (T angle, T x, T y, T z) {
+        T s { static_cast<T>(0) }, c { static_cast<T>(1) };
+        sincos(radians(angle), s, c);
+        return this->load_rotation_sincos(s, c, x, y, z);
+    }
+
+
+    inline GAffine<T>& load_rotation (T angle, const GArray<T, 3> &v) {
+        return this->load_rotation(angle, v[0], v[1], v[2]);
+    }
+
+
+    /**
+     *  Replace current transformation with the rotation
+     *  (fast, approximate sine and cosine - see "fast_sincos").
+     */
+    inline GAffine<T>& load_rotation_fast (T angle, T x, T y, T z) {
+        T s { static_cast<T>(0) }, c { static_cast<T>(1) };
+        fast_sincos(radians(angle), s, c);
+        return this->load_rotation_sincos(s, c, x, y, z);
+    }
+
+
+    inline GAffine<T>& load_rotation_fast (T angle, const GArray<T, 3> &v) {
+        return this->load_rotation_fast(angle, v[0], v[1], v[2]);
+    }
+
+
+    /**
+     *  Replace current transformation with the rotation about x, y
+     *  or z axis (only sine/cosine terms are computed).
+     */
+    inline GAffine<T>& load_rotation_x (T angle) {
+        T s { static_cast<T>(0) }, c { static_cast<T>(1) };
+        sincos(radians(angle), s, c);
+        this->load_identity();
+        #define set(i, v) this->data[i] = v
+        set(4, c);  set(7, -s);
+        set(5, s);  set(8, c);
+        #undef set
+        return *this;
+    }
+
+
+    inline GAffine<T>& load_rotation_y (T angle) {
+        T s { static_cast<T>(0) }, c { static_cast<T>(1) };
+        sincos(radians(angle), s, c);
+        this->load_identity();
+        #define set(i, v) this->data[i] = v
+        set(0, c);  set(6, s);
+        set(2, -s);  set(8, c);
+        #undef set
+        return *this;
+    }
+
+
+    inline GAffine<T>& load_rotation_z (T angle) {
+        T s { static_cast<T>(0) }, c { static_cast<T>(1) };
+        sincos(radians(angle), s, c);
+        this->load_identity();
+        #define set(i, v) this->data[i] = v
+        set(0, c);  set(3, -s);
+        set(1, s);  set(4, c);
+        #undef set
+        return *this;
+    }
+
+
+    /**
+     *  Replace current transformation with the rotation
+     *  (built from sine and cosine of the angle).
+     */
+    inline GAffine<T>& load_rotation_sincos (T s, T c, T x, T y, T z) {
+        vec3 v { x, y, z };  v.normalize();
+        const T
+            nc { static_cast<T>(1) - c },
+            xs { v[0]*s },         ys { v[1]*s },         zs { v[2]*s },
+          xync { v[0]*v[1]*nc }, xznc { v[0]*v[2]*nc }, yznc { v[1]*v[2]*nc };
+
+        #define set(i, val) this->data[i] = static_cast<T>(val)
+
+        set(0, sqr(v[0])*nc+c);  set(3,        xync-zs);  set(6,        xznc+ys);
+        set(1,        xync+zs);  set(4, sqr(v[1])*nc+c);  set(7,        yznc-xs);
+        set(2,        xznc-ys);  set(5,        yznc+xs);  set(8, sqr(v[2])*nc+c);
+
+        set(9, 0);  set(10, 0);  set(11, 0);
+
+        #undef set
+
+        return *this;
+    }
+
+
+    /**
+     *  Replace current transformation with the rotation
+     *  described by a (unit) quaternion.
+     */
+    constexpr GAffine<T>& load_rotation (const GQuaternion<T> &q) {
+        return this->load_from_matrix(q.get_matrix());
+    }
+
+
+    /**
+     *  Compose two transformations and store the result in the
+     *  current one ("a" applied after "b", "a" and "b" may refer
+     *  to the current transformation).
+     */
+    constexpr GAffine<T>& multiply (
+        const GArray<T, 3*4> &a, const GArray<T, 3*4> &b
+    ) {
+        affine_multiply<T>(this->data, *a, *b);
+        return *this;
+    }
+
+
+    /**
+     *  Transform a point (translation applies).
+     */
+    constexpr vec3 transform_point (const GArray<T, 3> &v) const {
+        return this->transform_direction(v) + vec3(
+            this->data[9], this->data[10], this->data[11]
+        );
+    }
+
+
+    /**
+     *  Transform a direction (translation doesn't apply).
+     */
+    constexpr vec3 transform_direction (const GArray<T, 3> &v) const {
+        return vec3(
+            this->data[0]*v[0] + this->data[3]*v[1] + this->data[6]*v[2],
+            this->data[1]*v[0] + this->data[4]*v[1] + this->data[7]*v[2],
+            this->data[2]*v[0] + this->data[5]*v[1] + this->data[8]*v[2]
+        );
+    }
+
+
+    /**
+     *  Replace current transformation with its inverse
+     *  (throws std::domain_error for singular transformations).
+     */
+    inline GAffine<T>& inverse () noexcept(false) {
+        #define m(r, c) this->data[(c)*3 + (r)]
+        const T
+            c00 { m(1,1)*m(2,2) - m(1,2)*m(2,1) },
+            c01 { m(1,2)*m(2,0) - m(1,0)*m(2,2) },
+            c02 { m(1,0)*m(2,1) - m(1,1)*m(2,0) },
+            det { m(0,0)*c00 + m(0,1)*c01 + m(0,2)*c02 };
+        if (!std::isnormal(det)) {
+            throw std::domain_error(msg::singular_matrix);
+        }
+        const T d { static_cast<T>(1) / det };
+        T r[3*4] {
+            c00*d,
+            c01*d,
+            c02*d,
+            (m(0,2)*m(2,1) - m(0,1)*m(2,2))*d,
+            (m(0,0)*m(2,2) - m(0,2)*m(2,0))*d,
+            (m(0,1)*m(2,0) - m(0,0)*m(2,1))*d,
+            (m(0,1)*m(1,2) - m(0,2)*m(1,1))*d,
+            (m(0,2)*m(1,0) - m(0,0)*m(1,2))*d,
+            (m(0,0)*m(1,1) - m(0,1)*m(1,0))*d,
+            0, 0, 0
+        };
+        #undef m
+        for (std::size_t i = 0;  i < 3;  i++) {
+            r[9 + i] = -(
+                r[i]*this->data[9] + r[3 + i]*this->data[10] +
+                r[6 + i]*this->data[11]
+            );
+        }
+        return static_cast<GAffine<T>&>(this->assign(r));
+    }
+
+
+    /**
+     *  Replace current transformation with its inverse, assuming
+     *  it is rigid (orthonormal rotation followed by translation):
+     *  the rotation is transposed, the translation is rotated back.
+     */
+    constexpr GAffine<T>& inverse_rigid () {
+        #define swap(i, j) { \
+            const T tmp { this->data[i] }; \
+            this->data[i] = this->data[j];  this->data[j] = tmp; \
+        }
+        swap(1, 3);  swap(2, 6);  swap(5, 7);
+        #undef swap
+        const vec3 t { this->transform_direction(vec3(
+            this->data[9], this->data[10], this->data[11]
+        )) };
+        for (std::size_t i = 0;  i < 3;  i++) {
+            this->data[9 + i] = -t[i];
+        }
+        return *this;
+    }
+
+
+    /**
+     *  Build the equivalent 4x4 matrix (e.g. for upload).
+     */
+    constexpr mat4 get_matrix () const {
+        const T zero { static_cast<T>(0) }, one { static_cast<T>(1) };
+        #define d(i) this->data[i]
+        return mat4 {
+            d(0), d(1),  d(2), zero,
+            d(3), d(4),  d(5), zero,
+            d(6), d(7),  d(8), zero,
+            d(9), d(10), d(11), one
+        };
+        #undef d
+    }
+
+};
+
+
+
+
+/**
+ *  Compose two transformations yielding the new one.
+ */
+template <typename T>
+constexpr GAffine<T> operator* (const GAffine<T> &a, const GAffine<T> &b) {
+    return GAffine<T>().multiply(a, b);
+}
+
+
+
+
+} // namespace m3d
+
+#endif
@@ -0,0 +1,1107 @@
+/**
+ *  machina
+ *
+ *  Copyright (c) 2015, drmats
+ *  All rights reserved.
+ *
+ *  https://github.com/drmats/machina
+ */
+
+#ifndef __GBOUNDS_HPP_
+#define __GBOUNDS_HPP_ 1
+
+#include "m3d.hpp"
+#include "m3d_packet.hpp"
+#include "m3d_kernels.hpp"
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace m3d {
+
+
+
+
+/**
+ *  Result of a bounding volume test against a set of planes.
+ */
+enum class containment : unsigned char {
+    outside = 0,
+    intersects = 1,
+    inside = 2
+};
+
+
+
+
+/**
+ *  Component-wise minimum and maximum of a vertex array
+ *  (float arrays use the SIMD kernel).
+ */
+template <typename T>
+inline void points_min_max (
+    GVector3<T> &lo, GVector3<T> &hi, const GVector3<T> *p, std::size_t n
+) {
+    lo.assign(
+        std::numeric_limits<T>::infinity(),
+        std::numeric_limits<T>::infinity(),
+        std::numeric_limits<T>::infinity()
+    );
+    hi.assign(-lo[0], -lo[1], -lo[2]);
+    for (std::size_t i = 0;  i < n;  i++) {
+        for (std::size_t j = 0;  j < 3;  j++) {
+            lo[j] = std::min(lo[j], p[i][j]);
+            hi[j] = std::max(hi[j], p[i][j]);
+        }
+    }
+}
+
+
+inline void points_min_max (
+    GVector3<GLfloat> &lo, GVector3<GLfloat> &hi,
+    const GVector3<GLfloat> *p, std::size_t n
+) {
+    kernels::min_max(lo, hi, p, n);
+}
+
+
+
+
+/**
+ *  Plane: points "p" with "normal.dot(p) + d == 0",
+ *  positive half-space is in front of the plane.
+ */
+template <typename T>
+class GPlane {
+
+    using vec3 = GVector3<T>;
+
+
+public:
+
+    vec3 normal;
+    T d;
+
+
+    /**
+     *  ...
+     */
+    constexpr GPlane ():
+        normal { static_cast<T>(0), static_cast<T>(0), static_cast<T>(1) },
+        d { static_cast<T>(0) } {}
+    constexpr GPlane (const GArray<T, 3> &normal, T d):
+        normal { normal }, d { d } {}
+    constexpr GPlane (T a, T b, T c, T d):
+        normal { a, b, c }, d { d } {}
+
+
+    /**
+     *  Scale the equation to unit normal (distances become euclidean).
+     */
+    inline GPlane<T>& normalize () {
+        const T l { this->normal.length() };
+        if (l > static_cast<T>(0)) {
+            this->normal.scale(static_cast<T>(1) / l);
+            this->d /= l;
+        }
+        return *this;
+    }
+
+
+    /**
+     *  Signed distance of a point (scaled by normal length).
+     */
+    constexpr T distance (const GArray<T, 3> &p) const {
+        return this->normal.dot(p) + this->d;
+    }
+
+};
+
+
+
+
+/**
+ *  Classify an interval "s - r .. s + r" (signed distances
+ *  of a volume) against all planes.
+ */
+template <typename T, typename F>
+inline containment classify_planes (
+    const GPlane<T> *planes, std::size_t k, F distance_radius
+) {
+    containment result { containment::inside };
+    T s { 0 }, r { 0 };
+    for (std::size_t i = 0;  i < k;  i++) {
+        distance_radius(planes[i], s, r);
+        if (s + r < static_cast<T>(0)) { return containment::outside; }
+        if (s - r < static_cast<T>(0)) { result = containment::intersects; }
+    }
+    return result;
+}
+
+
+
+
+/**
+ *  Axis-aligned bounding box. Default-constructed box is empty
+ *  (min = +inf, max = -inf), merging anything into it yields
+ *  the merged volume.
+ */
+template <typename T>
+class GAABB {
+
+    using vec3 = GVector3<T>;
+
+
+public:
+
+    vec3 min, max;
+
+
+    /**
+     *  ...
+     */
+    constexpr GAABB ():
+        min {
+            std::numeric_limits<T>::infinity(),
+            std::numeric_limits<T>::infinity(),
+            std::numeric_limits<T>::infinity()
+        },
+        max {
+            -std::numeric_limits<T>::infinity(),
+            -std::numeric_limits<T>::infinity(),
+            -std::numeric_limits<T>::infinity()
+        } {}
+    constexpr GAABB (const GArray<T, 3> &min, const GArray<T, 3> &max):
+        min { min }, max { max } {}
+
+
+    /**
+     *  Box enclosing a vertex array.
+     */
+    inline GAABB (const vec3 *points, std::size_t n) {
+        points_min_max(this->min, this->max, points, n);
+    }
+    inline explicit GAABB (const std::vector<vec3> &points):
+        GAABB(points.data(), points.size()) {}
+
+
+    /**
+     *  Does the box contain nothing?
+     */
+    constexpr bool empty () const {
+        return
+            this->min[0] > this->max[0]  ||
+            this->min[1] > this->max[1]  ||
+            this->min[2] > this->max[2];
+    }
+
+
+    /**
+     *  Center and half-size.
+     */
+    constexpr vec3 center () const {
+        return (this->min + this->max) * static_cast<T>(0.5);
+    }
+
+
+    constexpr vec3 extent () const {
+        return (this->max - this->min) * static_cast<T>(0.5);
+    }
+
+
+    /**
+     *  Grow the box to enclose a point or another box.
+     */
+    constexpr GAABB<T>& merge (const GArray<T, 3> &p) {
+        for (std::size_t i = 0;  i < 3;  i++) {
+            this->min[i] = std::min(this->min[i], p[i]);
+            this->max[i] = std::max(this->max[i], p[i]);
+        }
+        return *this;
+    }
+
+
+    constexpr GAABB<T>& merge (const GAABB<T> &b) {
+        for (std::size_t i = 0;  i < 3;  i++) {
+            this->min[i] = std::min(this->min[i], b.min[i]);
+            this->max[i] = std::max(this->max[i], b.max[i]);
+        }
+        return *this;
+    }
+
+
+    /**
+     *  Point containment and box overlap (touching counts).
+     */
+    constexpr bool contains (const GArray<T, 3> &p) const {
+        return
+            p[0] >= this->min[0]  &&  p[0] <= this->max[0]  &&
+            p[1] >= this->min[1]  &&  p[1] <= this->max[1]  &&
+            p[2] >= this->min[2]  &&  p[2] <= this->max[2];
+    }
+
+
+    constexpr bool overlaps (const GAABB<T> &b) const {
+        return
+            this->min[0] <= b.max[0]  &&  b.min[0] <= this->max[0]  &&
+            this->min[1] <= b.max[1]  &&  b.min[1] <= this->max[1]  &&
+            this->min[2] <= b.max[2]  &&  b.min[2] <= this->max[2];
+    }
+
+
+    /**
+     *  Box enclosing this box transformed by a 4x4 or 3x4 (affine)
+     *  matrix (transformed center, extent through absolute matrix).
+     */
+    inline GAABB<T> transformed (const GArray<T, 4*4> &m) const {
+        return this->transformed_columns<4>(*m);
+    }
+
+
+    inline GAABB<T> transformed (const GArray<T, 3*4> &a) const {
+        return this->transformed_columns<3>(*a);
+    }
+
+
+    /**
+     *  Test against a set of planes (inside = positive half-spaces).
+     */
+    inline containment classify (const GPlane<T> *planes, std::size_t k) const {
+        if (this->empty()) { return containment::outside; }
+        const vec3 c { this->center() }, e { this->extent() };
+        return classify_planes(planes, k,
+            [&] (const GPlane<T> &p, T &s, T &r) {
+                s = p.distance(c);
+                r =
+                    e[0]*std::fabs(p.normal[0]) + e[1]*std::fabs(p.normal[1]) +
+                    e[2]*std::fabs(p.normal[2]);
+            }
+        );
+    }
+
+
+private:
+
+    /**
+     *  Transformation by column-major matrix with "S" rows.
+     */
+    template <std::size_t S>
+    inline GAABB<T> transformed_columns (const T *m) const {
+        if (this->empty()) { return GAABB<T>(); }
+        const vec3 c { this->center() }, e { this->extent() };
+        vec3 tc, te;
+        for (std::size_t i = 0;  i < 3;  i++) {
+            tc[i] = m[i]*c[0] + m[i + S]*c[1] + m[i + 2*S]*c[2] + m[i + 3*S];
+            te[i] =
+                std::fabs(m[i])*e[0] + std::fabs(m[i + S])*e[1] +
+                std::fabs(m[i + 2*S])*e[2];
+        }
+        return GAABB<T>(tc - te, tc + te);
+    }
+
+};
+
+
+
+
+/**
+ *  Bounding sphere. Default-constructed sphere is empty
+ *  (negative radius).
+ */
+template <typename T>
+class GSphere {
+
+    using vec3 = GVector3<T>;
+
+
+public:
+
+    vec3 center;
+    T radius;
+
+
+    /**
+     *  ...
+     */
+    constexpr GSphere ():
+        center { static_cast<T>(0), static_cast<T>(0), static_cast<T>(0) },
+        radius { static_cast<T>(-1) } {}
+    constexpr GSphere (const GArray<T, 3> &center, T radius):
+        center { center }, radius { radius } {}
+
+
+    /**
+     *  Sphere enclosing a vertex array (centered in the bounding box,
+     *  farthest vertex found with packet arithmetic).
+     */
+    inline GSphere (const vec3 *points, std::size_t n) {
+        using packet = GPacket<T, 4>;
+        using vec3p = GVector3P<T, 4>;
+        if (n == 0) { *this = GSphere<T>();  return; }
+        this->center = GAABB<T>(points, n).center();
+        const vec3p c { this->center };
+        packet farthest { static_cast<T>(0) };
+        std::size_t i { 0 };
+        for (;  i + 4 <= n;  i += 4) {
+            farthest = max(farthest, sqr_length(vec3p::gather(points + i) - c));
+        }
+        T r2 { static_cast<T>(0) };
+        for (std::size_t j = 0;  j < 4;  j++) { r2 = std::max(r2, farthest[j]); }
+        for (;  i < n;  i++) {
+            r2 = std::max(r2, vec3(points[i] - this->center).sqr_length());
+        }
+        this->radius = std::sqrt(r2);
+    }
+    inline explicit GSphere (const std::vector<vec3> &points):
+        GSphere(points.data(), points.size()) {}
+
+
+    /**
+     *  Does the sphere contain nothing?
+     */
+    constexpr bool empty () const { return this->radius < static_cast<T>(0); }
+
+
+    /**
+     *  Grow the sphere to enclose a point or another sphere.
+     */
+    inline GSphere<T>& merge (const GArray<T, 3> &p) {
+        return this->merge(GSphere<T>(p, static_cast<T>(0)));
+    }
+
+
+    inline GSphere<T>& merge (const GSphere<T> &s) {
+        if (s.empty()) { return *this; }
+        if (this->empty()) { return *this = s; }
+        const vec3 offset { s.center - this->center };
+        const T dist { offset.length() };
+        if (dist + s.radius <= this->radius) { return *this; }
+        if (dist + this->radius <= s.radius) { return *this = s; }
+        const T r { (dist + this->radius + s.radius) * static_cast<T>(0.5) };
+        this->center += offset * ((r - this->radius) / dist);
+        this->radius = r;
+        return *this;
+    }
+
+
+    /**
+     *  Point containment and overlap tests (touching counts).
+     */
+    inline bool contains (const GArray<T, 3> &p) const {
+        return vec3(p - this->center).sqr_length() <= sqr(this->radius);
+    }
+
+
+    inline bool overlaps (const GSphere<T> &s) const {
+        return
+            !this->empty()  &&  !s.empty()  &&
+            vec3(s.center - this->center).sqr_length() <=
+                sqr(this->radius + s.radius);
+    }
+
+
+    inline bool overlaps (const GAABB<T> &b) const {
+        if (this->empty()  ||  b.empty()) { return false; }
+        T d2 { static_cast<T>(0) };
+        for (std::size_t i = 0;  i < 3;  i++) {
+            const T c { this->center[i] };
+            if (c < b.min[i]) { d2 += sqr(b.min[i] - c); }
+            else if (c > b.max[i]) { d2 += sqr(c - b.max[i]); }
+        }
+        return d2 <= sqr(this->radius);
+    }
+
+
+    /**
+     *  Sphere enclosing this sphere transformed by a 4x4 or 3x4
+     *  (affine) matrix (radius scaled by the longest basis vector).
+     */
+    inline GSphere<T> transformed (const GArray<T, 4*4> &m) const {
+        return this->transformed_columns<4>(*m);
+    }
+
+
+    inline GSphere<T> transformed (const GArray<T, 3*4> &a) const {
+        return this->transformed_columns<3>(*a);
+    }
+
+
+    /**
+     *  Test against a set of planes (inside = positive half-spaces,
+     *  plane normals have to be unit length).
+     */
+    inline containment classify (const GPlane<T> *planes, std::size_t k) const {
+        if (this->empty()) { return containment::outside; }
+        return classify_planes(planes, k,
+            [&] (const GPlane<T> &p, T &s, T &r) {
+                s = p.distance(this->center);
+                r = this->radius;
+            }
+        );
+    }
+
+
+private:
+
+    /**
+     *  Transformation by column-major matrix with "S" rows.
+     */
+    template <std::size_t S>
+    inline GSphere<T> transformed_columns (const T *m) const {
+        if (this->empty()) { return GSphere<T>(); }
+        vec3 tc;
+        T scale2 { static_cast<T>(0) };
+        for (std::size_t i = 0;  i < 3;  i++) {
+            tc[i] =
+                m[i]*this->center[0] + m[i + S]*this->center[1] +
+                m[i + 2*S]*this->center[2] + m[i + 3*S];
+            scale2 = std::max(
+                scale2, sqr(m[i*S]) + sqr(m[i*S + 1]) + sqr(m[i*S + 2])
+            );
+        }
+        return GSphere<T>(tc, this->radius * std::sqrt(scale2));
+    }
+
+};
+
+
+
+
+/**
+ *  Oriented bounding box: center, three orthonormal axes
+ *  and half-sizes along them. Default-constructed box is empty
+ *  (negative extent).
+ */
+template <typename T>
+class GOBB {
+
+    using vec3 = GVector3<T>;
+
+
+public:
+
+    vec3 center;
+    vec3 axis[3];
+    vec3 extent;
+
+
+    /**
+     *  ...
+     */
+    constexpr GOBB ():
+        center { static_cast<T>(0), static_cast<T>(0), static_cast<T>(0) },
+        axis {
+            { static_cast<T>(1), static_cast<T>(0), static_cast<T>(0) },
+            { static_cast<T>(0), static_cast<T>(1), static_cast<T>(0) },
+            { static_cast<T>(0), static_cast<T>(0), static_cast<T>(1) }
+        },
+        extent { static_cast<T>(-1), static_cast<T>(-1), static_cast<T>(-1) } {}
+
+
+    /**
+     *  Box equal to an axis-aligned one.
+     */
+    constexpr explicit GOBB (const GAABB<T> &b): GOBB() {
+        if (!b.empty()) {
+            this->center = b.center();
+            this->extent = b.extent();
+        }
+    }
+
+
+    /**
+     *  Box enclosing a vertex array, oriented along principal
+     *  axes of the vertices (eigenvectors of their covariance).
+     */
+    inline GOBB (const vec3 *points, std::size_t n): GOBB() {
+        if (n == 0) { return; }
+
+        // mean and covariance
+        vec3 mean { static_cast<T>(0), static_cast<T>(0), static_cast<T>(0) };
+        for (std::size_t i = 0;  i < n;  i++) { mean += points[i]; }
+        mean.scale(static_cast<T>(1) / static_cast<T>(n));
+        T a[3][3] { { 0 } };
+        for (std::size_t i = 0;  i < n;  i++) {
+            const vec3 p { points[i] - mean };
+            for (std::size_t r = 0;  r < 3;  r++) {
+                for (std::size_t c = r;  c < 3;  c++) { a[r][c] += p[r]*p[c]; }
+            }
+        }
+        a[1][0] = a[0][1];  a[2][0] = a[0][2];  a[2][1] = a[1][2];
+
+        // principal axes
+        T v[3][3];
+        symmetric_eigenvectors(a, v);
+        for (std::size_t i = 0;  i < 3;  i++) {
+            this->axis[i].assign(v[0][i], v[1][i], v[2][i]);
+            this->axis[i].normalize();
+        }
+        this->axis[2].cross(this->axis[0], this->axis[1]);
+        this->axis[1].cross(this->axis[2], this->axis[0]);
+
+        // extents along the axes
+        T lo[3], hi[3];
+        for (std::size_t j = 0;  j < 3;  j++) {
+            lo[j] = std::numeric_limits<T>::infinity();
+            hi[j] = -lo[j];
+        }
+        for (std::size_t i = 0;  i < n;  i++) {
+            for (std::size_t j = 0;  j < 3;  j++) {
+                const T d { this->axis[j].dot(points[i]) };
+                lo[j] = std::min(lo[j], d);
+                hi[j] = std::max(hi[j], d);
+            }
+        }
+        this->center.reset();
+        for (std::size_t j = 0;  j < 3;  j++) {
+            this->center += this->axis[j] * ((lo[j] + hi[j]) * static_cast<T>(0.5));
+            this->extent[j] = (hi[j] - lo[j]) * static_cast<T>(0.5);
+        }
+    }
+    inline explicit GOBB (const std::vector<vec3> &points):
+        GOBB(points.data(), points.size()) {}
+
+
+    /**
+     *  Does the box contain nothing?
+     */
+    constexpr bool empty () const {
+        return
+            this->extent[0] < static_cast<T>(0)  ||
+            this->extent[1] < static_cast<T>(0)  ||
+            this->extent[2] < static_cast<T>(0);
+    }
+
+
+    /**
+     *  Axis-aligned box enclosing this box.
+     */
+    inline GAABB<T> get_aabb () const {
+        if (this->empty()) { return GAABB<T>(); }
+        vec3 e;
+        for (std::size_t i = 0;  i < 3;  i++) {
+            e[i] =
+                std::fabs(this->axis[0][i])*this->extent[0] +
+                std::fabs(this->axis[1][i])*this->extent[1] +
+                std::fabs(this->axis[2][i])*this->extent[2];
+        }
+        return GAABB<T>(this->center - e, this->center + e);
+    }
+
+
+    /**
+     *  Point containment.
+     */
+    inline bool contains (const GArray<T, 3> &p) const {
+        const vec3 d { p - this->center };
+        for (std::size_t i = 0;  i < 3;  i++) {
+            if (std::fabs(this->axis[i].dot(d)) > this->extent[i]) {
+                return false;
+            }
+        }
+        return !this->empty();
+    }
+
+
+    /**
+     *  Box overlap (separating axis test over 15 axes).
+     */
+    inline bool overlaps (const GOBB<T> &b) const {
+        if (this->empty()  ||  b.empty()) { return false; }
+        const T epsilon { static_cast<T>(m3d_epsilon) };
+        T r[3][3], ar[3][3], t[3];
+        const vec3 d { b.center - this->center };
+        for (std::size_t i = 0;  i < 3;  i++) {
+            for (std::size_t j = 0;  j < 3;  j++) {
+                r[i][j] = this->axis[i].dot(b.axis[j]);
+                ar[i][j] = std::fabs(r[i][j]) + epsilon;
+            }
+            t[i] = this->axis[i].dot(d);
+        }
+        const vec3 &ea { this->extent }, &eb { b.extent };
+
+        // axes of "this" and of "b"
+        for (std::size_t i = 0;  i < 3;  i++) {
+            if (
+                std::fabs(t[i]) >
+                    ea[i] + eb[0]*ar[i][0] + eb[1]*ar[i][1] + eb[2]*ar[i][2]
+            ) { return false; }
+        }
+        for (std::size_t j = 0;  j < 3;  j++) {
+            if (
+                std::fabs(t[0]*r[0][j] + t[1]*r[1][j] + t[2]*r[2][j]) >
+                    eb[j] + ea[0]*ar[0][j] + ea[1]*ar[1][j] + ea[2]*ar[2][j]
+            ) { return false; }
+        }
+
+        // cross products of axis pairs
+        for (std::size_t i = 0;  i < 3;  i++) {
+            const std::size_t i1 { (i + 1) % 3 }, i2 { (i + 2) % 3 };
+            for (std::size_t j = 0;  j < 3;  j++) {
+                const std::size_t j1 { (j + 1) % 3 }, j2 { (j + 2) % 3 };
+                if (
+                    std::fabs(t[i2]*r[i1][j] - t[i1]*r[i2][j]) >
+                        ea[i1]*ar[i2][j] + ea[i2]*ar[i1][j] +
+                        eb[j1]*ar[i][j2] + eb[j2]*ar[i][j1]
+                ) { return false; }
+            }
+        }
+        return true;
+    }
+
+
+    /**
+     *  Box transformed by a 4x4 or 3x4 (affine) matrix (rotation,
+     *  translation and uniform scale - non-uniform scale or shear
+     *  do not keep the axes orthogonal).
+     */
+    inline GOBB<T> transformed (const GArray<T, 4*4> &m) const {
+        return this->transformed_columns<4>(*m);
+    }
+
+
+    inline GOBB<T> transformed (const GArray<T, 3*4> &a) const {
+        return this->transformed_columns<3>(*a);
+    }
+
+
+
+    /**
+     *  Test against a set of planes (inside = positive half-spaces).
+     */
+    inline containment classify (const GPlane<T> *planes, std::size_t k) const {
+        if (this->empty()) { return containment::outside; }
+        return classify_planes(planes, k,
+            [&] (const GPlane<T> &p, T &s, T &r) {
+                s = p.distance(this->center);
+                r =
+                    this->extent[0]*std::fabs(p.normal.dot(this->axis[0])) +
+                    this->extent[1]*std::fabs(p.normal.dot(this->axis[1])) +
+                    this->extent[2]*std::fabs(p.normal.dot(this->axis[2]));
+            }
+        );
+    }
+
+
+private:
+
+    /**
+     *  Transformation by column-major matrix with "S" rows.
+     */
+    template <std::size_t S>
+    inline GOBB<T> transformed_columns (const T *m) const {
+        if (this->empty()) { return GOBB<T>(); }
+        GOBB<T> o;
+        for (std::size_t i = 0;  i < 3;  i++) {
+            o.center[i] =
+                m[i]*this->center[0] + m[i + S]*this->center[1] +
+                m[i + 2*S]*this->center[2] + m[i + 3*S];
+        }
+        for (std::size_t j = 0;  j < 3;  j++) {
+            const vec3 &a { this->axis[j] };
+            vec3 ta;
+            for (std::size_t i = 0;  i < 3;  i++) {
+                ta[i] = m[i]*a[0] + m[i + S]*a[1] + m[i + 2*S]*a[2];
+            }
+            const T l { ta.length() };
+            o.extent[j] = this->extent[j] * l;
+            o.axis[j] = l > static_cast<T>(0) ?
+                vec3(ta * (static_cast<T>(1) / l)) : a;
+        }
+        return o;
+    }
+
+
+    /**
+     *  Eigenvectors (columns of "v") of a symmetric 3x3 matrix
+     *  (cyclic Jacobi rotations, "a" is destroyed).
+     */
+    static inline void symmetric_eigenvectors (T a[3][3], T v[3][3]) {
+        for (std::size_t r = 0;  r < 3;  r++) {
+            for (std::size_t c = 0;  c < 3;  c++) {
+                v[r][c] = r == c ? static_cast<T>(1) : static_cast<T>(0);
+            }
+        }
+        const std::size_t pairs[3][2] { { 0, 1 }, { 0, 2 }, { 1, 2 } };
+        for (std::size_t sweep = 0;  sweep < 32;  sweep++) {
+            const T
+                off { sqr(a[0][1]) + sqr(a[0][2]) + sqr(a[1][2]) },
+                diag { sqr(a[0][0]) + sqr(a[1][1]) + sqr(a[2][2]) };
+            if (off <= diag * std::numeric_limits<T>::epsilon() *
+                    std::numeric_limits<T>::epsilon()  ||
+                off == static_cast<T>(0)
+            ) { break; }
+            for (const auto &pq : pairs) {
+                const std::size_t p { pq[0] }, q { pq[1] };
+                if (a[p][q] == static_cast<T>(0)) { continue; }
+                const T
+                    theta { (a[q][q] - a[p][p]) / (2*a[p][q]) },
+                    t {
+                        (theta < static_cast<T>(0) ? -1 : 1) /
+                        (std::fabs(theta) + std::sqrt(sqr(theta) + 1))
+                    },
+                    c { 1 / std::sqrt(sqr(t) + 1) },
+                    s { t * c };
+                for (std::size_t k = 0;  k < 3;  k++) {
+                    const T akp { a[k][p] }, akq { a[k][q] };
+                    a[k][p] = c*akp - s*akq;
+                    a[k][q] = s*akp + c*akq;
+                }
+                for (std::size_t k = 0;  k < 3;  k++) {
+                    const T apk { a[p][k] }, aqk { a[q][k] };
+                    a[p][k] = c*apk - s*aqk;
+                    a[q][k] = s*apk + c*aqk;
+                }
+                for (std::size_t k = 0;  k < 3;  k++) {
+                    const T vkp { v[k][p] }, vkq { v[k][q] };
+                    v[k][p] = c*vkp - s*vkq;
+                    v[k][q] = s*vkp + c*vkq;
+                }
+            }
+        }
+    }
+
+};
+
+
+
+
+/**
+ *  Store per-lane results of a packet test ("outside" wins),
+ *  return the number of volumes not outside.
+ */
+inline std::size_t store_containment (
+    containment *out, std::size_t w, int outside, int inside
+) {
+    std::size_t visible { 0 };
+    for (std::size_t j = 0;  j < w;  j++) {
+        const unsigned
+            not_outside { ~static_cast<unsigned>(outside) >> j & 1u },
+            is_inside { static_cast<unsigned>(inside) >> j & 1u };
+        out[j] = static_cast<containment>((1u + is_inside) * not_outside);
+        visible += not_outside;
+    }
+    return visible;
+}
+
+
+
+
+/**
+ *  W boxes as centers and half extents (structure of arrays) -
+ *  the layout of packet plane tests. Boxes tested repeatedly
+ *  (every frame) should be prepared once ("pack"), so the tests
+ *  do packet loads only. Unused lanes hold empty boxes
+ *  (negative extents, always outside).
+ */
+template <typename T, std::size_t W = native_width<T>::value>
+struct GBoxP {
+
+    using packet = GPacket<T, W>;
+    using vec3p = GVector3P<T, W>;
+
+    vec3p center, extent;
+
+
+    /**
+     *  "n" (at most W) consecutive boxes.
+     */
+    static inline GBoxP gather (const GAABB<T> *b, std::size_t n) {
+        T lanes[6][W];
+        for (std::size_t j = 0;  j < W;  j++) {
+            const GAABB<T> box { j < n ? b[j] : GAABB<T>() };
+            for (std::size_t a = 0;  a < 3;  a++) {
+                lanes[a][j] = (box.min[a] + box.max[a]) * static_cast<T>(0.5);
+                lanes[a + 3][j] =
+                    (box.max[a] - box.min[a]) * static_cast<T>(0.5);
+            }
+        }
+        GBoxP p;
+        p.center = vec3p(
+            packet::load(lanes[0]), packet::load(lanes[1]),
+            packet::load(lanes[2])
+        );
+        p.extent = vec3p(
+            packet::load(lanes[3]), packet::load(lanes[4]),
+            packet::load(lanes[5])
+        );
+        return p;
+    }
+
+
+    /**
+     *  All "n" boxes (ceil(n / W) packets).
+     */
+    static inline void pack (
+        aligned_vector<GBoxP> &out, const GAABB<T> *b, std::size_t n
+    ) {
+        out.clear();
+        out.reserve((n + W - 1) / W);
+        for (std::size_t i = 0;  i < n;  i += W) {
+            out.push_back(gather(b + i, std::min(W, n - i)));
+        }
+    }
+
+};
+
+
+
+
+/**
+ *  Test W boxes against "k" planes - lane masks of boxes
+ *  outside and inside (results equal to GAABB::classify).
+ */
+template <typename T, std::size_t W>
+inline void classify (
+    int &outside, int &inside,
+    const GPlane<T> *planes, std::size_t k, const GBoxP<T, W> &b
+) {
+    using packet = GPacket<T, W>;
+    const packet zero { static_cast<T>(0) };
+
+    // smallest "s + r" and "s - r" over all planes
+    packet
+        outer { std::numeric_limits<T>::infinity() },
+        inner { std::numeric_limits<T>::infinity() };
+    for (std::size_t p = 0;  p < k;  p++) {
+        const GPlane<T> &plane { planes[p] };
+        const packet
+            s {
+                b.center.x * packet(plane.normal[0]) +
+                b.center.y * packet(plane.normal[1]) +
+                b.center.z * packet(plane.normal[2]) + packet(plane.d)
+            },
+            r {
+                b.extent.x * packet(std::fabs(plane.normal[0])) +
+                b.extent.y * packet(std::fabs(plane.normal[1])) +
+                b.extent.z * packet(std::fabs(plane.normal[2]))
+            };
+        outer = min(outer, s + r);
+        inner = min(inner, s - r);
+    }
+
+    outside = (
+        (outer < zero) | (b.extent.x < zero) | (b.extent.y < zero) |
+        (b.extent.z < zero)
+    ).bits();
+    inside = (inner >= zero).bits();
+}
+
+
+
+
+/**
+ *  Test "n" prepared boxes against "k" planes (results equal
+ *  to GAABB::classify). Returns the number of boxes not outside.
+ */
+template <typename T, std::size_t W>
+std::size_t classify (
+    containment *out, const GPlane<T> *planes, std::size_t k,
+    const GBoxP<T, W> *boxes, std::size_t n
+) {
+    std::size_t visible { 0 };
+    int outside, inside;
+
+    for (std::size_t i = 0;  i < n;  i += W) {
+        classify(outside, inside, planes, k, boxes[i / W]);
+        visible += store_containment(
+            out + i, std::min(W, n - i), outside, inside
+        );
+    }
+    return visible;
+}
+
+
+
+
+/**
+ *  Test "n" boxes against "k" planes, "W" boxes at a time
+ *  (results equal to GAABB::classify). Boxes are converted
+ *  to packets on the fly - for boxes tested repeatedly prefer
+ *  the prepared variant above. Returns the number of boxes
+ *  not outside.
+ */
+template <typename T, std::size_t W = native_width<T>::value>
+std::size_t classify (
+    containment *out, const GPlane<T> *planes, std::size_t k,
+    const GAABB<T> *boxes, std::size_t n
+) {
+    std::size_t i { 0 }, visible { 0 };
+    int outside, inside;
+
+    for (;  i + W <= n;  i += W) {
+        classify(
+            outside, inside, planes, k, GBoxP<T, W>::gather(boxes + i, W)
+        );
+        visible += store_containment(out + i, W, outside, inside);
+    }
+
+    for (;  i < n;  i++) {
+        out[i] = boxes[i].classify(planes, k);
+        visible += out[i] != containment::outside;
+    }
+    return visible;
+}
+
+
+
+
+/**
+ *  Test "n" spheres against "k" planes (unit normals), "W" spheres
+ *  at a time (results equal to GSphere::classify). Returns
+ *  the number of spheres not outside.
+ */
+template <typename T, std::size_t W = native_width<T>::value>
+std::size_t classify (
+    containment *out, const GPlane<T> *planes, std::size_t k,
+    const GSphere<T> *spheres, std::size_t n
+) {
+    using packet = GPacket<T, W>;
+    const packet zero { static_cast<T>(0) };
+    std::size_t i { 0 }, visible { 0 };
+
+    for (;  i + W <= n;  i += W) {
+        T lanes[4][W];
+        for (std::size_t j = 0;  j < W;  j++) {
+            for (std::size_t a = 0;  a < 3;  a++) {
+                lanes[a][j] = spheres[i + j].center[a];
+            }
+            lanes[3][j] = spheres[i + j].radius;
+        }
+        const GVector3P<T, W> c {
+            packet::load(lanes[0]), packet::load(lanes[1]),
+            packet::load(lanes[2])
+        };
+        const packet r { packet::load(lanes[3]) };
+
+        // smallest "s + r" and "s - r" over all planes
+        packet
+            outer { std::numeric_limits<T>::infinity() },
+            inner { std::numeric_limits<T>::infinity() };
+        for (std::size_t p = 0;  p < k;  p++) {
+            const GPlane<T> &plane { planes[p] };
+            const packet s {
+                c.x * packet(plane.normal[0]) +
+                c.y * packet(plane.normal[1]) +
+                c.z * packet(plane.normal[2]) + packet(plane.d)
+            };
+            outer = min(outer, s + r);
+            inner = min(inner, s - r);
+        }
+
+        visible += store_containment(out + i, W,
+            ((outer < zero) | (r < zero)).bits(), (inner >= zero).bits()
+        );
+    }
+
+    for (;  i < n;  i++) {
+        out[i] = spheres[i].classify(planes, k);
+        visible += out[i] != containment::outside;
+    }
+    return visible;
+}
+
+
+
+
+/**
+ *  View frustum: six planes (left, right, bottom, top, near, far)
+ *  facing inwards, extracted from a clip (projection * view
+ *  [* model]) matrix. Volumes are tested in the space the matrix
+ *  maps from (world space for a view-projection matrix).
+ */
+template <typename T>
+class GFrustum {
+
+public:
+
+    GPlane<T> planes[6];
+
+
+    /**
+     *  ...
+     */
+    constexpr GFrustum () {}
+
+
+    /**
+     *  Planes of a clip matrix (-w <= x, y, z <= w), normalized.
+     */
+    inline explicit GFrustum (const GArray<T, 4*4> &m) {
+        #define row(r, c) m[(c)*4 + (r)]
+        for (std::size_t i = 0;  i < 3;  i++) {
+            this->planes[i*2] = GPlane<T>(
+                row(3, 0) + row(i, 0), row(3, 1) + row(i, 1),
+                row(3, 2) + row(i, 2), row(3, 3) + row(i, 3)
+            ).normalize();
+            this->planes[i*2 + 1] = GPlane<T>(
+                row(3, 0) - row(i, 0), row(3, 1) - row(i, 1),
+                row(3, 2) - row(i, 2), row(3, 3) - row(i, 3)
+            ).normalize();
+        }
+        #undef row
+    }
+
+
+    /**
+     *  Point containment.
+     */
+    inline bool contains (const GArray<T, 3> &p) const {
+        for (const GPlane<T> &plane : this->planes) {
+            if (plane.distance(p) < static_cast<T>(0)) { return false; }
+        }
+        return true;
+    }
+
+
+    /**
+     *  Test a single volume.
+     */
+    inline containment classify (const GAABB<T> &b) const {
+        return b.classify(this->planes, 6);
+    }
+
+
+    inline containment classify (const GSphere<T> &s) const {
+        return s.classify(this->planes, 6);
+    }
+
+
+    inline containment classify (const GOBB<T> &b) const {
+        return b.classify(this->planes, 6);
+    }
+
+
+    /**
+     *  Test "n" volumes (packet batch), returns the number
+     *  of volumes not outside.
+     */
+    inline std::size_t classify (
+        containment *out, const GAABB<T> *boxes, std::size_t n
+    ) const {
+        return m3d::classify(out, this->planes, 6, boxes, n);
+    }
+
+
+    inline std::size_t classify (
+        containment *out, const GSphere<T> *spheres, std::size_t n
+    ) const {
+        return m3d::classify(out, this->planes, 6, spheres, n);
+    }
+
+
+    template <std::size_t W>
+    inline std::size_t classify (
+        containment *out, const GBoxP<T, W> *boxes, std::size_t n
+    ) const {
+        return m3d::classify(out, this->planes, 6, boxes, n);
+    }
+
+};
+
+
+
+
+} // namespace m3d
+
+#endif
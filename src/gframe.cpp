@@ -60,22 +60,50 @@ GFrame<T>& GFrame<T>::normalize () {
 
 
 /**
- *  Assemble the transformation matrix.
+ *  Orientation of this frame of reference
+ *  (the default frame maps -x to "right", y to "up" and -z to "forward").
  */
 template <typename T>
-typename GFrame<T>::mat4 GFrame<T>::get_transformation_matrix () const {
+typename GFrame<T>::quat GFrame<T>::get_orientation () const {
+    return quat().load_from_axes(
+        vec3().cross(this->forward, this->up),
+        this->up,
+        vec3(this->forward).flip()
+    );
+}
+
+
+
+
+/**
+ *  Replace "up" and "forward" vectors with the ones of a given orientation.
+ */
+template <typename T>
+GFrame<T>& GFrame<T>::set_orientation (const quat &q) {
+    this->up = q.rotate(vec3(0, 1, 0));
+    this->forward = q.rotate(vec3(0, 0, -1));
+    return *this;
+}
+
+
+
+
+/**
+ *  Assemble the transformation.
+ */
+template <typename T>
+typename GFrame<T>::affine GFrame<T>::get_transformation () const {
     vec3 right { vec3().cross(this->up, this->forward) };
-    mat4 m;
+    affine m;
 
     #define set(i, val) m[i] = val
     #define up this->up
     #define forward this->forward
     #define origin this->origin
 
-    set(0, right[0]);  set(4, up[0]);  set( 8, forward[0]);  set(12, origin[0]);
-    set(1, right[1]);  set(5, up[1]);  set( 9, forward[1]);  set(13, origin[1]);
-    set(2, right[2]);  set(6, up[2]);  set(10, forward[2]);  set(14, origin[2]);
-    set(3,     (T)0);  set(7,  (T)0);  set(11,       (T)0);  set(15,      (T)1);
+    set(0, right[0]);  set(3, up[0]);  set(6, forward[0]);  set( 9, origin[0]);
+    set(1, right[1]);  set(4, up[1]);  set(7, forward[1]);  set(10, origin[1]);
+    set(2, right[2]);  set(5, up[2]);  set(8, forward[2]);  set(11, origin[2]);
 
     #undef origin
     #undef forward
@@ -89,28 +117,53 @@ typename GFrame<T>::mat4 GFrame<T>::get_transformation_matrix () const {
 
 
 /**
- *  Assemble the view matrix.
+ *  Assemble the transformation matrix.
  */
 template <typename T>
-typename GFrame<T>::mat4 GFrame<T>::get_view_matrix () const {
+typename GFrame<T>::mat4 GFrame<T>::get_transformation_matrix () const {
+    return this->get_transformation().get_matrix();
+}
+
+
+
+
+/**
+ *  Assemble the view transformation
+ *  (rotation followed by the rotated, negated origin).
+ */
+template <typename T>
+typename GFrame<T>::affine GFrame<T>::get_view () const {
     vec3
         forward { vec3(this->forward).flip() },
         right { vec3().cross(this->up, forward) },
         origin { vec3(this->origin).flip() };
-    mat4 rotation;
+    affine view;
 
-    #define set(i, val) rotation[i] = val
+    #define set(i, val) view[i] = val
     #define up this->up
 
-    set(0,   right[0]);  set(4,   right[1]);  set( 8,   right[2]);  set(12, (T)0);
-    set(1,      up[0]);  set(5,      up[1]);  set( 9,      up[2]);  set(13, (T)0);
-    set(2, forward[0]);  set(6, forward[1]);  set(10, forward[2]);  set(14, (T)0);
-    set(3,       (T)0);  set(7,       (T)0);  set(11,       (T)0);  set(15, (T)1);
+    set(0,   right[0]);  set(3,   right[1]);  set(6,   right[2]);
+    set(1,      up[0]);  set(4,      up[1]);  set(7,      up[2]);
+    set(2, forward[0]);  set(5, forward[1]);  set(8, forward[2]);
 
     #undef up
     #undef set
 
-    return rotation * mat4().load_translation(origin);
+    const vec3 t { view.transform_direction(origin) };
+    view[9] = t[0];  view[10] = t[1];  view[11] = t[2];
+
+    return view;
+}
+
+
+
+
+/**
+ *  Assemble the view matrix.
+ */
+template <typename T>
+typename GFrame<T>::mat4 GFrame<T>::get_view_matrix () const {
+    return this->get_view().get_matrix();
 }
 
 
@@ -130,6 +183,27 @@ GFrame<T>& GFrame<T>::rebuild_from_matrix (const mat4 m) {
 
 
 
+/**
+ *  Rebuild this frame of reference as orbiting a given target.
+ */
+template <typename T>
+GFrame<T>& GFrame<T>::rebuild_orbit (
+    const vec3 &target, T dist, T yaw, T pitch
+) {
+    T sy { 0 }, cy { 1 }, sp { 0 }, cp { 1 };
+    sincos(radians(yaw), sy, cy);
+    sincos(radians(pitch), sp, cp);
+    const vec3 back { cp*sy, -sp, cp*cy };
+    this->origin = target + back * dist;
+    this->up.assign(sp*sy, cp, sp*cy);
+    this->forward = back;
+    this->forward.flip();
+    return *this;
+}
+
+
+
+
 /**
  *  Transform this frame of reference by the given matrix.
  */
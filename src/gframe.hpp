@@ -11,6 +11,16 @@
 #define __GFRAME_HPP_ 1
 
 #include "m3d.hpp"
+#include "gquaternion.hpp"
+#include "gaffine.hpp"
+
+/**
+ *  GFrame rotations are performed with quaternions
+ *  unless built with M3D_FRAME_QUATERNIONS=0 (4x4 rotation matrices).
+ */
+#if !defined(M3D_FRAME_QUATERNIONS)
+#define M3D_FRAME_QUATERNIONS 1
+#endif
 
 namespace m3d {
 
@@ -26,6 +36,8 @@ class GFrame {
     using vec3 = GVector3<T>;
     using vec4 = GVector4<T>;
     using mat4 = GMatrix4<T>;
+    using quat = GQuaternion<T>;
+    using affine = GAffine<T>;
 
 
 public:
@@ -123,14 +135,28 @@ public:
     }
 
 
+    /**
+     *  Rotate this frame of reference by a given (unit) quaternion.
+     */
+    inline GFrame<T>& rotate (const quat &q) {
+        this->up = q.rotate(this->up);
+        this->forward = q.rotate(this->forward);
+        return *this;
+    }
+
+
     /**
      *  Rotate this frame of reference in the world coordinates.
      */
     inline GFrame<T>& rotate_world (T angle, T x, T y, T z) {
+#if M3D_FRAME_QUATERNIONS
+        return this->rotate(quat().load_rotation(angle, x, y, z));
+#else
         mat4 rotation { mat4().load_rotation(angle, x, y, z) };
         this->up = rotation * vec4(this->up, 0);
         this->forward = rotation * vec4(this->forward, 0);
         return *this;
+#endif
     }
 
 
@@ -158,33 +184,56 @@ public:
      *  Rotate this frame of reference in the local coordinates.
      */
     inline GFrame<T>& rotate_local_x (T angle) {
+#if M3D_FRAME_QUATERNIONS
+        return this->rotate(quat().load_rotation(
+            angle, vec3().cross(this->up, this->forward)
+        ));
+#else
         mat4 rotation { mat4().load_rotation(
             angle, vec3().cross(this->up, this->forward)
         ) };
         this->up = rotation * vec4(this->up, 0);
         this->forward = rotation * vec4(this->forward, 0);
         return *this;
+#endif
     }
 
 
     inline GFrame<T>& rotate_local_y (T angle) {
+#if M3D_FRAME_QUATERNIONS
+        this->forward =
+            quat().load_rotation(angle, this->up).rotate(this->forward);
+#else
         this->forward =
             mat4().load_rotation(angle, this->up) * vec4(this->forward, 0);
+#endif
         return *this;
     }
 
 
     inline GFrame<T>& rotate_local_z (T angle) {
+#if M3D_FRAME_QUATERNIONS
+        this->up =
+            quat().load_rotation(angle, this->forward).rotate(this->up);
+#else
         this->up =
             mat4().load_rotation(angle, this->forward) * vec4(this->up, 0);
+#endif
         return *this;
     }
 
 
     inline GFrame<T>& rotate_local (T angle, const vec3 &v) {
+#if M3D_FRAME_QUATERNIONS
+        return this->rotate_world(angle, vec3(
+            vec3().cross(this->up, this->forward) * v[0] +
+            this->up * v[1] + this->forward * v[2]
+        ));
+#else
         return this->rotate_world(angle, vec3(
             this->get_transformation_matrix() * vec4(v, 0)
         ));
+#endif
     }
 
 
@@ -194,14 +243,28 @@ public:
 
 
     /**
-     *  Assemble the transformation matrix.
+     *  Orientation of this frame of reference - rotation taking
+     *  the default frame ("up" = +y, "forward" = -z) to this one.
+     *  Accumulating rotations in a quaternion (renormalized now and
+     *  then) and applying it with "set_orientation" keeps the frame
+     *  free of drift.
+     */
+    quat get_orientation () const;
+    GFrame<T>& set_orientation (const quat &);
+
+
+    /**
+     *  Assemble the transformation (as affine transformation or 4x4 matrix).
      */
+    affine get_transformation () const;
     mat4 get_transformation_matrix () const;
 
 
     /**
-     *  Assemble the view matrix.
+     *  Assemble the view transformation (inverse of the transformation
+     *  with "forward" mapped to -z) as affine transformation or 4x4 matrix.
      */
+    affine get_view () const;
     mat4 get_view_matrix () const;
 
 
@@ -211,6 +274,15 @@ public:
     GFrame<T>& rebuild_from_matrix (const mat4);
 
 
+    /**
+     *  Rebuild this frame of reference as orbiting a given target
+     *  (closed form of "translation(target) * rotation_y(yaw) *
+     *  rotation_x(pitch) * translation(0, 0, dist)" basis, angles
+     *  in degrees).
+     */
+    GFrame<T>& rebuild_orbit (const vec3 &, T, T, T);
+
+
     /**
      *  Transform this frame of reference by the given matrix.
      */
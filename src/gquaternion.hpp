@@ -0,0 +1,294 @@
+/**
+ *  machina
+ *
+ *  Copyright (c) 2015, drmats
+ *  All rights reserved.
+ *
+ *  https://github.com/drmats/machina
+ */
+
+#ifndef __GQUATERNION_HPP_
+#define __GQUATERNION_HPP_ 1
+
+#include "m3d.hpp"
+
+namespace m3d {
+
+
+
+
+/**
+ *  Rotation quaternion stored as [x, y, z, w]
+ *  (vector part first, scalar part last).
+ *  Angles are given in degrees (as in GMatrix4::load_rotation).
+ *  "q * r" composes rotations in the same order as matrices:
+ *  (q * r).rotate(v) == q.rotate(r.rotate(v)).
+ */
+template <typename T>
+class GQuaternion : public GVector<T, 4> {
+
+    using vec3 = GVector3<T>;
+
+
+public:
+
+    /**
+     *  Identity quaternion.
+     */
+    constexpr GQuaternion () { this->load_identity(); }
+
+
+    /**
+     *  ...
+     */
+    constexpr GQuaternion (T x, T y, T z, T w) { this->assign(x, y, z, w); }
+    constexpr GQuaternion (const GArray<T, 4> &a) { GArray<T, 4>::assign(a); }
+    template <typename E>
+    constexpr GQuaternion (const GExpr<E, T, 4> &e) { GArray<T, 4>::assign(e); }
+
+
+    /**
+     *  ...
+     */
+    using GArray<T, 4>::operator=;
+
+
+    /**
+     *  ...
+     */
+    using GArray<T, 4>::assign;
+
+
+    /**
+     *  ...
+     */
+    constexpr GQuaternion<T>& assign (T x, T y, T z, T w) {
+        #define set(i, v) this->data[i] = v
+        set(0, x); set(1, y); set(2, z); set(3, w);
+        #undef set
+        return *this;
+    }
+
+
+    /**
+     *  Replace quaternion with identity (no rotation).
+     */
+    constexpr GQuaternion<T>& load_identity () {
+        return this->assign(
+            static_cast<T>(0), static_cast<T>(0),
+            static_cast<T>(0), static_cast<T>(1)
+        );
+    }
+
+
+    /**
+     *  Replace quaternion with the rotation about a given axis
+     *  (axis doesn't have to be of unit length).
+     */
+    inline GQuaternion<T>& load_rotation (T angle, T x, T y, T z) {
+        T s { static_cast<T>(0) }, c { static_cast<T>(1) };
+        sincos(radians(angle) * static_cast<T>(0.5), s, c);
+        vec3 v { x, y, z };  v.normalize();
+        return this->assign(v[0]*s, v[1]*s, v[2]*s, c);
+    }
+
+
+    /**
+     *  Replace quaternion with the rotation about a given axis
+     *  (fast, approximate sine and cosine - see "fast_sincos").
+     */
+    inline GQuaternion<T>& load_rotation_fast (T angle, T x, T y, T z) {
+        T s { static_cast<T>(0) }, c { static_cast<T>(1) };
+        fast_sincos(radians(angle) * static_cast<T>(0.5), s, c);
+        vec3 v { x, y, z };  v.normalize();
+        return this->assign(v[0]*s, v[1]*s, v[2]*s, c);
+    }
+
+
+    /**
+     *  Replace quaternion with the rotation about a given axis.
+     */
+    inline GQuaternion<T>& load_rotation (T angle, const GArray<T, 3> &v) {
+        return this->load_rotation(angle, v[0], v[1], v[2]);
+    }
+
+
+    /**
+     *  Replace quaternion with the rotation mapping unit vectors
+     *  of x, y and z axes to the given (orthonormal) vectors.
+     */
+    inline GQuaternion<T>& load_from_axes (
+        const GArray<T, 3> &x, const GArray<T, 3> &y, const GArray<T, 3> &z
+    ) {
+        const T
+            one { static_cast<T>(1) },
+            quarter { static_cast<T>(0.25) },
+            trace { x[0] + y[1] + z[2] };
+        T s { static_cast<T>(0) };
+
+        if (trace > static_cast<T>(0)) {
+            s = static_cast<T>(0.5) / std::sqrt(trace + one);
+            this->assign(
+                (y[2] - z[1]) * s, (z[0] - x[2]) * s, (x[1] - y[0]) * s,
+                quarter / s
+            );
+        } else if (x[0] > y[1]  &&  x[0] > z[2]) {
+            s = static_cast<T>(0.5) / std::sqrt(one + x[0] - y[1] - z[2]);
+            this->assign(
+                quarter / s, (y[0] + x[1]) * s, (z[0] + x[2]) * s,
+                (y[2] - z[1]) * s
+            );
+        } else if (y[1] > z[2]) {
+            s = static_cast<T>(0.5) / std::sqrt(one + y[1] - x[0] - z[2]);
+            this->assign(
+                (y[0] + x[1]) * s, quarter / s, (z[1] + y[2]) * s,
+                (z[0] - x[2]) * s
+            );
+        } else {
+            s = static_cast<T>(0.5) / std::sqrt(one + z[2] - x[0] - y[1]);
+            this->assign(
+                (z[0] + x[2]) * s, (z[1] + y[2]) * s, quarter / s,
+                (x[1] - y[0]) * s
+            );
+        }
+        return *this;
+    }
+
+
+    /**
+     *  Replace quaternion with the rotation part of a given
+     *  (column-major, rotation-only upper 3x3) matrix.
+     */
+    inline GQuaternion<T>& load_from_matrix (const GArray<T, 4*4> &m) {
+        return this->load_from_axes(
+            vec3(m[0], m[1], m[2]), vec3(m[4], m[5], m[6]),
+            vec3(m[8], m[9], m[10])
+        );
+    }
+
+
+    /**
+     *  Compose two rotations and store the result in the current
+     *  quaternion ("a" and "b" may refer to it).
+     */
+    constexpr GQuaternion<T>& multiply (
+        const GArray<T, 4> &a, const GArray<T, 4> &b
+    ) {
+        const T
+            ax { a[0] }, ay { a[1] }, az { a[2] }, aw { a[3] },
+            bx { b[0] }, by { b[1] }, bz { b[2] }, bw { b[3] };
+        return this->assign(
+            aw*bx + ax*bw + ay*bz - az*by,
+            aw*by - ax*bz + ay*bw + az*bx,
+            aw*bz + ax*by - ay*bx + az*bw,
+            aw*bw - ax*bx - ay*by - az*bz
+        );
+    }
+
+
+    /**
+     *  Replace quaternion with its conjugate
+     *  (inverse rotation for unit quaternions).
+     */
+    constexpr GQuaternion<T>& conjugate () {
+        for (std::size_t i = 0;  i < 3;  i++) {
+            this->data[i] = -this->data[i];
+        }
+        return *this;
+    }
+
+
+    /**
+     *  Rotate a given vector (quaternion has to be of unit length):
+     *  v' = v + w*t + u x t, where t = 2 * (u x v), u = [x, y, z].
+     */
+    constexpr vec3 rotate (const GArray<T, 3> &v) const {
+        const vec3
+            u { this->data[0], this->data[1], this->data[2] },
+            t { vec3().cross(u, v) * static_cast<T>(2) };
+        return v + t * this->data[3] + vec3().cross(u, t);
+    }
+
+
+    /**
+     *  Normalized linear interpolation along the shorter arc
+     *  (result is stored in the current quaternion).
+     */
+    inline GQuaternion<T>& nlerp (
+        const GArray<T, 4> &a, const GArray<T, 4> &b, T t
+    ) {
+        GQuaternion<T> e { b };
+        if (GVector<T, 4>(a).dot(b) < static_cast<T>(0)) { e.flip(); }
+        this->assign(a * (static_cast<T>(1) - t) + e * t);
+        this->normalize();
+        return *this;
+    }
+
+
+    /**
+     *  Spherical linear interpolation along the shorter arc
+     *  (result is stored in the current quaternion).
+     *  Falls back to "nlerp" for (almost) identical rotations.
+     */
+    inline GQuaternion<T>& slerp (
+        const GArray<T, 4> &a, const GArray<T, 4> &b, T t
+    ) {
+        GQuaternion<T> e { b };
+        T d { GVector<T, 4>(a).dot(b) };
+        if (d < static_cast<T>(0)) { e.flip();  d = -d; }
+        if (d > static_cast<T>(1) - static_cast<T>(m3d_epsilon)) {
+            return this->nlerp(a, e, t);
+        }
+        const T
+            theta { std::acos(d) },
+            s { static_cast<T>(1) / std::sin(theta) };
+        this->assign(
+            a * (std::sin((static_cast<T>(1) - t) * theta) * s) +
+            e * (std::sin(t * theta) * s)
+        );
+        return *this;
+    }
+
+
+    /**
+     *  Build the equivalent rotation matrix.
+     */
+    constexpr GMatrix4<T> get_matrix () const {
+        const T
+            x { this->data[0] }, y { this->data[1] },
+            z { this->data[2] }, w { this->data[3] },
+            one { static_cast<T>(1) }, two { static_cast<T>(2) },
+            xx { two*x*x }, yy { two*y*y }, zz { two*z*z },
+            xy { two*x*y }, xz { two*x*z }, yz { two*y*z },
+            wx { two*w*x }, wy { two*w*y }, wz { two*w*z },
+            zero { static_cast<T>(0) };
+
+        return GMatrix4<T> {
+            one - yy - zz,        xy + wz,        xz - wy,  zero,
+                  xy - wz,  one - xx - zz,        yz + wx,  zero,
+                  xz + wy,        yz - wx,  one - xx - yy,  zero,
+                     zero,           zero,           zero,  one
+        };
+    }
+
+};
+
+
+
+
+/**
+ *  Compose two rotations yielding the new quaternion.
+ */
+template <typename T>
+constexpr GQuaternion<T> operator* (
+    const GQuaternion<T> &a, const GQuaternion<T> &b
+) {
+    return GQuaternion<T>().multiply(a, b);
+}
+
+
+
+
+} // namespace m3d
+
+#endif
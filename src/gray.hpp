@@ -0,0 +1,540 @@
+/**
+ *  machina
+ *
+ *  Copyright (c) 2015, drmats
+ *  All rights reserved.
+ *
+ *  https://github.com/drmats/machina
+ */
+
+#ifndef __GRAY_HPP_
+#define __GRAY_HPP_ 1
+
+#include "m3d.hpp"
+#include "m3d_packet.hpp"
+#include "m3d_storage.hpp"
+#include "gbounds.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace m3d {
+
+
+
+
+/**
+ *  Ray: points "origin + t*direction" for t >= 0.
+ */
+template <typename T>
+class GRay {
+
+    using vec3 = GVector3<T>;
+
+
+public:
+
+    vec3 origin, direction;
+
+
+    /**
+     *  ...
+     */
+    constexpr GRay ():
+        origin { static_cast<T>(0), static_cast<T>(0), static_cast<T>(0) },
+        direction {
+            static_cast<T>(0), static_cast<T>(0), static_cast<T>(-1)
+        } {}
+    constexpr GRay (const GArray<T, 3> &origin, const GArray<T, 3> &direction):
+        origin { origin }, direction { direction } {}
+
+
+    /**
+     *  Point at a given distance (in "direction" lengths).
+     */
+    constexpr vec3 at (T t) const {
+        return vec3(this->origin + this->direction * t);
+    }
+
+
+    /**
+     *  Component-wise reciprocal of the direction (for slab tests,
+     *  zero components become infinities).
+     */
+    constexpr vec3 inv_direction () const {
+        return vec3(
+            static_cast<T>(1) / this->direction[0],
+            static_cast<T>(1) / this->direction[1],
+            static_cast<T>(1) / this->direction[2]
+        );
+    }
+
+
+    /**
+     *  Ray transformed by a matrix (direction is not renormalized,
+     *  so hit distances are the same in both spaces).
+     */
+    inline GRay<T> transformed (const GArray<T, 4*4> &m) const {
+        return this->transformed_columns<4>(*m);
+    }
+
+
+    inline GRay<T> transformed (const GArray<T, 3*4> &a) const {
+        return this->transformed_columns<3>(*a);
+    }
+
+
+private:
+
+    /**
+     *  Transformation by column-major matrix with "S" rows.
+     */
+    template <std::size_t S>
+    inline GRay<T> transformed_columns (const T *m) const {
+        vec3 o, d;
+        for (std::size_t i = 0;  i < 3;  i++) {
+            d[i] =
+                m[i]*this->direction[0] + m[i + S]*this->direction[1] +
+                m[i + 2*S]*this->direction[2];
+            o[i] =
+                m[i]*this->origin[0] + m[i + S]*this->origin[1] +
+                m[i + 2*S]*this->origin[2] + m[i + 3*S];
+        }
+        return GRay<T>(o, d);
+    }
+
+};
+
+
+
+
+/**
+ *  Closest hit found so far: distance along the ray ("t", hits
+ *  farther away are rejected), barycentric coordinates "u", "v"
+ *  of the hit point (weights of the second and third vertex)
+ *  and triangle index.
+ */
+template <typename T>
+struct GRayHit {
+
+    T t { std::numeric_limits<T>::infinity() };
+    T u { static_cast<T>(0) }, v { static_cast<T>(0) };
+    std::size_t index { std::numeric_limits<std::size_t>::max() };
+
+
+    /**
+     *  Was anything hit?
+     */
+    constexpr bool valid () const {
+        return this->index != std::numeric_limits<std::size_t>::max();
+    }
+
+};
+
+
+
+
+/**
+ *  Ray through a window point ("x" to the right, "y" downwards,
+ *  in pixels, as in SDL mouse events) of a "width" x "height"
+ *  viewport, for a clip (projection * view) matrix. Origin lies
+ *  on the near plane, direction is normalized. Throws
+ *  std::domain_error for singular matrices.
+ */
+template <typename T>
+inline GRay<T> unproject (
+    const GArray<T, 4*4> &clip, T x, T y, T width, T height
+) noexcept(false) {
+    using vec3 = GVector3<T>;
+    using vec4 = GVector4<T>;
+    GMatrix4<T> inv { clip };
+    inv.inverse();
+    const T
+        nx { static_cast<T>(2) * x / width - static_cast<T>(1) },
+        ny { static_cast<T>(1) - static_cast<T>(2) * y / height };
+    const vec4
+        n { inv * vec4(nx, ny, static_cast<T>(-1), static_cast<T>(1)) },
+        f { inv * vec4(nx, ny, static_cast<T>(1), static_cast<T>(1)) };
+    const vec3
+        a { n[0] / n[3], n[1] / n[3], n[2] / n[3] },
+        b { f[0] / f[3], f[1] / f[3], f[2] / f[3] };
+    return GRay<T>(a, vec3(b - a).normalize());
+}
+
+
+
+
+/**
+ *  Ray - triangle test (Moller-Trumbore, both faces). On a hit
+ *  closer than "hit.t" its distance and barycentrics are stored
+ *  ("hit.index" is left for the caller).
+ */
+template <typename T>
+inline bool intersect (
+    const GRay<T> &r,
+    const GArray<T, 3> &v0, const GArray<T, 3> &v1, const GArray<T, 3> &v2,
+    GRayHit<T> &hit
+) {
+    using vec3 = GVector3<T>;
+    const vec3
+        e1 { v1 - v0 }, e2 { v2 - v0 },
+        p { vec3().cross(r.direction, e2) };
+    const T det { e1.dot(p) };
+    if (det == static_cast<T>(0)) { return false; }
+
+    const T inv_det { static_cast<T>(1) / det };
+    const vec3 s { r.origin - v0 };
+    const T u { s.dot(p) * inv_det };
+    if (u < static_cast<T>(0)  ||  u > static_cast<T>(1)) { return false; }
+
+    const vec3 q { vec3().cross(s, e1) };
+    const T v { r.direction.dot(q) * inv_det };
+    if (v < static_cast<T>(0)  ||  u + v > static_cast<T>(1)) { return false; }
+
+    const T t { e2.dot(q) * inv_det };
+    if (t < static_cast<T>(0)  ||  t >= hit.t) { return false; }
+
+    hit.t = t;  hit.u = u;  hit.v = v;
+    return true;
+}
+
+
+
+
+/**
+ *  Ray - box test (slabs), "inv_direction" is "r.inv_direction()".
+ *  On a hit within [0, t_max) the entry distance is stored
+ *  in "t_enter" (zero for origins inside the box).
+ */
+template <typename T>
+inline bool intersect (
+    const GRay<T> &r, const GArray<T, 3> &inv_direction, const GAABB<T> &b,
+    T &t_enter, T t_max = std::numeric_limits<T>::infinity()
+) {
+    if (b.empty()) { return false; }
+    T t_near { static_cast<T>(0) }, t_far { t_max };
+    for (std::size_t i = 0;  i < 3;  i++) {
+        const T
+            t0 { (b.min[i] - r.origin[i]) * inv_direction[i] },
+            t1 { (b.max[i] - r.origin[i]) * inv_direction[i] };
+        t_near = std::max(t_near, std::min(t0, t1));
+        t_far = std::min(t_far, std::max(t0, t1));
+    }
+    if (t_near > t_far  ||  t_near >= t_max) { return false; }
+    t_enter = t_near;
+    return true;
+}
+
+
+template <typename T>
+inline bool intersect (
+    const GRay<T> &r, const GAABB<T> &b,
+    T &t_enter, T t_max = std::numeric_limits<T>::infinity()
+) {
+    return intersect(r, r.inv_direction(), b, t_enter, t_max);
+}
+
+
+
+
+/**
+ *  W rays (one per lane). Built from a single ray (tested against
+ *  W triangles/boxes) or gathered from W rays (coherent packets).
+ */
+template <typename T, std::size_t W>
+struct GRayP {
+
+    using vec3p = GVector3P<T, W>;
+
+    vec3p origin, direction, inv_direction;
+
+
+    /**
+     *  ...
+     */
+    inline GRayP () {}
+    inline explicit GRayP (const GRay<T> &r):
+        origin { r.origin }, direction { r.direction },
+        inv_direction { r.inv_direction() } {}
+
+
+    /**
+     *  W consecutive rays.
+     */
+    static inline GRayP gather (const GRay<T> *r) {
+        GVector3<T> lanes[3][W];
+        for (std::size_t i = 0;  i < W;  i++) {
+            lanes[0][i] = r[i].origin;
+            lanes[1][i] = r[i].direction;
+            lanes[2][i] = r[i].inv_direction();
+        }
+        GRayP p;
+        p.origin = vec3p::gather(lanes[0]);
+        p.direction = vec3p::gather(lanes[1]);
+        p.inv_direction = vec3p::gather(lanes[2]);
+        return p;
+    }
+
+};
+
+
+
+
+/**
+ *  W triangles (first vertex and two edges per lane).
+ */
+template <typename T, std::size_t W>
+struct GTriangleP {
+
+    using vec3p = GVector3P<T, W>;
+
+    vec3p v0, e1, e2;
+
+
+    /**
+     *  ...
+     */
+    inline GTriangleP () {}
+
+
+    /**
+     *  The same triangle in every lane.
+     */
+    inline GTriangleP (
+        const GArray<T, 3> &v0, const GArray<T, 3> &v1, const GArray<T, 3> &v2
+    ):
+        v0 { v0 }, e1 { GVector3<T>(v1 - v0) }, e2 { GVector3<T>(v2 - v0) } {}
+
+
+    /**
+     *  "n" (at most W) indexed triangles, three indices each
+     *  (as in TriangleBatch source data). Remaining lanes hold
+     *  degenerate triangles, which are never hit.
+     */
+    template <typename I>
+    static inline GTriangleP gather (
+        const GVector3<T> *vertices, const I *indices, std::size_t n
+    ) {
+        using packet = GPacket<T, W>;
+        T lanes[9][W];
+        for (std::size_t i = 0;  i < W;  i++) {
+            for (std::size_t j = 0;  j < 3;  j++) {
+                if (i < n) {
+                    const T a { vertices[indices[i*3]][j] };
+                    lanes[j][i] = a;
+                    lanes[j + 3][i] = vertices[indices[i*3 + 1]][j] - a;
+                    lanes[j + 6][i] = vertices[indices[i*3 + 2]][j] - a;
+                } else {
+                    lanes[j][i] = lanes[j + 3][i] = lanes[j + 6][i] =
+                        static_cast<T>(0);
+                }
+            }
+        }
+        GTriangleP p;
+        #define set(v, k) v = vec3p( \
+            packet::load(lanes[k]), packet::load(lanes[k + 1]), \
+            packet::load(lanes[k + 2]) \
+        )
+        set(p.v0, 0);  set(p.e1, 3);  set(p.e2, 6);
+        #undef set
+        return p;
+    }
+
+};
+
+
+
+
+/**
+ *  W boxes (BVH node children, structure of arrays).
+ */
+template <typename T, std::size_t W>
+struct GAABBP {
+
+    using vec3p = GVector3P<T, W>;
+
+    vec3p min, max;
+
+
+    /**
+     *  ...
+     */
+    inline GAABBP () {}
+
+
+    /**
+     *  The same box in every lane.
+     */
+    inline explicit GAABBP (const GAABB<T> &b): min { b.min }, max { b.max } {}
+
+
+    /**
+     *  "n" (at most W) consecutive boxes, remaining lanes are empty.
+     */
+    static inline GAABBP gather (const GAABB<T> *b, std::size_t n) {
+        GVector3<T> lanes[2][W];
+        for (std::size_t i = 0;  i < W;  i++) {
+            const GAABB<T> box { i < n ? b[i] : GAABB<T>() };
+            lanes[0][i] = box.min;
+            lanes[1][i] = box.max;
+        }
+        GAABBP p;
+        p.min = vec3p::gather(lanes[0]);
+        p.max = vec3p::gather(lanes[1]);
+        return p;
+    }
+
+};
+
+
+
+
+/**
+ *  Packet ray - triangle test (lane-wise results equal to the scalar
+ *  one). Returns the mask of hits within [0, t_max), "t", "u"
+ *  and "v" are meaningful in the masked lanes only.
+ */
+template <typename T, std::size_t W>
+inline GPacketMask<T, W> intersect (
+    const GRayP<T, W> &r, const GTriangleP<T, W> &tri,
+    const GPacket<T, W> &t_max,
+    GPacket<T, W> &t, GPacket<T, W> &u, GPacket<T, W> &v
+) {
+    using packet = GPacket<T, W>;
+    const packet zero { static_cast<T>(0) }, one { static_cast<T>(1) };
+    const GVector3P<T, W> p { cross(r.direction, tri.e2) };
+    const packet det { dot(tri.e1, p) }, inv_det { one / det };
+    const GVector3P<T, W> s { r.origin - tri.v0 }, q { cross(s, tri.e1) };
+    u = dot(s, p) * inv_det;
+    v = dot(r.direction, q) * inv_det;
+    t = dot(tri.e2, q) * inv_det;
+    return
+        (det != zero) & (u >= zero) & (u <= one) &
+        (v >= zero) & (u + v <= one) & (t >= zero) & (t < t_max);
+}
+
+
+
+
+/**
+ *  Packet ray - box test (lane-wise results equal to the scalar
+ *  one). Returns the mask of hits within [0, t_max), "t_enter"
+ *  is meaningful in the masked lanes only. Packet "min"/"max"
+ *  return the second operand on NaN and "std::min"/"std::max" the
+ *  first one, hence the swapped operands - a ray lying in a slab
+ *  plane (0 * inf) ignores that slab on both paths.
+ */
+template <typename T, std::size_t W>
+inline GPacketMask<T, W> intersect (
+    const GRayP<T, W> &r, const GAABBP<T, W> &b,
+    const GPacket<T, W> &t_max, GPacket<T, W> &t_enter
+) {
+    using packet = GPacket<T, W>;
+    packet t_near { static_cast<T>(0) }, t_far { t_max };
+    #define slab(a) { \
+        const packet \
+            t0 { (b.min.a - r.origin.a) * r.inv_direction.a }, \
+            t1 { (b.max.a - r.origin.a) * r.inv_direction.a }; \
+        t_near = max(min(t1, t0), t_near); \
+        t_far = min(max(t1, t0), t_far); \
+    }
+    slab(x)  slab(y)  slab(z)
+    #undef slab
+    t_enter = t_near;
+    return
+        (b.min.x <= b.max.x) & (b.min.y <= b.max.y) & (b.min.z <= b.max.z) &
+        (t_near <= t_far) & (t_near < t_max);
+}
+
+
+
+
+/**
+ *  Pack "n" indexed triangles (three indices each, as in
+ *  TriangleBatch source data) into W-wide packets, e.g. for
+ *  BVH leaves. Triangle "i" lands in lane "i % W" of packet "i / W".
+ */
+template <typename T, std::size_t W = native_width<T>::value, typename I>
+inline aligned_vector<GTriangleP<T, W>> pack_triangles (
+    const GVector3<T> *vertices, const I *indices, std::size_t n
+) {
+    aligned_vector<GTriangleP<T, W>> packets;
+    packets.reserve((n + W - 1) / W);
+    for (std::size_t i = 0;  i < n;  i += W) {
+        packets.push_back(GTriangleP<T, W>::gather(
+            vertices, indices + i*3, std::min(W, n - i)
+        ));
+    }
+    return packets;
+}
+
+
+
+
+/**
+ *  Closest hit of a ray among "n" triangle packets. Updates "hit"
+ *  ("index" is the triangle number, i.e. packet * W + lane)
+ *  and returns true if a closer triangle was found.
+ */
+template <typename T, std::size_t W>
+inline bool intersect (
+    const GRay<T> &r, const GTriangleP<T, W> *packets, std::size_t n,
+    GRayHit<T> &hit
+) {
+    using packet = GPacket<T, W>;
+    const GRayP<T, W> rp { r };
+    packet t_max { hit.t };
+    bool found { false };
+
+    for (std::size_t i = 0;  i < n;  i++) {
+        packet t, u, v;
+        const int bits { intersect(rp, packets[i], t_max, t, u, v).bits() };
+        if (bits == 0) { continue; }
+        for (std::size_t j = 0;  j < W;  j++) {
+            if ((bits >> j) & 1  &&  t[j] < hit.t) {
+                hit.t = t[j];  hit.u = u[j];  hit.v = v[j];
+                hit.index = i*W + j;
+                found = true;
+            }
+        }
+        t_max = packet(hit.t);
+    }
+    return found;
+}
+
+
+
+
+/**
+ *  Closest hit of a ray among "n" indexed triangles, "W" at a time
+ *  (gathered on the fly - prefer "pack_triangles" for repeated
+ *  queries). Updates "hit" ("index" is relative to "indices")
+ *  and returns true if a closer triangle was found.
+ */
+template <typename T, typename I, std::size_t W = native_width<T>::value>
+inline bool intersect (
+    const GRay<T> &r, const GVector3<T> *vertices, const I *indices,
+    std::size_t n, GRayHit<T> &hit
+) {
+    bool found { false };
+    for (std::size_t i = 0;  i < n;  i += W) {
+        const GTriangleP<T, W> p {
+            GTriangleP<T, W>::gather(
+                vertices, indices + i*3, std::min(W, n - i)
+            )
+        };
+        GRayHit<T> h { hit };
+        if (intersect(r, &p, 1, h)) {
+            hit = h;
+            hit.index += i;
+            found = true;
+        }
+    }
+    return found;
+}
+
+
+
+
+} // namespace m3d
+
+#endif
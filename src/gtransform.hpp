@@ -0,0 +1,313 @@
+/**
+ *  machina
+ *
+ *  Copyright (c) 2015, drmats
+ *  All rights reserved.
+ *
+ *  https://github.com/drmats/machina
+ */
+
+#ifndef __GTRANSFORM_HPP_
+#define __GTRANSFORM_HPP_ 1
+
+#include "m3d.hpp"
+#include "gquaternion.hpp"
+#include "gaffine.hpp"
+
+namespace m3d {
+
+
+
+
+/**
+ *  Translation, rotation (unit quaternion) and scale - points
+ *  are mapped as "translation + rotation.rotate(scale * p)",
+ *  i.e. "T * R * S" in matrix terms. Builders mirror the ones
+ *  of GAffine, "a * b" applies "b" first. Composition and inverse
+ *  are exact for uniform scales (non-uniform scale under rotation
+ *  would need a shear, which is dropped). The equivalent matrix
+ *  is written in one closed-form pass.
+ */
+template <typename T>
+class GTransform {
+
+    using vec3 = GVector3<T>;
+    using quat = GQuaternion<T>;
+    using affine = GAffine<T>;
+    using mat4 = GMatrix4<T>;
+
+
+public:
+
+    vec3 translation;
+    quat rotation;
+    vec3 scale;
+
+
+    /**
+     *  Identity transformation.
+     */
+    constexpr GTransform ():
+        translation { static_cast<T>(0), static_cast<T>(0), static_cast<T>(0) },
+        rotation {},
+        scale { static_cast<T>(1), static_cast<T>(1), static_cast<T>(1) } {}
+
+
+    /**
+     *  ...
+     */
+    constexpr GTransform (
+        const GArray<T, 3> &translation, const GArray<T, 4> &rotation,
+        const GArray<T, 3> &scale
+    ):
+        translation { translation }, rotation { rotation }, scale { scale } {}
+
+
+    /**
+     *  Replace current transformation with identity.
+     */
+    constexpr GTransform<T>& load_identity () {
+        const T zero { static_cast<T>(0) }, one { static_cast<T>(1) };
+        this->translation.assign(zero, zero, zero);
+        this->rotation.load_identity();
+        this->scale.assign(one, one, one);
+        return *this;
+    }
+
+
+    /**
+     *  Replace current transformation with the translation.
+     */
+    constexpr GTransform<T>& load_translation (T x, T y, T z) {
+        this->load_identity();
+        this->translation.assign(x, y, z);
+        return *this;
+    }
+
+
+    constexpr GTransform<T>& load_translation (const GArray<T, 3> &v) {
+        return this->load_translation(v[0], v[1], v[2]);
+    }
+
+
+    /**
+     *  Replace current transformation with the scale.
+     */
+    constexpr GTransform<T>& load_scale (T x, T y, T z) {
+        this->load_identity();
+        this->scale.assign(x, y, z);
+        return *this;
+    }
+
+
+    constexpr GTransform<T>& load_scale (const GArray<T, 3> &v) {
+        return this->load_scale(v[0], v[1], v[2]);
+    }
+
+
+    /**
+     *  Replace current transformation with the rotation about
+     *  a given axis (angle in degrees, axis of any length).
+     */
+    inline GTransform<T>& load_rotation (T angle, T x, T y, T z) {
+        this->load_identity();
+        this->rotation.load_rotation(angle, x, y, z);
+        return *this;
+    }
+
+
+    inline GTransform<T>& load_rotation (T angle, const GArray<T, 3> &v) {
+        return this->load_rotation(angle, v[0], v[1], v[2]);
+    }
+
+
+    /**
+     *  Replace current transformation with the rotation about
+     *  a given axis (fast, approximate sine and cosine).
+     */
+    inline GTransform<T>& load_rotation_fast (T angle, T x, T y, T z) {
+        this->load_identity();
+        this->rotation.load_rotation_fast(angle, x, y, z);
+        return *this;
+    }
+
+
+    inline GTransform<T>& load_rotation_fast (T angle, const GArray<T, 3> &v) {
+        return this->load_rotation_fast(angle, v[0], v[1], v[2]);
+    }
+
+
+    /**
+     *  Replace current transformation with the rotation about x, y
+     *  or z axis (no axis normalization, only sine/cosine of the half
+     *  angle are computed). "_fast" variants use "fast_sincos".
+     */
+    #define m3d_transform_axis_rotation(name, sc, i) \
+        inline GTransform<T>& name (T angle) { \
+            T s { static_cast<T>(0) }, c { static_cast<T>(1) }; \
+            sc(radians(angle) * static_cast<T>(0.5), s, c); \
+            this->load_identity(); \
+            this->rotation[i] = s; \
+            this->rotation[3] = c; \
+            return *this; \
+        }
+    m3d_transform_axis_rotation(load_rotation_x, sincos, 0)
+    m3d_transform_axis_rotation(load_rotation_y, sincos, 1)
+    m3d_transform_axis_rotation(load_rotation_z, sincos, 2)
+    m3d_transform_axis_rotation(load_rotation_x_fast, fast_sincos, 0)
+    m3d_transform_axis_rotation(load_rotation_y_fast, fast_sincos, 1)
+    m3d_transform_axis_rotation(load_rotation_z_fast, fast_sincos, 2)
+    #undef m3d_transform_axis_rotation
+
+
+    /**
+     *  Replace current transformation with the rotation
+     *  described by a (unit) quaternion.
+     */
+    constexpr GTransform<T>& load_rotation (const GArray<T, 4> &q) {
+        this->load_identity();
+        this->rotation.assign(q);
+        return *this;
+    }
+
+
+    /**
+     *  Compose two transformations and store the result in the
+     *  current one ("a" applied after "b", "a" and "b" may refer
+     *  to the current transformation).
+     */
+    constexpr GTransform<T>& multiply (
+        const GTransform<T> &a, const GTransform<T> &b
+    ) {
+        const vec3 t { a.transform_point(b.translation) };
+        const T
+            ax { a.rotation[0] }, ay { a.rotation[1] },
+            az { a.rotation[2] }, aw { a.rotation[3] },
+            bx { b.rotation[0] }, by { b.rotation[1] },
+            bz { b.rotation[2] }, bw { b.rotation[3] },
+            sx { a.scale[0] * b.scale[0] },
+            sy { a.scale[1] * b.scale[1] },
+            sz { a.scale[2] * b.scale[2] };
+        this->translation.assign(t);
+        this->rotation.assign(
+            aw*bx + ax*bw + ay*bz - az*by,
+            aw*by - ax*bz + ay*bw + az*bx,
+            aw*bz + ax*by - ay*bx + az*bw,
+            aw*bw - ax*bx - ay*by - az*bz
+        );
+        this->scale.assign(sx, sy, sz);
+        return *this;
+    }
+
+
+    /**
+     *  Transform a point (translation applies).
+     */
+    constexpr vec3 transform_point (const GArray<T, 3> &v) const {
+        const vec3 d { this->transform_direction(v) };
+        return vec3(
+            d[0] + this->translation[0],
+            d[1] + this->translation[1],
+            d[2] + this->translation[2]
+        );
+    }
+
+
+    /**
+     *  Transform a direction (translation doesn't apply):
+     *  v' = v + w*t + u x t, where t = 2 * (u x v), u = [x, y, z]
+     *  (as in GQuaternion::rotate), v scaled first.
+     */
+    constexpr vec3 transform_direction (const GArray<T, 3> &v) const {
+        const T
+            x { this->rotation[0] }, y { this->rotation[1] },
+            z { this->rotation[2] }, w { this->rotation[3] },
+            vx { this->scale[0] * v[0] },
+            vy { this->scale[1] * v[1] },
+            vz { this->scale[2] * v[2] },
+            two { static_cast<T>(2) },
+            tx { two * (y*vz - z*vy) },
+            ty { two * (z*vx - x*vz) },
+            tz { two * (x*vy - y*vx) };
+        return vec3(
+            vx + w*tx + (y*tz - z*ty),
+            vy + w*ty + (z*tx - x*tz),
+            vz + w*tz + (x*ty - y*tx)
+        );
+    }
+
+
+    /**
+     *  Replace current transformation with its inverse
+     *  (throws std::domain_error for zero scales).
+     */
+    inline GTransform<T>& inverse () noexcept(false) {
+        for (std::size_t i = 0;  i < 3;  i++) {
+            if (!std::isnormal(this->scale[i])) {
+                throw std::domain_error(msg::singular_matrix);
+            }
+            this->scale[i] = static_cast<T>(1) / this->scale[i];
+        }
+        this->rotation.conjugate();
+        const vec3 t { this->transform_direction(this->translation) };
+        this->translation.assign(-t[0], -t[1], -t[2]);
+        return *this;
+    }
+
+
+    /**
+     *  Build the equivalent affine transformation
+     *  (rotation matrix with scaled columns, then translation).
+     */
+    constexpr affine get_affine () const {
+        const T
+            x { this->rotation[0] }, y { this->rotation[1] },
+            z { this->rotation[2] }, w { this->rotation[3] },
+            one { static_cast<T>(1) }, two { static_cast<T>(2) },
+            xx { two*x*x }, yy { two*y*y }, zz { two*z*z },
+            xy { two*x*y }, xz { two*x*z }, yz { two*y*z },
+            wx { two*w*x }, wy { two*w*y }, wz { two*w*z },
+            sx { this->scale[0] }, sy { this->scale[1] }, sz { this->scale[2] };
+
+        const T d[3*4] {
+            (one - yy - zz)*sx,        (xy + wz)*sx,        (xz - wy)*sx,
+                  (xy - wz)*sy,  (one - xx - zz)*sy,        (yz + wx)*sy,
+                  (xz + wy)*sz,        (yz - wx)*sz,  (one - xx - yy)*sz,
+            this->translation[0], this->translation[1], this->translation[2]
+        };
+        affine a;
+        a.assign(d);
+        return a;
+    }
+
+
+    /**
+     *  Build the equivalent 4x4 matrix (e.g. for upload).
+     */
+    constexpr mat4 get_matrix () const {
+        return this->get_affine().get_matrix();
+    }
+
+};
+
+
+
+
+/**
+ *  Compose two transformations yielding the new one.
+ */
+template <typename T>
+constexpr GTransform<T> operator* (
+    const GTransform<T> &a, const GTransform<T> &b
+) {
+    GTransform<T> c;
+    c.multiply(a, b);
+    return c;
+}
+
+
+
+
+} // namespace m3d
+
+#endif
@@ -11,12 +11,44 @@
 #define __M3D_HPP_ 1
 
 #include "sdl_opengl.hpp"
-#include <cstring>
 #include <stdexcept>
 #include <ostream>
 #include <cmath>
+#include <cfloat>
 #include <initializer_list>
 #include <string>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define M3D_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX__)
+#define M3D_AVX 1
+#include <immintrin.h>
+#endif
+
+/**
+ *  Compile-time evaluation detection (lets constexpr code skip
+ *  SIMD paths). Without compiler support float 4x4 products cannot
+ *  be evaluated at compile time.
+ */
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define M3D_CONSTANT_EVALUATED 1
+#endif
+#endif
+#if !defined(M3D_CONSTANT_EVALUATED) && defined(__GNUC__) && __GNUC__ >= 9
+#define M3D_CONSTANT_EVALUATED 1
+#endif
+
+#if defined(M3D_CONSTANT_EVALUATED)
+#define m3d_constant_evaluated() __builtin_is_constant_evaluated()
+#else
+#define m3d_constant_evaluated() false
+#endif
 
 namespace m3d {
 
@@ -29,6 +61,7 @@ namespace m3d {
 namespace msg {
 
     const std::string out_of_range { "Index out of range." };
+    const std::string singular_matrix { "Matrix is singular." };
 
 }
 
@@ -67,7 +100,7 @@ inline bool close_to (T a, T b) {
  *  Square root.
  */
 template <typename T>
-inline T sqr (T x) {
+constexpr T sqr (T x) {
     return x * x;
 }
 
@@ -78,7 +111,7 @@ inline T sqr (T x) {
  *  Angle conversion (degrees to radians).
  */
 template <typename T>
-inline T radians (T x) {
+constexpr T radians (T x) {
     return x * static_cast<T>(m3d_pi180);
 }
 
@@ -89,7 +122,7 @@ inline T radians (T x) {
  *  Angle conversion (radians to degrees).
  */
 template <typename T>
-inline T degrees (T x) {
+constexpr T degrees (T x) {
     return x * static_cast<T>(m3d_invpi180);
 }
 
@@ -100,7 +133,7 @@ inline T degrees (T x) {
  *  Linear interpolation.
  */
 template <typename T>
-inline T linear_interpolation (T x1, T x2, T x3, T y1, T y3) {
+constexpr T linear_interpolation (T x1, T x2, T x3, T y1, T y3) {
     return (((x2 - x1) * (y3 - y1)) / (x3 - x1)) + y1;
 }
 
@@ -119,10 +152,598 @@ inline T positive_fmod (T val, T denom) {
 
 
 /**
- *  Base class for Points, Vectors and Matrices.
+ *  Sine and cosine of the same angle (radians) computed together
+ *  (single "sincos" call where the C library provides one).
+ */
+template <typename T>
+inline void sincos (T x, T &s, T &c) {
+    s = std::sin(x);
+    c = std::cos(x);
+}
+
+
+#if defined(__GLIBC__) && defined(_GNU_SOURCE)
+
+inline void sincos (float x, float &s, float &c) { ::sincosf(x, &s, &c); }
+inline void sincos (double x, double &s, double &c) { ::sincos(x, &s, &c); }
+
+#endif
+
+
+
+
+/**
+ *  Constants of the fast sine/cosine approximation:
+ *  "round" is 1.5 * 2^(mantissa bits) (adding and subtracting it
+ *  rounds to the nearest integer), pi/2 is split in three parts
+ *  (Cody-Waite reduction, the first two are exact in few bits).
+ */
+template <typename T>
+struct fast_trig {
+    static constexpr T
+        round { static_cast<T>(6755399441055744.0) },
+        two_over_pi { static_cast<T>(0.63661977236758134307553505349006) },
+        pi2_a { static_cast<T>(1.5703125) },
+        pi2_b { static_cast<T>(4.837512969970703125e-4) },
+        pi2_c { static_cast<T>(7.54978995489188216e-8) };
+};
+
+
+template <>
+struct fast_trig<float> {
+    static constexpr float
+        round { 12582912.0f },
+        two_over_pi { 0.636619772f },
+        pi2_a { 1.5703125f },
+        pi2_b { 4.837512969970703125e-4f },
+        pi2_c { 7.54978995489188216e-8f };
+};
+
+
+
+
+/**
+ *  Fast sine and cosine (radians): reduction to [-pi/4, pi/4]
+ *  and minimax polynomials (degree 7 for sine, 8 for cosine).
+ *  Absolute error (against libm) is below 1e-7 for float |x| <= 8192
+ *  (1e-6 for |x| <= 65536, the reduction loses bits beyond) and
+ *  below 3e-9 for double (the polynomials are float-grade).
+ *  Relies on strict IEEE arithmetic (no "-ffast-math"). Same operations
+ *  as kernels::fast_sincos, so (without FMA contraction) results
+ *  match the vectorized path bit for bit. Where intermediates carry
+ *  excess precision (x87, FLT_EVAL_METHOD != 0) the "round" trick
+ *  does not round, so the quadrant comes from "std::nearbyint" there.
+ *  Input domain: finite x with |x| < 2^31 * pi/2 (NaN, infinities
+ *  and larger magnitudes overflow the quadrant conversion to int).
+ */
+template <typename T>
+constexpr void fast_sincos (T x, T &s, T &c) {
+    const T
+#if defined(FLT_EVAL_METHOD)  &&  FLT_EVAL_METHOD != 0
+        q { static_cast<T>(std::nearbyint(x * fast_trig<T>::two_over_pi)) },
+#else
+        q { (x * fast_trig<T>::two_over_pi + fast_trig<T>::round) -
+            fast_trig<T>::round },
+#endif
+        r { ((x - q * fast_trig<T>::pi2_a) - q * fast_trig<T>::pi2_b) -
+            q * fast_trig<T>::pi2_c },
+        z { r * r },
+        ps { r + r * z * (
+            static_cast<T>(-1.6666654611e-1) + z * (
+                static_cast<T>(8.3321608736e-3) +
+                z * static_cast<T>(-1.9515295891e-4)
+            )
+        ) },
+        pc { static_cast<T>(1) - static_cast<T>(0.5) * z + z * z * (
+            static_cast<T>(4.166664568298827e-2) + z * (
+                static_cast<T>(-1.388731625493765e-3) +
+                z * static_cast<T>(2.443315711809948e-5)
+            )
+        ) };
+    const int n { static_cast<int>(q) };
+    s = (n & 1) ? pc : ps;
+    c = (n & 1) ? ps : pc;
+    if (n & 2) { s = -s; }
+    if ((n + 1) & 2) { c = -c; }
+}
+
+
+
+
+/**
+ *  Column-major NxN matrix product (out = a * b).
+ *  Each element is accumulated in "j" order, starting from zero.
+ */
+template <typename T, std::size_t N>
+constexpr void matrix_multiply_scalar (T *out, const T *a, const T *b) {
+    T val { static_cast<T>(0) };
+    std::size_t row { 0 }, column { 0 };
+    for (std::size_t i = 0;  i < N*N;  i++) {
+        val = static_cast<T>(0);
+        row = i % N;  column = (i / N) * N;
+        for (std::size_t j = 0;  j < N;  j++) {
+            val += a[row + j*N] * b[column + j];
+        }
+        out[i] = val;
+    }
+}
+
+
+
+
+/**
+ *  Column-major NxN matrix by N-vector product (out = m * v).
+ */
+template <typename T, std::size_t N>
+constexpr void matrix_transform_scalar (T *out, const T *m, const T *v) {
+    T val { static_cast<T>(0) };
+    for (std::size_t i = 0;  i < N;  i++) {
+        val = static_cast<T>(0);
+        for (std::size_t j = 0;  j < N;  j++) {
+            val += m[i + j*N] * v[j];
+        }
+        out[i] = val;
+    }
+}
+
+
+
+
+/**
+ *  Matrix product and matrix by vector product entry points
+ *  (specialized below for SIMD-capable types).
  */
 template <typename T, std::size_t N>
-class GArray {
+constexpr void matrix_multiply (T *out, const T *a, const T *b) {
+    matrix_multiply_scalar<T, N>(out, a, b);
+}
+
+
+template <typename T, std::size_t N>
+constexpr void matrix_transform (T *out, const T *m, const T *v) {
+    matrix_transform_scalar<T, N>(out, m, v);
+}
+
+
+
+
+#if defined(M3D_SSE2)
+
+/**
+ *  4x4 float matrix product (SSE2 / AVX).
+ *  Each output column is a linear combination of columns of "a",
+ *  summed in the same order as the generic loop, so results are
+ *  bit-for-bit identical as long as the compiler does not contract
+ *  mul/add pairs into FMA (with "-mfma" both paths may contract,
+ *  which keeps them within 1 ULP per element).
+ *  Both arguments are fully read before "out" is written.
+ *  Constant evaluation takes the scalar path.
+ */
+template <>
+constexpr void matrix_multiply<float, 4> (
+    float *out, const float *a, const float *b
+) {
+    if (m3d_constant_evaluated()) {
+        return matrix_multiply_scalar<float, 4>(out, a, b);
+    }
+#if defined(M3D_AVX)
+    const __m256
+        a0 { _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a)) },
+        a1 { _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 4)) },
+        a2 { _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 8)) },
+        a3 { _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 12)) },
+        b01 { _mm256_loadu_ps(b) },
+        b23 { _mm256_loadu_ps(b + 8) };
+    __m256 r01 { _mm256_setzero_ps() }, r23 { _mm256_setzero_ps() };
+
+    #define mad(r, ac, bc, i) \
+        r = _mm256_add_ps(r, _mm256_mul_ps(ac, _mm256_shuffle_ps(bc, bc, i)))
+    mad(r01, a0, b01, 0x00);  mad(r23, a0, b23, 0x00);
+    mad(r01, a1, b01, 0x55);  mad(r23, a1, b23, 0x55);
+    mad(r01, a2, b01, 0xAA);  mad(r23, a2, b23, 0xAA);
+    mad(r01, a3, b01, 0xFF);  mad(r23, a3, b23, 0xFF);
+    #undef mad
+
+    _mm256_storeu_ps(out, r01);
+    _mm256_storeu_ps(out + 8, r23);
+#else
+    const __m128
+        a0 { _mm_loadu_ps(a) },
+        a1 { _mm_loadu_ps(a + 4) },
+        a2 { _mm_loadu_ps(a + 8) },
+        a3 { _mm_loadu_ps(a + 12) },
+        b0 { _mm_loadu_ps(b) },
+        b1 { _mm_loadu_ps(b + 4) },
+        b2 { _mm_loadu_ps(b + 8) },
+        b3 { _mm_loadu_ps(b + 12) };
+    __m128 r { _mm_setzero_ps() };
+
+    #define column(i, bc) \
+        r = _mm_setzero_ps(); \
+        r = _mm_add_ps(r, _mm_mul_ps(a0, _mm_shuffle_ps(bc, bc, 0x00))); \
+        r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_shuffle_ps(bc, bc, 0x55))); \
+        r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_shuffle_ps(bc, bc, 0xAA))); \
+        r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_shuffle_ps(bc, bc, 0xFF))); \
+        _mm_storeu_ps(out + i*4, r);
+    column(0, b0);  column(1, b1);  column(2, b2);  column(3, b3);
+    #undef column
+#endif
+}
+
+
+
+
+/**
+ *  4x4 float matrix by 4-vector product (SSE2).
+ *  Same summation order (and precision notes) as matrix_multiply.
+ */
+template <>
+constexpr void matrix_transform<float, 4> (
+    float *out, const float *m, const float *v
+) {
+    if (m3d_constant_evaluated()) {
+        return matrix_transform_scalar<float, 4>(out, m, v);
+    }
+    const __m128 vv { _mm_loadu_ps(v) };
+    __m128 r { _mm_setzero_ps() };
+    #define mad(i, s) \
+        r = _mm_add_ps( \
+            r, _mm_mul_ps(_mm_loadu_ps(m + i), _mm_shuffle_ps(vv, vv, s)) \
+        )
+    mad(0, 0x00);  mad(4, 0x55);  mad(8, 0xAA);  mad(12, 0xFF);
+    #undef mad
+    _mm_storeu_ps(out, r);
+}
+
+#endif
+
+
+
+
+/**
+ *  4x4 matrix inverse (cofactor expansion over 2x2 sub-determinants).
+ *  Indexing is symmetric, so it works for column-major storage as is.
+ *  Returns false (leaving "out" untouched) when the determinant
+ *  is zero or not a normal number. "out" may alias "m".
+ */
+template <typename T>
+inline bool matrix_inverse_scalar (T *out, const T *m) {
+    #define a(r, c) m[(r)*4 + (c)]
+    const T
+        s0 { a(0,0)*a(1,1) - a(1,0)*a(0,1) },
+        s1 { a(0,0)*a(1,2) - a(1,0)*a(0,2) },
+        s2 { a(0,0)*a(1,3) - a(1,0)*a(0,3) },
+        s3 { a(0,1)*a(1,2) - a(1,1)*a(0,2) },
+        s4 { a(0,1)*a(1,3) - a(1,1)*a(0,3) },
+        s5 { a(0,2)*a(1,3) - a(1,2)*a(0,3) },
+        c5 { a(2,2)*a(3,3) - a(3,2)*a(2,3) },
+        c4 { a(2,1)*a(3,3) - a(3,1)*a(2,3) },
+        c3 { a(2,1)*a(3,2) - a(3,1)*a(2,2) },
+        c2 { a(2,0)*a(3,3) - a(3,0)*a(2,3) },
+        c1 { a(2,0)*a(3,2) - a(3,0)*a(2,2) },
+        c0 { a(2,0)*a(3,1) - a(3,0)*a(2,1) },
+        det { s0*c5 - s1*c4 + s2*c3 + s3*c2 - s4*c1 + s5*c0 };
+    if (!std::isnormal(det)) {
+        return false;
+    }
+    const T
+        d { static_cast<T>(1) / det },
+        r[4*4] {
+            ( a(1,1)*c5 - a(1,2)*c4 + a(1,3)*c3) * d,
+            (-a(0,1)*c5 + a(0,2)*c4 - a(0,3)*c3) * d,
+            ( a(3,1)*s5 - a(3,2)*s4 + a(3,3)*s3) * d,
+            (-a(2,1)*s5 + a(2,2)*s4 - a(2,3)*s3) * d,
+            (-a(1,0)*c5 + a(1,2)*c2 - a(1,3)*c1) * d,
+            ( a(0,0)*c5 - a(0,2)*c2 + a(0,3)*c1) * d,
+            (-a(3,0)*s5 + a(3,2)*s2 - a(3,3)*s1) * d,
+            ( a(2,0)*s5 - a(2,2)*s2 + a(2,3)*s1) * d,
+            ( a(1,0)*c4 - a(1,1)*c2 + a(1,3)*c0) * d,
+            (-a(0,0)*c4 + a(0,1)*c2 - a(0,3)*c0) * d,
+            ( a(3,0)*s4 - a(3,1)*s2 + a(3,3)*s0) * d,
+            (-a(2,0)*s4 + a(2,1)*s2 - a(2,3)*s0) * d,
+            (-a(1,0)*c3 + a(1,1)*c1 - a(1,2)*c0) * d,
+            ( a(0,0)*c3 - a(0,1)*c1 + a(0,2)*c0) * d,
+            (-a(3,0)*s3 + a(3,1)*s1 - a(3,2)*s0) * d,
+            ( a(2,0)*s3 - a(2,1)*s1 + a(2,2)*s0) * d
+        };
+    #undef a
+    for (std::size_t i = 0;  i < 4*4;  i++) {
+        out[i] = r[i];
+    }
+    return true;
+}
+
+
+
+
+/**
+ *  Matrix inverse entry point (specialized below for SIMD).
+ */
+template <typename T>
+inline bool matrix_inverse (T *out, const T *m) {
+    return matrix_inverse_scalar<T>(out, m);
+}
+
+
+
+
+#if defined(M3D_SSE2)
+
+/**
+ *  4x4 float matrix inverse (SSE2), 2x2 block method:
+ *  with M = [A B; C D] (2x2 blocks kept in single registers,
+ *  "#" denoting the adjugate) the inverse blocks are
+ *  X# = |D|A - B(D#C), Y# = |B|C - D(A#B)#,
+ *  Z# = |C|B - A(D#C)#, W# = |A|D - C(A#B),
+ *  |M| = |A||D| + |B||C| - tr((A#B)(D#C)).
+ *  Columns are treated as rows (the inverse of the transpose is the
+ *  transpose of the inverse), so no transposition is needed.
+ *  Results differ from the scalar path within rounding.
+ */
+template <>
+inline bool matrix_inverse<float> (float *out, const float *m) {
+    #define swizzle(v, x, y, z, w) _mm_shuffle_ps(v, v, _MM_SHUFFLE(w, z, y, x))
+    #define mat2_mul(a, b) \
+        _mm_add_ps( \
+            _mm_mul_ps(a, swizzle(b, 0, 3, 0, 3)), \
+            _mm_mul_ps(swizzle(a, 1, 0, 3, 2), swizzle(b, 2, 1, 2, 1)) \
+        )
+    #define mat2_adj_mul(a, b) \
+        _mm_sub_ps( \
+            _mm_mul_ps(swizzle(a, 3, 3, 0, 0), b), \
+            _mm_mul_ps(swizzle(a, 1, 1, 2, 2), swizzle(b, 2, 3, 0, 1)) \
+        )
+    #define mat2_mul_adj(a, b) \
+        _mm_sub_ps( \
+            _mm_mul_ps(a, swizzle(b, 3, 0, 3, 0)), \
+            _mm_mul_ps(swizzle(a, 1, 0, 3, 2), swizzle(b, 2, 1, 2, 1)) \
+        )
+    const __m128
+        m0 { _mm_loadu_ps(m) },
+        m1 { _mm_loadu_ps(m + 4) },
+        m2 { _mm_loadu_ps(m + 8) },
+        m3 { _mm_loadu_ps(m + 12) },
+        a { _mm_movelh_ps(m0, m1) },
+        b { _mm_movehl_ps(m1, m0) },
+        c { _mm_movelh_ps(m2, m3) },
+        d { _mm_movehl_ps(m3, m2) },
+        det_sub { _mm_sub_ps(
+            _mm_mul_ps(
+                _mm_shuffle_ps(m0, m2, _MM_SHUFFLE(2, 0, 2, 0)),
+                _mm_shuffle_ps(m1, m3, _MM_SHUFFLE(3, 1, 3, 1))
+            ),
+            _mm_mul_ps(
+                _mm_shuffle_ps(m0, m2, _MM_SHUFFLE(3, 1, 3, 1)),
+                _mm_shuffle_ps(m1, m3, _MM_SHUFFLE(2, 0, 2, 0))
+            )
+        ) },
+        det_a { swizzle(det_sub, 0, 0, 0, 0) },
+        det_b { swizzle(det_sub, 1, 1, 1, 1) },
+        det_c { swizzle(det_sub, 2, 2, 2, 2) },
+        det_d { swizzle(det_sub, 3, 3, 3, 3) },
+        d_c { mat2_adj_mul(d, c) },
+        a_b { mat2_adj_mul(a, b) },
+        x { _mm_sub_ps(_mm_mul_ps(det_d, a), mat2_mul(b, d_c)) },
+        w { _mm_sub_ps(_mm_mul_ps(det_a, d), mat2_mul(c, a_b)) },
+        y { _mm_sub_ps(_mm_mul_ps(det_b, c), mat2_mul_adj(d, a_b)) },
+        z { _mm_sub_ps(_mm_mul_ps(det_c, b), mat2_mul_adj(a, d_c)) },
+        tr0 { _mm_mul_ps(a_b, swizzle(d_c, 0, 2, 1, 3)) },
+        tr1 { _mm_add_ps(tr0, swizzle(tr0, 1, 0, 3, 2)) },
+        tr { _mm_add_ps(tr1, swizzle(tr1, 2, 3, 0, 1)) },
+        det { _mm_sub_ps(
+            _mm_add_ps(_mm_mul_ps(det_a, det_d), _mm_mul_ps(det_b, det_c)),
+            tr
+        ) };
+    #undef mat2_mul_adj
+    #undef mat2_adj_mul
+    #undef mat2_mul
+    #undef swizzle
+
+    if (!std::isnormal(_mm_cvtss_f32(det))) {
+        return false;
+    }
+    const __m128
+        rd { _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), det) },
+        rx { _mm_mul_ps(x, rd) },
+        ry { _mm_mul_ps(y, rd) },
+        rz { _mm_mul_ps(z, rd) },
+        rw { _mm_mul_ps(w, rd) };
+
+    _mm_storeu_ps(out, _mm_shuffle_ps(rx, ry, _MM_SHUFFLE(1, 3, 1, 3)));
+    _mm_storeu_ps(out + 4, _mm_shuffle_ps(rx, ry, _MM_SHUFFLE(0, 2, 0, 2)));
+    _mm_storeu_ps(out + 8, _mm_shuffle_ps(rz, rw, _MM_SHUFFLE(1, 3, 1, 3)));
+    _mm_storeu_ps(out + 12, _mm_shuffle_ps(rz, rw, _MM_SHUFFLE(0, 2, 0, 2)));
+    return true;
+}
+
+#endif
+
+
+
+
+/**
+ *  Bounds-check policies of the GArray indexer.
+ *  Internal loops never go through the indexer, so the policy
+ *  only affects element access from outside of m3d types.
+ */
+struct bounds_checked {
+    static constexpr void check (std::size_t i, std::size_t n) {
+        if (i >= n) {
+            throw std::out_of_range(msg::out_of_range);
+        }
+    }
+};
+
+
+struct bounds_unchecked {
+    static constexpr void check (std::size_t, std::size_t) {}
+};
+
+
+
+
+/**
+ *  Default policy: checked unless built with M3D_BOUNDS_CHECK=0
+ *  (see "BUILD" switch in the Makefile).
+ */
+#if !defined(M3D_BOUNDS_CHECK)
+#define M3D_BOUNDS_CHECK 1
+#endif
+
+#if M3D_BOUNDS_CHECK
+using default_bounds = bounds_checked;
+#else
+using default_bounds = bounds_unchecked;
+#endif
+
+
+
+
+/**
+ *  Forward declaration (GArray is the leaf of every expression).
+ */
+template <typename T, std::size_t N, typename B> class GArray;
+
+
+
+
+/**
+ *  Base class of all (lazily evaluated) N-element expressions.
+ *  Arithmetic operators build expression objects instead of
+ *  temporary arrays - the whole expression is evaluated in a single
+ *  loop when it is assigned to (or used to construct) some GArray.
+ *  Leaves are held by reference, so an expression has to be consumed
+ *  within the full-expression that created it (never store it in an
+ *  "auto" variable).
+ *  Every expression "E" provides:
+ *      T eval (std::size_t i) const  -- value of i-th element,
+ *      bool aliases (const T *) const  -- does it read given storage?
+ *      static constexpr bool elementwise  -- does "eval(i)" read only
+ *          i-th element of its leaves?
+ */
+template <typename E, typename T, std::size_t N>
+class GExpr {
+
+public:
+
+    /**
+     *  Concrete expression.
+     */
+    constexpr const E& self () const {
+        return static_cast<const E&>(*this);
+    }
+
+
+    /**
+     *  Evaluate i-th element.
+     */
+    constexpr T operator[] (std::size_t i) const {
+        return this->self().eval(i);
+    }
+
+
+    /**
+     *  Evaluate the whole expression into a given storage
+     *  (it cannot be read by the expression unless "elementwise").
+     */
+    constexpr void eval_into (T *out) const {
+        this->eval_into(out, std::make_index_sequence<N>());
+    }
+
+
+    /**
+     *  Add (subtract) the whole expression to a given storage
+     *  (same restrictions as in "eval_into").
+     */
+    constexpr void add_into (T *out) const {
+        this->add_into(out, std::make_index_sequence<N>());
+    }
+
+    constexpr void sub_into (T *out) const {
+        this->sub_into(out, std::make_index_sequence<N>());
+    }
+
+
+private:
+
+    /**
+     *  Element loops are expanded at compile time
+     *  (straight-line code is easier to vectorize).
+     */
+    template <std::size_t... I>
+    constexpr void eval_into (T *out, std::index_sequence<I...>) const {
+        const int expand[] { (out[I] = this->self().eval(I), 0)... };
+        static_cast<void>(expand);
+    }
+
+    template <std::size_t... I>
+    constexpr void add_into (T *out, std::index_sequence<I...>) const {
+        const int expand[] { (out[I] += this->self().eval(I), 0)... };
+        static_cast<void>(expand);
+    }
+
+    template <std::size_t... I>
+    constexpr void sub_into (T *out, std::index_sequence<I...>) const {
+        const int expand[] { (out[I] -= this->self().eval(I), 0)... };
+        static_cast<void>(expand);
+    }
+
+};
+
+
+
+
+/**
+ *  Expression operand storage: leaves by reference,
+ *  intermediate nodes by value.
+ */
+template <typename E>
+struct expr_operand { using type = const E; };
+
+
+template <typename T, std::size_t N, typename B>
+struct expr_operand<GArray<T, N, B>> { using type = const GArray<T, N, B>&; };
+
+
+
+
+/**
+ *  Contiguous storage of an evaluated expression (leaves are not
+ *  copied - their own storage is used).
+ */
+template <typename E, typename T, std::size_t N>
+class GEvaluated {
+
+    T data[N] {};
+
+public:
+
+    constexpr GEvaluated (const E &e) { e.eval_into(this->data); }
+    constexpr const T* get () const { return this->data; }
+
+};
+
+
+template <typename T, std::size_t N, typename B>
+class GEvaluated<GArray<T, N, B>, T, N> {
+
+    const T *data;
+
+public:
+
+    constexpr GEvaluated (const GArray<T, N, B> &a): data { *a } {}
+    constexpr const T* get () const { return this->data; }
+
+};
+
+
+
+
+/**
+ *  Base class for Points, Vectors and Matrices.
+ */
+template <typename T, std::size_t N, typename B = default_bounds>
+class GArray : public GExpr<GArray<T, N, B>, T, N> {
 
 protected:
 
@@ -135,12 +756,29 @@ protected:
 public:
 
     /**
-     *  Array indexer.
+     *  ...
      */
-    inline T& operator[] (std::size_t i) noexcept(false) {
-        if (i >= N) {
-            throw std::out_of_range(msg::out_of_range);
-        }
+    static constexpr bool elementwise { true };
+
+
+    /**
+     *  ...
+     */
+    constexpr GArray () {}
+
+
+    /**
+     *  Evaluate an expression into the new array.
+     */
+    template <typename E>
+    constexpr GArray (const GExpr<E, T, N> &e) { this->assign(e); }
+
+
+    /**
+     *  Array indexer (bounds checking depends on "B" policy).
+     */
+    constexpr T& operator[] (std::size_t i) noexcept(false) {
+        B::check(i, N);
         return this->data[i];
     }
 
@@ -148,10 +786,8 @@ public:
     /**
      *  Array const indexer.
      */
-    inline const T& operator[] (std::size_t i) const noexcept(false) {
-        if (i >= N) {
-            throw std::out_of_range(msg::out_of_range);
-        }
+    constexpr const T& operator[] (std::size_t i) const noexcept(false) {
+        B::check(i, N);
         return this->data[i];
     }
 
@@ -159,20 +795,34 @@ public:
     /**
      *  Return pointer of basic type to the internal array.
      */
-    inline const T* operator* () const { return this->data; }
+    constexpr const T* operator* () const { return this->data; }
+
+
+    /**
+     *  Expression leaf: i-th element (unchecked).
+     */
+    constexpr T eval (std::size_t i) const { return this->data[i]; }
+
+
+    /**
+     *  Expression leaf: is it a given storage?
+     */
+    constexpr bool aliases (const T *p) const { return this->data == p; }
 
 
     /**
      *  Return the size of this array.
      */
-    inline std::size_t size () const { return N; }
+    constexpr std::size_t size () const { return N; }
 
 
     /**
      *  Reset current array (fill data with zeros).
      */
-    inline GArray<T, N>& reset () {
-        std::memset(this->data, 0, N*sizeof(T));
+    constexpr GArray<T, N, B>& reset () {
+        for (std::size_t i = 0;  i < N;  i++) {
+            this->data[i] = static_cast<T>(0);
+        }
         return *this;
     }
 
@@ -180,25 +830,38 @@ public:
     /**
      *  Replace current array.
      */
-    inline GArray<T, N>& assign (const GArray<T, N> &a) {
-        std::memcpy(this->data, *a, N*sizeof(T));
-        return *this;
+    constexpr GArray<T, N, B>& assign (const GArray<T, N, B> &a) {
+        return this->assign(*a);
     }
 
 
     /**
      *  ...
      */
-    inline GArray<T, N>& assign (const T d[]) {
-        std::memcpy(this->data, d, N*sizeof(T));
+    constexpr GArray<T, N, B>& assign (const T d[]) {
+        for (std::size_t i = 0;  i < N;  i++) {
+            this->data[i] = d[i];
+        }
         return *this;
     }
 
 
+    /**
+     *  Evaluate an expression into the current array.
+     */
+    template <typename E>
+    constexpr GArray<T, N, B>& assign (const GExpr<E, T, N> &e) {
+        if (!E::elementwise  &&  this->may_alias(e)) {
+            return this->assign(GArray<T, N, B>().assign_unaliased(e));
+        }
+        return this->assign_unaliased(e);
+    }
+
+
     /**
      *  ...
      */
-    inline GArray<T, N>& operator= (const GArray<T, N> &a) {
+    constexpr GArray<T, N, B>& operator= (const GArray<T, N, B> &a) {
         return this->assign(a);
     }
 
@@ -206,7 +869,16 @@ public:
     /**
      *  ...
      */
-    inline GArray<T, N>& operator= (const T d[]) {
+    template <typename E>
+    constexpr GArray<T, N, B>& operator= (const GExpr<E, T, N> &e) {
+        return this->assign(e);
+    }
+
+
+    /**
+     *  ...
+     */
+    constexpr GArray<T, N, B>& operator= (const T d[]) {
         return this->assign(d);
     }
 
@@ -214,7 +886,7 @@ public:
     /**
      *  Replace all values with their corresponding absolute values.
      */
-    inline GArray<T, N>& abs () {
+    inline GArray<T, N, B>& abs () {
         for (std::size_t i = 0;  i < N;  i++) {
             this->data[i] = std::fabs(this->data[i]);
         }
@@ -225,9 +897,9 @@ public:
     /**
      *  Add to current array.
      */
-    inline GArray<T, N>& add (const GArray<T, N> &a) {
+    constexpr GArray<T, N, B>& add (const GArray<T, N, B> &a) {
         for (std::size_t i = 0;  i < N;  i++) {
-            this->data[i] += a[i];
+            this->data[i] += (*a)[i];
         }
         return *this;
     }
@@ -236,17 +908,39 @@ public:
     /**
      *  ...
      */
-    inline GArray<T, N>& operator+= (const GArray<T, N> &a) {
+    constexpr GArray<T, N, B>& operator+= (const GArray<T, N, B> &a) {
         return this->add(a);
     }
 
 
+    /**
+     *  Add an expression to current array.
+     */
+    template <typename E>
+    constexpr GArray<T, N, B>& add (const GExpr<E, T, N> &e) {
+        if (!E::elementwise  &&  this->may_alias(e)) {
+            return this->add(GArray<T, N, B>().assign_unaliased(e));
+        }
+        e.self().add_into(this->data);
+        return *this;
+    }
+
+
+    /**
+     *  ...
+     */
+    template <typename E>
+    constexpr GArray<T, N, B>& operator+= (const GExpr<E, T, N> &e) {
+        return this->add(e);
+    }
+
+
     /**
      *  Subtract from current array.
      */
-    inline GArray<T, N>& sub (const GArray<T, N> &a) {
+    constexpr GArray<T, N, B>& sub (const GArray<T, N, B> &a) {
         for (std::size_t i = 0;  i < N;  i++) {
-            this->data[i] -= a[i];
+            this->data[i] -= (*a)[i];
         }
         return *this;
     }
@@ -255,15 +949,37 @@ public:
     /**
      *  ...
      */
-    inline GArray<T, N>& operator-= (const GArray<T, N> &a) {
+    constexpr GArray<T, N, B>& operator-= (const GArray<T, N, B> &a) {
         return this->sub(a);
     }
 
 
+    /**
+     *  Subtract an expression from current array.
+     */
+    template <typename E>
+    constexpr GArray<T, N, B>& sub (const GExpr<E, T, N> &e) {
+        if (!E::elementwise  &&  this->may_alias(e)) {
+            return this->sub(GArray<T, N, B>().assign_unaliased(e));
+        }
+        e.self().sub_into(this->data);
+        return *this;
+    }
+
+
+    /**
+     *  ...
+     */
+    template <typename E>
+    constexpr GArray<T, N, B>& operator-= (const GExpr<E, T, N> &e) {
+        return this->sub(e);
+    }
+
+
     /**
      *  Scale the current array (multiply each component by a given value).
      */
-    inline GArray<T, N>& scale (const T s) {
+    constexpr GArray<T, N, B>& scale (const T s) {
         for (std::size_t i = 0;  i < N;  i++) {
             this->data[i] *= s;
         }
@@ -274,54 +990,153 @@ public:
     /**
      *  ...
      */
-    inline GArray<T, N>& operator*= (const T s) {
+    constexpr GArray<T, N, B>& operator*= (const T s) {
         return this->scale(s);
     }
 
+
+protected:
+
+    /**
+     *  Can an expression read the current array? (addresses
+     *  of unrelated objects cannot be compared in constant
+     *  evaluation - assume they can).
+     */
+    template <typename E>
+    constexpr bool may_alias (const GExpr<E, T, N> &e) const {
+        return m3d_constant_evaluated()  ||  e.self().aliases(this->data);
+    }
+
+
+    /**
+     *  Evaluate an expression directly into the current array
+     *  (expression must not read it, unless it is "elementwise").
+     */
+    template <typename E>
+    constexpr GArray<T, N, B>& assign_unaliased (const GExpr<E, T, N> &e) {
+        e.self().eval_into(this->data);
+        return *this;
+    }
+
 };
 
 
 
 
 /**
- *  Add two arrays yielding the new one.
+ *  Element-wise binary operations.
  */
-template <typename T, std::size_t N>
-inline GArray<T, N> operator+ (const GArray<T, N> &a, const GArray<T, N> &b) {
-    return GArray<T, N>(a).add(b);
+struct expr_add {
+    template <typename T>
+    static constexpr T apply (const T a, const T b) { return a + b; }
+};
+
+
+struct expr_sub {
+    template <typename T>
+    static constexpr T apply (const T a, const T b) { return a - b; }
+};
+
+
+
+
+/**
+ *  Element-wise binary expression node.
+ */
+template <typename Op, typename L, typename R, typename T, std::size_t N>
+class GElementwise : public GExpr<GElementwise<Op, L, R, T, N>, T, N> {
+
+    typename expr_operand<L>::type l;
+    typename expr_operand<R>::type r;
+
+public:
+
+    static constexpr bool elementwise { L::elementwise  &&  R::elementwise };
+
+    constexpr GElementwise (const L &l, const R &r): l { l }, r { r } {}
+
+    constexpr T eval (std::size_t i) const {
+        return Op::apply(this->l.eval(i), this->r.eval(i));
+    }
+
+    constexpr bool aliases (const T *p) const {
+        return this->l.aliases(p)  ||  this->r.aliases(p);
+    }
+
+};
+
+
+
+
+/**
+ *  Scaled expression node.
+ */
+template <typename E, typename T, std::size_t N>
+class GScaled : public GExpr<GScaled<E, T, N>, T, N> {
+
+    typename expr_operand<E>::type e;
+    const T s;
+
+public:
+
+    static constexpr bool elementwise { E::elementwise };
+
+    constexpr GScaled (const E &e, const T s): e { e }, s { s } {}
+
+    constexpr T eval (std::size_t i) const { return this->e.eval(i) * this->s; }
+
+    constexpr bool aliases (const T *p) const { return this->e.aliases(p); }
+
+};
+
+
+
+
+/**
+ *  Add two arrays (expressions) yielding the new expression.
+ */
+template <typename L, typename R, typename T, std::size_t N>
+constexpr GElementwise<expr_add, L, R, T, N> operator+ (
+    const GExpr<L, T, N> &a, const GExpr<R, T, N> &b
+) {
+    return { a.self(), b.self() };
 }
 
 
 
 
 /**
- *  Subtract two arrays yielding the new one.
+ *  Subtract two arrays (expressions) yielding the new expression.
  */
-template <typename T, std::size_t N>
-inline GArray<T, N> operator- (const GArray<T, N> &a, const GArray<T, N> &b) {
-    return GArray<T, N>(a).sub(b);
+template <typename L, typename R, typename T, std::size_t N>
+constexpr GElementwise<expr_sub, L, R, T, N> operator- (
+    const GExpr<L, T, N> &a, const GExpr<R, T, N> &b
+) {
+    return { a.self(), b.self() };
 }
 
 
 
 
 /**
- *  Scale array by a scalar yielding the new array (Array * Scalar).
+ *  Scale array (expression) by a scalar yielding the new expression
+ *  (Array * Scalar).
  */
-template <typename T, std::size_t N>
-inline GArray<T, N> operator* (const GArray<T, N> &a, const T s) {
-    return GArray<T, N>(a).scale(s);
+template <typename E, typename T, std::size_t N>
+constexpr GScaled<E, T, N> operator* (const GExpr<E, T, N> &a, const T s) {
+    return { a.self(), s };
 }
 
 
 
 
 /**
- *  Scale array by a scalar yielding the new array (Scalar * Array).
+ *  Scale array (expression) by a scalar yielding the new expression
+ *  (Scalar * Array).
  */
-template <typename T, std::size_t N>
-inline GArray<T, N> operator* (const T s, const GArray<T, N> &a) {
-    return GArray<T, N>(a).scale(s);
+template <typename E, typename T, std::size_t N>
+constexpr GScaled<E, T, N> operator* (const T s, const GExpr<E, T, N> &a) {
+    return { a.self(), s };
 }
 
 
@@ -330,10 +1145,10 @@ inline GArray<T, N> operator* (const T s, const GArray<T, N> &a) {
 /**
  *  GArray deep comparision "==".
  */
-template <typename T, std::size_t N>
-inline bool operator== (const GArray<T, N> &a, const GArray<T, N> &b) {
+template <typename T, std::size_t N, typename B>
+constexpr bool operator== (const GArray<T, N, B> &a, const GArray<T, N, B> &b) {
     for (std::size_t i = 0;  i < N;  i++) {
-        if (a[i] != b[i]) { return false; }
+        if ((*a)[i] != (*b)[i]) { return false; }
     }
     return true;
 }
@@ -344,8 +1159,8 @@ inline bool operator== (const GArray<T, N> &a, const GArray<T, N> &b) {
 /**
  *  GArray deep comparision "!=".
  */
-template <typename T, std::size_t N>
-inline bool operator!= (const GArray<T, N> &l, const GArray<T, N> &r) {
+template <typename T, std::size_t N, typename B>
+constexpr bool operator!= (const GArray<T, N, B> &l, const GArray<T, N, B> &r) {
     return !(l == r);
 }
 
@@ -355,8 +1170,8 @@ inline bool operator!= (const GArray<T, N> &l, const GArray<T, N> &r) {
 /**
  *  GArray to Ostream serialization.
  */
-template <typename T, std::size_t N>
-std::ostream& operator<< (std::ostream &os, const GArray<T, N> &gv) {
+template <typename T, std::size_t N, typename B>
+std::ostream& operator<< (std::ostream &os, const GArray<T, N, B> &gv) {
     os << "[";
     for (std::size_t i = 0;  i < N;  i++) {
         os << gv[i];
@@ -372,18 +1187,27 @@ std::ostream& operator<< (std::ostream &os, const GArray<T, N> &gv) {
 /**
  *  Base class for all Vector types.
  */
-template <typename T, std::size_t N>
-class GVector : public GArray<T, N> {
+template <typename T, std::size_t N, typename B = default_bounds>
+class GVector : public GArray<T, N, B> {
 
 public:
 
+    /**
+     *  ...
+     */
+    constexpr GVector () {}
+    template <typename E>
+    constexpr GVector (const GExpr<E, T, N> &e) { GArray<T, N, B>::assign(e); }
+    using GArray<T, N, B>::operator=;
+
+
     /**
      *  Compute square length of the current vector.
      */
-    inline T sqr_length () const {
+    constexpr T sqr_length () const {
         T result { static_cast<T>(0) };
         for (std::size_t i = 0;  i < N;  i++) {
-            result += sqr((*this)[i]);
+            result += sqr(this->data[i]);
         }
         return result;
     }
@@ -400,7 +1224,7 @@ public:
     /**
      *  Perform a vector normalization.
      */
-    GVector<T, N>& normalize () {
+    GVector<T, N, B>& normalize () {
         const T l { this->length() };
         if (close_to(l, static_cast<T>(0))) {
             this->reset();
@@ -430,7 +1254,7 @@ public:
     /**
      *  Turn vector in opposite direction.
      */
-    GVector<T, N>& flip () {
+    constexpr GVector<T, N, B>& flip () {
         for (std::size_t i = 0;  i < N;  i++) {
             this->data[i] = -this->data[i];
         }
@@ -442,29 +1266,29 @@ public:
      *  Compute dot product based on the current vector
      *  and one passed in parameter.
      */
-    T dot (const GArray<T, N> &v) const {
+    constexpr T dot (const GArray<T, N, B> &v) const {
         T result { static_cast<T>(0) };
         for (std::size_t i = 0;  i < N;  i++) {
-            result += this->data[i] * v[i];
+            result += this->data[i] * (*v)[i];
         }
         return result;
     }
 
 
     /**
-     *  Transform given vector by a matrix and store the result
-     *  in the current vector.
+     *  Transform given vector by a matrix (expression) and store
+     *  the result in the current vector.
      */
-    GVector<T, N>& transform (
-        const GArray<T, N*N> &m, const GArray<T, N> &v
+    template <typename E>
+    constexpr GVector<T, N, B>& transform (
+        const GExpr<E, T, N*N> &m, const GArray<T, N, B> &v
     ) {
-        T val;
-        for (std::size_t i = 0;  i < N;  i++) {
-            val = static_cast<T>(0);
-            for (std::size_t j = 0;  j < N;  j++) {
-                val += m[i + j*N] * v[j];
-            }
-            this->data[i] = val;
+        const GEvaluated<E, T, N*N> em { m.self() };
+        if (m3d_constant_evaluated()  ||  v.aliases(this->data)) {
+            const GVector<T, N, B> u { v };
+            matrix_transform<T, N>(this->data, em.get(), *u);
+        } else {
+            matrix_transform<T, N>(this->data, em.get(), *v);
         }
         return *this;
     }
@@ -475,14 +1299,14 @@ public:
 
 
 /**
- *  Transform given vector by a matrix and store the result
- *  in the new vector.
+ *  Transform given vector by a matrix (expression) and store
+ *  the result in the new vector.
  */
-template <typename T, std::size_t N>
-inline GVector<T, N> operator* (
-    const GArray<T, N*N> &m, const GArray<T, N> &v
+template <typename E, typename T, std::size_t N, typename B>
+constexpr GVector<T, N, B> operator* (
+    const GExpr<E, T, N*N> &m, const GArray<T, N, B> &v
 ) {
-    return GVector<T, N>().transform(m, v);
+    return GVector<T, N, B>().transform(m, v);
 }
 
 
@@ -499,10 +1323,12 @@ public:
     /**
      *  ...
      */
-    GVector2 () {}
-    GVector2 (T x0, T x1) { this->assign(x0, x1); }
-    GVector2 (const GArray<T, 2> &a) { GArray<T, 2>::assign(a); }
-    GVector2 (const T d[]) { GArray<T, 2>::assign(d); }
+    constexpr GVector2 () {}
+    constexpr GVector2 (T x0, T x1) { this->assign(x0, x1); }
+    constexpr GVector2 (const GArray<T, 2> &a) { GArray<T, 2>::assign(a); }
+    template <typename E>
+    constexpr GVector2 (const GExpr<E, T, 2> &e) { GArray<T, 2>::assign(e); }
+    constexpr GVector2 (const T d[]) { GArray<T, 2>::assign(d); }
 
 
     /**
@@ -520,7 +1346,7 @@ public:
     /**
      *  ...
      */
-    GVector2<T>& assign (T x0, T x1) {
+    constexpr GVector2<T>& assign (T x0, T x1) {
         #define set(i, v) this->data[i] = v
         set(0, x0); set(1, x1);
         #undef set
@@ -543,11 +1369,13 @@ public:
     /**
      *  ...
      */
-    GVector3 () {}
-    GVector3 (T x0, T x1, T x2) { this->assign(x0, x1, x2); }
-    GVector3 (const GArray<T, 3> &a) { GArray<T, 3>::assign(a); }
-    GVector3 (const GArray<T, 4> &a) { this->assign(a); }
-    GVector3 (const T d[]) { GArray<T, 3>::assign(d); }
+    constexpr GVector3 () {}
+    constexpr GVector3 (T x0, T x1, T x2) { this->assign(x0, x1, x2); }
+    constexpr GVector3 (const GArray<T, 3> &a) { GArray<T, 3>::assign(a); }
+    template <typename E>
+    constexpr GVector3 (const GExpr<E, T, 3> &e) { GArray<T, 3>::assign(e); }
+    constexpr GVector3 (const GArray<T, 4> &a) { this->assign(a); }
+    constexpr GVector3 (const T d[]) { GArray<T, 3>::assign(d); }
 
 
     /**
@@ -565,7 +1393,7 @@ public:
     /**
      *  ...
      */
-    inline GVector3<T>& assign (const GArray<T, 4> &a) {
+    constexpr GVector3<T>& assign (const GArray<T, 4> &a) {
         return static_cast<GVector3<T>&>(this->assign(*a));
     }
 
@@ -573,7 +1401,7 @@ public:
     /**
      *  ...
      */
-    inline GVector3<T>& assign (T x0, T x1, T x2) {
+    constexpr GVector3<T>& assign (T x0, T x1, T x2) {
         #define set(i, v) this->data[i] = v
         set(0, x0); set(1, x1); set(2, x2);
         #undef set
@@ -584,7 +1412,7 @@ public:
     /**
      *  Compute cross product and store the result in the current vector.
      */
-    GVector3<T>& cross (const GArray<T, 3> &u, const GArray<T, 3> &v) {
+    constexpr GVector3<T>& cross (const GArray<T, 3> &u, const GArray<T, 3> &v) {
         this->data[0] = u[1] * v[2] - v[1] * u[2];
         this->data[1] = u[2] * v[0] - v[2] * u[0];
         this->data[2] = u[0] * v[1] - v[0] * u[1];
@@ -607,11 +1435,13 @@ public:
     /**
      *  ...
      */
-    GVector4 () {}
-    GVector4 (T x0, T x1, T x2, T x3) { this->assign(x0, x1, x2, x3); }
-    GVector4 (const GArray<T, 3> &a, T w) { this->assign(a, w); }
-    GVector4 (const GArray<T, 4> &a) { GArray<T, 4>::assign(a); }
-    GVector4 (const T d[]) { GArray<T, 4>::assign(d); }
+    constexpr GVector4 () {}
+    constexpr GVector4 (T x0, T x1, T x2, T x3) { this->assign(x0, x1, x2, x3); }
+    constexpr GVector4 (const GArray<T, 3> &a, T w) { this->assign(a, w); }
+    constexpr GVector4 (const GArray<T, 4> &a) { GArray<T, 4>::assign(a); }
+    template <typename E>
+    constexpr GVector4 (const GExpr<E, T, 4> &e) { GArray<T, 4>::assign(e); }
+    constexpr GVector4 (const T d[]) { GArray<T, 4>::assign(d); }
 
 
     /**
@@ -629,7 +1459,7 @@ public:
     /**
      *  ...
      */
-    inline GVector4<T>& assign (T x0, T x1, T x2, T x3) {
+    constexpr GVector4<T>& assign (T x0, T x1, T x2, T x3) {
         #define set(i, v) this->data[i] = v
         set(0, x0); set(1, x1); set(2, x2); set(3, x3);
         #undef set
@@ -640,7 +1470,7 @@ public:
     /**
      *  ...
      */
-    inline GVector4<T>& assign (const GArray<T, 3> &a, T w) {
+    constexpr GVector4<T>& assign (const GArray<T, 3> &a, T w) {
         #define set(i, v) this->data[i] = v
         set(0, a[0]); set(1, a[1]); set(2, a[2]); set(3, w);
         #undef set
@@ -651,7 +1481,7 @@ public:
     /**
      *  ...
      */
-    inline GVector3<T> xyz () {
+    constexpr GVector3<T> xyz () {
         return GVector3<T> { this->data[0], this->data[1], this->data[1] };
     }
 
@@ -659,7 +1489,7 @@ public:
     /**
      *  ...
      */
-    inline GVector3<T> rgb () {
+    constexpr GVector3<T> rgb () {
         return this->xyz();
     }
 
@@ -671,23 +1501,29 @@ public:
 /**
  *  Base class for all matrix types.
  */
-template <typename T, std::size_t N>
-class GMatrix : public GArray<T, N*N> {
+template <typename T, std::size_t N, typename B = default_bounds>
+class GMatrix : public GArray<T, N*N, B> {
 
 public:
 
     /**
      *  ...
      */
-    GMatrix () {}
-    GMatrix (const GArray<T, N*N> &a) { GArray<T, N*N>::assign(a); }
-    using GArray<T, N*N>::operator=;
+    constexpr GMatrix () {}
+    constexpr GMatrix (const GArray<T, N*N, B> &a) {
+        GArray<T, N*N, B>::assign(a);
+    }
+    template <typename E>
+    constexpr GMatrix (const GExpr<E, T, N*N> &e) {
+        GArray<T, N*N, B>::assign(e);
+    }
+    using GArray<T, N*N, B>::operator=;
 
 
     /**
      *  Replace matrix with identity.
      */
-    GMatrix<T, N>& load_identity () {
+    constexpr GMatrix<T, N, B>& load_identity () {
         this->reset();
         for (std::size_t i = 0;  i < N*N;  i += (N+1)) {
             this->data[i] = static_cast<T>(1);
@@ -699,19 +1535,10 @@ public:
     /**
      *  Multiply two matrices and store the result in the current matrix.
      */
-    GMatrix<T, N>& multiply (
-        const GArray<T, N*N> &a, const GArray<T, N*N> &b
+    constexpr GMatrix<T, N, B>& multiply (
+        const GArray<T, N*N, B> &a, const GArray<T, N*N, B> &b
     ) {
-        T val;
-        std::size_t row, column;
-        for (std::size_t i = 0;  i < N*N;  i++) {
-            val = static_cast<T>(0);
-            row = i % N;  column = (i / N) * N;
-            for (std::size_t j = 0;  j < N;  j++) {
-                val += a[row + j*N] * b[column + j];
-            }
-            this->data[i] = val;
-        }
+        matrix_multiply<T, N>(this->data, *a, *b);
         return *this;
     }
 
@@ -721,13 +1548,59 @@ public:
 
 
 /**
- *  Multiply two matrices yielding the new one.
+ *  Matrix product expression node.
+ *  Evaluation of a chain "a * b * c * ..." runs the product kernel
+ *  once per "*", writing the last product directly into the target
+ *  (intermediate products land in stack storage, never copied).
+ *  Single elements (used in element-wise expressions) are computed
+ *  in the same order as the kernel.
+ */
+template <typename L, typename R, typename T, std::size_t N>
+class GProduct : public GExpr<GProduct<L, R, T, N>, T, N*N> {
+
+    typename expr_operand<L>::type l;
+    typename expr_operand<R>::type r;
+
+public:
+
+    static constexpr bool elementwise { false };
+
+    constexpr GProduct (const L &l, const R &r): l { l }, r { r } {}
+
+    constexpr T eval (std::size_t i) const {
+        T val { static_cast<T>(0) };
+        const std::size_t row { i % N }, column { (i / N) * N };
+        for (std::size_t j = 0;  j < N;  j++) {
+            val += this->l.eval(row + j*N) * this->r.eval(column + j);
+        }
+        return val;
+    }
+
+    constexpr bool aliases (const T *p) const {
+        return this->l.aliases(p)  ||  this->r.aliases(p);
+    }
+
+    constexpr void eval_into (T *out) const {
+        matrix_multiply<T, N>(
+            out,
+            GEvaluated<L, T, N*N>(this->l).get(),
+            GEvaluated<R, T, N*N>(this->r).get()
+        );
+    }
+
+};
+
+
+
+
+/**
+ *  Multiply two matrices (expressions) yielding the new expression.
  */
-template <typename T, std::size_t N = 4>
-inline GMatrix<T, N> operator* (
-    const GArray<T, N*N> &a, const GArray<T, N*N> &b
+template <typename T, std::size_t N = 4, typename L, typename R>
+constexpr GProduct<L, R, T, N> operator* (
+    const GExpr<L, T, N*N> &a, const GExpr<R, T, N*N> &b
 ) {
-    return GMatrix<T, N>().multiply(a, b);
+    return { a.self(), b.self() };
 }
 
 
@@ -744,17 +1617,16 @@ public:
     /**
      *  ...
      */
-    GMatrix4 () {}
+    constexpr GMatrix4 () {}
 
 
     /**
      *  ...
      */
-    GMatrix4 (std::initializer_list<T> init_list) {
-        typename std::initializer_list<T>::iterator it;
-        std::size_t i;
+    constexpr GMatrix4 (std::initializer_list<T> init_list) {
+        typename std::initializer_list<T>::iterator it { init_list.begin() };
         for (
-            it = init_list.begin(), i = 0;
+            std::size_t i = 0;
             it != init_list.end()  &&  i < 4*4;
             it++, i++
         ) {
@@ -766,7 +1638,18 @@ public:
     /**
      *  ...
      */
-    GMatrix4 (const GArray<T, 4*4> &a) { GArray<T, 4*4>::assign(a); }
+    constexpr GMatrix4 (const GArray<T, 4*4> &a) {
+        GArray<T, 4*4>::assign(a);
+    }
+
+
+    /**
+     *  Evaluate an expression (e.g. a product chain) into the new matrix.
+     */
+    template <typename E>
+    constexpr GMatrix4 (const GExpr<E, T, 4*4> &e) {
+        GArray<T, 4*4>::assign(e);
+    }
 
 
     /**
@@ -778,7 +1661,7 @@ public:
     /**
      *  Replaces current matrix with the translation matrix.
      */
-    inline GMatrix4<T>& load_translation (T x, T y, T z) {
+    constexpr GMatrix4<T>& load_translation (T x, T y, T z) {
         this->load_identity();
         #define set(i, v) this->data[i] = v
         set(12, x); set(13, y); set(14, z);
@@ -791,7 +1674,7 @@ public:
      *  Replaces current matrix with the translation matrix
      *  (built from vector).
      */
-    GMatrix4<T>& load_translation (const GArray<T, 3> &v) {
+    constexpr GMatrix4<T>& load_translation (const GArray<T, 3> &v) {
         return this->load_translation(v[0], v[1], v[2]);
     }
 
@@ -799,7 +1682,7 @@ public:
     /**
      *  Replaces current matrix with the scale matrix.
      */
-    inline GMatrix4<T>& load_scale (T x, T y, T z) {
+    constexpr GMatrix4<T>& load_scale (T x, T y, T z) {
         this->reset();
         #define set(i, v) this->data[i] = v
         set(0, x); set(5, y); set(10, z); set(15, static_cast<T>(1));
@@ -811,7 +1694,7 @@ public:
     /**
      *  Replaces current matrix with the scale matrix (built from vector).
      */
-    GMatrix4<T>& load_scale (const GArray<T, 3> &v) {
+    constexpr GMatrix4<T>& load_scale (const GArray<T, 3> &v) {
         return this->load_scale(v[0], v[1], v[2]);
     }
 
@@ -820,13 +1703,31 @@ public:
      *  Replaces current matrix with the rotation matrix.
      */
     inline GMatrix4<T>& load_rotation (T angle, T x, T y, T z) {
-        angle = radians(angle);
+        T s { static_cast<T>(0) }, c { static_cast<T>(1) };
+        sincos(radians(angle), s, c);
+        return this->load_rotation_sincos(s, c, x, y, z);
+    }
+
+
+    /**
+     *  Replaces current matrix with the rotation matrix
+     *  (fast, approximate sine and cosine - see "fast_sincos").
+     */
+    inline GMatrix4<T>& load_rotation_fast (T angle, T x, T y, T z) {
+        T s { static_cast<T>(0) }, c { static_cast<T>(1) };
+        fast_sincos(radians(angle), s, c);
+        return this->load_rotation_sincos(s, c, x, y, z);
+    }
 
+
+    /**
+     *  Replaces current matrix with the rotation matrix
+     *  (built from sine and cosine of the angle).
+     */
+    inline GMatrix4<T>& load_rotation_sincos (T s, T c, T x, T y, T z) {
         GVector3<T> v { x, y, z };  v.normalize();
         const T
-             c { std::cos(angle) },
             nc { static_cast<T>(1) - c },
-             s { std::sin(angle) },
             xs { v[0]*s },         ys { v[1]*s },         zs { v[2]*s },
           xync { v[0]*v[1]*nc }, xznc { v[0]*v[2]*nc }, yznc { v[1]*v[2]*nc };
 
@@ -857,6 +1758,56 @@ public:
     }
 
 
+    /**
+     *  Replaces current matrix with the rotation matrix
+     *  (fast variant, built from angle and vector).
+     */
+    GMatrix4<T>& load_rotation_fast (T angle, const GArray<T, 3> &v) {
+        return this->load_rotation_fast(angle, v[0], v[1], v[2]);
+    }
+
+
+    /**
+     *  Replaces current matrix with the rotation matrix about x, y or z
+     *  axis (same as "load_rotation(angle, 1, 0, 0)", ..., without
+     *  the axis normalization - only sine/cosine terms are computed).
+     */
+    inline GMatrix4<T>& load_rotation_x (T angle) {
+        T s { static_cast<T>(0) }, c { static_cast<T>(1) };
+        sincos(radians(angle), s, c);
+        this->load_identity();
+        #define set(i, v) this->data[i] = v
+        set(5, c);  set(9, -s);
+        set(6, s);  set(10, c);
+        #undef set
+        return *this;
+    }
+
+
+    inline GMatrix4<T>& load_rotation_y (T angle) {
+        T s { static_cast<T>(0) }, c { static_cast<T>(1) };
+        sincos(radians(angle), s, c);
+        this->load_identity();
+        #define set(i, v) this->data[i] = v
+        set(0, c);  set(8, s);
+        set(2, -s);  set(10, c);
+        #undef set
+        return *this;
+    }
+
+
+    inline GMatrix4<T>& load_rotation_z (T angle) {
+        T s { static_cast<T>(0) }, c { static_cast<T>(1) };
+        sincos(radians(angle), s, c);
+        this->load_identity();
+        #define set(i, v) this->data[i] = v
+        set(0, c);  set(4, -s);
+        set(1, s);  set(5, c);
+        #undef set
+        return *this;
+    }
+
+
     /**
      *  Replaces current matrix with the perspective projection matrix.
      */
@@ -881,7 +1832,7 @@ public:
     /**
      *  Replaces current matrix with the perspective projection matrix.
      */
-    GMatrix4<T>& load_ortho (
+    constexpr GMatrix4<T>& load_ortho (
         T left, T right, T bottom, T top, T z_near, T z_far
     ) {
         const T
@@ -901,6 +1852,74 @@ public:
         return *this;
     }
 
+
+    /**
+     *  Replaces current matrix with its inverse
+     *  (throws std::domain_error for singular matrices).
+     */
+    inline GMatrix4<T>& inverse () noexcept(false) {
+        if (!matrix_inverse<T>(this->data, this->data)) {
+            throw std::domain_error(msg::singular_matrix);
+        }
+        return *this;
+    }
+
+
+    /**
+     *  Replaces current matrix with its inverse, assuming it is rigid
+     *  (orthonormal rotation followed by translation): the rotation
+     *  is transposed, the translation is rotated back.
+     */
+    constexpr GMatrix4<T>& inverse_rigid () {
+        #define swap(i, j) { \
+            const T tmp { this->data[i] }; \
+            this->data[i] = this->data[j];  this->data[j] = tmp; \
+        }
+        swap(1, 4);  swap(2, 8);  swap(6, 9);
+        #undef swap
+        const T t[3] { this->data[12], this->data[13], this->data[14] };
+        for (std::size_t i = 0;  i < 3;  i++) {
+            this->data[12 + i] = -(
+                this->data[i]*t[0] + this->data[4 + i]*t[1] +
+                this->data[8 + i]*t[2]
+            );
+        }
+        return *this;
+    }
+
+
+    /**
+     *  Inverse transpose of the upper 3x3 part, e.g. the normal matrix
+     *  of a model-view matrix (correct also under non-uniform scale).
+     *  Throws std::domain_error for singular matrices.
+     */
+    inline GMatrix<T, 3> inverse_transpose3x3 () const noexcept(false) {
+        #define m(r, c) this->data[(c)*4 + (r)]
+        const T
+            c00 { m(1,1)*m(2,2) - m(1,2)*m(2,1) },
+            c01 { m(1,2)*m(2,0) - m(1,0)*m(2,2) },
+            c02 { m(1,0)*m(2,1) - m(1,1)*m(2,0) },
+            det { m(0,0)*c00 + m(0,1)*c01 + m(0,2)*c02 };
+        if (!std::isnormal(det)) {
+            throw std::domain_error(msg::singular_matrix);
+        }
+        const T d { static_cast<T>(1) / det };
+        GMatrix<T, 3> r;
+        #define set(i, v) r[i] = (v) * d
+        set(0, c00);
+        set(1, m(0,2)*m(2,1) - m(0,1)*m(2,2));
+        set(2, m(0,1)*m(1,2) - m(0,2)*m(1,1));
+        set(3, c01);
+        set(4, m(0,0)*m(2,2) - m(0,2)*m(2,0));
+        set(5, m(0,2)*m(1,0) - m(0,0)*m(1,2));
+        set(6, c02);
+        set(7, m(0,1)*m(2,0) - m(0,0)*m(2,1));
+        set(8, m(0,0)*m(1,1) - m(0,1)*m(1,0));
+        #undef set
+        #undef m
+        return r;
+    }
+
 };
 
 
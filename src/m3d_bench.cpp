@@ -0,0 +1,1283 @@
+/**
+ *  machina
+ *
+ *  Copyright (c) 2015, drmats
+ *  All rights reserved.
+ *
+ *  https://github.com/drmats/machina
+ */
+
+#ifndef __M3D_BENCH_CPP_
+#define __M3D_BENCH_CPP_ 1
+
+#include "m3d_bench.hpp"
+#include "m3d_kernels.hpp"
+#include "gbounds.hpp"
+#include "gray.hpp"
+#include "gframe.hpp"
+#include "gtransform.hpp"
+#include "camera.hpp"
+#include "scene.hpp"
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+namespace m3d {
+    namespace bench {
+
+
+
+
+/**
+ *  Open the counter (silently disabled on failure).
+ */
+InstructionCounter::InstructionCounter () {
+#if defined(__linux__)
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    this->fd = static_cast<int>(
+        syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0)
+    );
+#endif
+}
+
+
+
+
+/**
+ *  Clean-up.
+ */
+InstructionCounter::~InstructionCounter () {
+#if defined(__linux__)
+    if (this->available()) { close(this->fd); }
+#endif
+}
+
+
+
+
+/**
+ *  Reset and start counting.
+ */
+void InstructionCounter::start () {
+#if defined(__linux__)
+    if (this->available()) {
+        ioctl(this->fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(this->fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+
+
+
+/**
+ *  Stop counting and return the number of retired instructions.
+ */
+std::uint64_t InstructionCounter::stop () {
+    std::uint64_t count { 0 };
+#if defined(__linux__)
+    if (this->available()) {
+        ioctl(this->fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(this->fd, &count, sizeof(count)) != sizeof(count)) {
+            count = 0;
+        }
+    }
+#endif
+    return count;
+}
+
+
+
+
+namespace {
+
+
+/**
+ *  Reported result with its section and baseline.
+ */
+struct Record {
+    std::string section;
+    Result result;
+    std::string baseline;  // empty when none
+    double speedup;
+};
+
+
+std::vector<Record> records;
+std::string current_section;
+
+
+/**
+ *  JSON string literal.
+ */
+std::string json_string (const std::string &s) {
+    std::string r { "\"" };
+    for (const char c : s) {
+        if (c == '"'  ||  c == '\\') { r += '\\'; }
+        r += c;
+    }
+    return r + "\"";
+}
+
+
+} // namespace
+
+
+
+
+/**
+ *  Benchmark settings (command line).
+ */
+Settings& settings () {
+    static Settings instance;
+    return instance;
+}
+
+
+
+
+/**
+ *  Start a section of results: print its name (the caller
+ *  continues the header line) and tag following reports with it.
+ */
+std::ostream& section (const std::string &name) {
+    current_section = name;
+    return std::cout << name;
+}
+
+
+
+
+/**
+ *  Print a result line (relative to "baseline", if given)
+ *  and keep it for the JSON summary.
+ */
+void report (const Result &r, const Result *baseline) {
+    std::cout
+        << "    " << std::left << std::setw(40) << r.name << std::right
+        << std::fixed << std::setprecision(2)
+        << std::setw(10) << r.ns_per_op << " ns/op"
+        << " +-" << std::setw(5) << std::setprecision(1)
+        << r.deviation * 100.0 << "%"
+        << std::setw(10) << std::setprecision(2)
+        << r.throughput() * 1e-6 << " M/s";
+    if (r.instructions_per_op >= 0) {
+        std::cout
+            << std::setw(10) << std::setprecision(1)
+            << r.instructions_per_op << " instr/op";
+    }
+    double speedup { 0.0 };
+    if (baseline != nullptr  &&  r.ns_per_op > 0) {
+        speedup = baseline->ns_per_op / r.ns_per_op;
+        std::cout << "  (x" << std::setprecision(2) << speedup;
+        if (r.instructions_per_op > 0  &&  baseline->instructions_per_op > 0) {
+            std::cout
+                << ", " << std::setprecision(0)
+                << baseline->instructions_per_op - r.instructions_per_op
+                << " instr fewer";
+        }
+        std::cout << ")";
+    }
+    std::cout << std::endl;
+    records.push_back(Record {
+        current_section, r,
+        baseline != nullptr ? baseline->name : std::string(), speedup
+    });
+}
+
+
+
+
+/**
+ *  Parse a positive count argument (throws "std::invalid_argument"
+ *  or "std::out_of_range" unless it is entirely a decimal number).
+ */
+std::size_t count (const std::string &arg) {
+    std::size_t end { 0 };
+    const unsigned long value =
+        arg.empty()  ||  arg[0] == '-' ? 0 : std::stoul(arg, &end);
+    if (value == 0  ||  end != arg.size()) {
+        throw std::invalid_argument(arg);
+    }
+    return static_cast<std::size_t>(value);
+}
+
+
+
+
+/**
+ *  Write all reported results as JSON.
+ */
+void write_json (std::ostream &out, std::size_t iterations) {
+    out
+        << "{\n"
+        << "  \"benchmark\": \"m3d_bench\",\n"
+        << "  \"isa\": "
+        << json_string(kernels::isa_name(kernels::active_isa())) << ",\n"
+        << "  \"iterations\": " << iterations << ",\n"
+        << "  \"samples\": " << settings().samples << ",\n"
+        << "  \"results\": [";
+    out << std::setprecision(6) << std::defaultfloat;
+    for (std::size_t i = 0;  i < records.size();  i++) {
+        const Record &rec { records[i] };
+        const Result &r { rec.result };
+        out
+            << (i > 0 ? ",\n" : "\n") << "    {"
+            << "\"section\": " << json_string(rec.section)
+            << ", \"name\": " << json_string(r.name)
+            << ", \"ns_per_op\": " << r.ns_per_op
+            << ", \"ns_min\": " << r.ns_min
+            << ", \"ns_max\": " << r.ns_max
+            << ", \"deviation\": " << r.deviation
+            << ", \"ops_per_second\": " << r.throughput()
+            << ", \"instructions_per_op\": ";
+        if (r.instructions_per_op >= 0) {
+            out << r.instructions_per_op;
+        } else {
+            out << "null";
+        }
+        if (rec.baseline.empty()) {
+            out << ", \"baseline\": null, \"speedup\": null}";
+        } else {
+            out
+                << ", \"baseline\": " << json_string(rec.baseline)
+                << ", \"speedup\": " << rec.speedup << "}";
+        }
+    }
+    out << "\n  ]\n}\n";
+}
+
+
+
+
+/**
+ *  Core m3d, GFrame and Camera operations at a given precision
+ *  (results are reported by the caller).
+ */
+template <typename T>
+std::vector<Result> primitives_of (std::size_t iterations) {
+    using vec3 = GVector3<T>;
+    using vec4 = GVector4<T>;
+    using mat4 = GMatrix4<T>;
+    using frame = GFrame<T>;
+    using camera = machina::Camera<T>;
+
+    const std::size_t n { 1024 };
+    std::mt19937 generator { 42 };
+    std::uniform_real_distribution<T>
+        dist { static_cast<T>(-10), static_cast<T>(10) },
+        degrees { static_cast<T>(0), static_cast<T>(360) },
+        fovy { static_cast<T>(30), static_cast<T>(90) };
+    std::vector<vec3> v3(n);
+    std::vector<vec4> v4(n);
+    std::vector<mat4> m4(n);
+    std::vector<T> angles(n), fovs(n);
+    for (std::size_t i = 0;  i < n;  i++) {
+        v3[i].assign(dist(generator), dist(generator), dist(generator));
+        v4[i].assign(v3[i], static_cast<T>(1));
+        angles[i] = degrees(generator);
+        fovs[i] = fovy(generator);
+        // rigid transformations (always invertible)
+        m4[i].load_rotation(angles[i], v3[i][0], v3[i][1], v3[i][2]);
+        m4[i][12] = dist(generator);
+        m4[i][13] = dist(generator);
+        m4[i][14] = dist(generator);
+    }
+
+    mat4 m;
+    vec3 v;
+    vec4 w;
+    T d;
+    frame f;
+    camera c;
+    std::vector<Result> results;
+
+    #define at(v, k) v[(i + k) & (n - 1)]
+    #define measure(name, body) results.push_back(run(name, iterations, \
+        [&] (std::size_t i) { body; } \
+    ))
+    measure("mat4 * mat4", m = at(m4, 0) * at(m4, 1); do_not_optimize(m));
+    measure("mat4 * vec4", w = at(m4, 0) * at(v4, 0); do_not_optimize(w));
+    measure("mat4 inverse", m = at(m4, 0); m.inverse(); do_not_optimize(m));
+    measure("vec3 normalize", v = at(v3, 0); v.normalize(); do_not_optimize(v));
+    measure("vec3 cross",
+        v.cross(at(v3, 0), at(v3, 1)); do_not_optimize(v));
+    measure("vec3 dot", d = at(v3, 0).dot(at(v3, 1)); do_not_optimize(d));
+    measure("mat4 load_rotation",
+        m.load_rotation(at(angles, 0), 1, 2, 3); do_not_optimize(m));
+    measure("mat4 load_perspective",
+        m.load_perspective(at(fovs, 0), static_cast<T>(16.0 / 9.0), 1, 500);
+        do_not_optimize(m));
+    measure("frame rotate_local_y",
+        f.rotate_local_y(at(angles, 0)); do_not_optimize(f));
+    measure("frame translate_local",
+        f.translate_local(at(v3, 0)); do_not_optimize(f));
+    measure("frame normalize", f.normalize(); do_not_optimize(f));
+    measure("frame get_view_matrix",
+        m = f.get_view_matrix(); do_not_optimize(m));
+    measure("frame get_transformation_matrix",
+        m = f.get_transformation_matrix(); do_not_optimize(m));
+    measure("frame rebuild_orbit",
+        f.rebuild_orbit(at(v3, 0), 80, at(angles, 0), at(angles, 1));
+        do_not_optimize(f));
+    measure("camera recompute_transform",
+        c.yaw = at(angles, 0); c.recompute_transform(); do_not_optimize(c));
+    measure("camera get_vp_matrix",
+        m = c.get_vp_matrix(); do_not_optimize(m));
+    measure("camera get_frustum",
+        const GFrustum<T> frustum { c.get_frustum() };
+        do_not_optimize(frustum));
+    #undef measure
+    #undef at
+
+    return results;
+}
+
+
+
+
+/**
+ *  Core operations at float and double precision
+ *  (double relative to float).
+ */
+void primitives (std::size_t iterations) {
+    section("primitives<float>")
+        << " (" << iterations << " iterations):" << std::endl;
+    const std::vector<Result> single { primitives_of<GLfloat>(iterations) };
+    for (const Result &r : single) { report(r); }
+    std::cout << std::endl;
+
+    section("primitives<double>")
+        << " (" << iterations << " iterations, relative to float):"
+        << std::endl;
+    const std::vector<Result> twice { primitives_of<GLdouble>(iterations) };
+    for (std::size_t i = 0;  i < twice.size();  i++) {
+        report(twice[i], &single[i]);
+    }
+    std::cout << std::endl;
+}
+
+
+
+
+/**
+ *  Eager evaluation (every operator materializes its result),
+ *  as m3d did before expression templates - the baseline.
+ */
+namespace eager {
+
+    template <typename T, std::size_t N, typename B>
+    GArray<T, N, B> add (const GArray<T, N, B> &a, const GArray<T, N, B> &b) {
+        return GArray<T, N, B>(a).add(b);
+    }
+
+    template <typename T, std::size_t N, typename B>
+    GArray<T, N, B> sub (const GArray<T, N, B> &a, const GArray<T, N, B> &b) {
+        return GArray<T, N, B>(a).sub(b);
+    }
+
+    template <typename T, std::size_t N, typename B>
+    GArray<T, N, B> scale (const GArray<T, N, B> &a, const T s) {
+        return GArray<T, N, B>(a).scale(s);
+    }
+
+    template <typename T, std::size_t N = 4, typename B>
+    GMatrix<T, N, B> multiply (
+        const GArray<T, N*N, B> &a, const GArray<T, N*N, B> &b
+    ) {
+        return GMatrix<T, N, B>().multiply(a, b);
+    }
+
+} // namespace eager
+
+
+
+
+/**
+ *  Expression templates versus eager evaluation.
+ */
+void expressions (std::size_t iterations) {
+    using vec3 = GVector3<GLfloat>;
+    using vec4 = GVector4<GLfloat>;
+    using mat4 = GMatrix4<GLfloat>;
+
+    const std::size_t n { 1024 };
+    std::mt19937 generator { 42 };
+    std::uniform_real_distribution<GLfloat> dist { -10.0f, 10.0f };
+    std::vector<vec3> v3(n);
+    std::vector<mat4> m4(n);
+    for (std::size_t i = 0;  i < n;  i++) {
+        v3[i].assign(dist(generator), dist(generator), dist(generator));
+        for (std::size_t j = 0;  j < 16;  j++) { m4[i][j] = dist(generator); }
+    }
+    const vec4 one { 1, 1, 1, 0 }, e0 { 1, 0, 0, 0 };
+
+    #define at(v, k) v[(i + k) & (n - 1)]
+    section("expressions") << " (" << iterations << " iterations):" << std::endl;
+
+    // "target = origin + forward * dist" (GFrame / Camera)
+    Result base { run("vec3 a + b * s - c  [eager]", iterations,
+        [&] (std::size_t i) {
+            vec3 r { eager::sub(
+                eager::add(at(v3, 0), eager::scale(at(v3, 1), 0.5f)),
+                at(v3, 2)
+            ) };
+            do_not_optimize(r);
+        }
+    ) };
+    report(base);
+    report(run("vec3 a + b * s - c  [fused]", iterations,
+        [&] (std::size_t i) {
+            vec3 r { at(v3, 0) + at(v3, 1) * 0.5f - at(v3, 2) };
+            do_not_optimize(r);
+        }
+    ), &base);
+
+    // light direction / color of "MainLoop::draw"
+    base = run("vec4 (m * e0).normalize() * s + c  [eager]", iterations,
+        [&] (std::size_t i) {
+            vec4 r { eager::add(
+                eager::scale<GLfloat, 4>((at(m4, 0) * e0).normalize(), 0.5f),
+                one
+            ) };
+            do_not_optimize(r);
+        }
+    );
+    report(base);
+    report(run("vec4 (m * e0).normalize() * s + c  [fused]", iterations,
+        [&] (std::size_t i) {
+            vec4 r { (at(m4, 0) * e0).normalize() * 0.5f + one };
+            do_not_optimize(r);
+        }
+    ), &base);
+
+    // "Camera::recompute_transform"-like chains
+    base = run("mat4 a * b * c * d  [eager]", iterations,
+        [&] (std::size_t i) {
+            mat4 r { eager::multiply(
+                eager::multiply(
+                    eager::multiply(at(m4, 0), at(m4, 1)), at(m4, 2)
+                ),
+                at(m4, 3)
+            ) };
+            do_not_optimize(r);
+        }
+    );
+    report(base);
+    report(run("mat4 a * b * c * d  [fused]", iterations,
+        [&] (std::size_t i) {
+            mat4 r { at(m4, 0) * at(m4, 1) * at(m4, 2) * at(m4, 3) };
+            do_not_optimize(r);
+        }
+    ), &base);
+
+    // chain assigned to an existing matrix ("m_matrix = ...")
+    mat4 target;
+    base = run("mat4 m = a * b * c  [eager]", iterations,
+        [&] (std::size_t i) {
+            target = eager::multiply(
+                eager::multiply(at(m4, 0), at(m4, 1)), at(m4, 2)
+            );
+            do_not_optimize(target);
+        }
+    );
+    report(base);
+    report(run("mat4 m = a * b * c  [fused]", iterations,
+        [&] (std::size_t i) {
+            target = at(m4, 0) * at(m4, 1) * at(m4, 2);
+            do_not_optimize(target);
+        }
+    ), &base);
+    #undef at
+
+    std::cout << std::endl;
+}
+
+
+
+
+/**
+ *  Per-object model matrix of "MainLoop::draw" test meshes
+ *  (rotation * translation * rotation * rotation) built
+ *  as 4x4 products, 3x4 products and a composed TRS.
+ */
+void transforms (std::size_t iterations) {
+    using mat4 = GMatrix4<GLfloat>;
+    using affine = GAffine<GLfloat>;
+    using transform = GTransform<GLfloat>;
+
+    const std::size_t n { 1024 };
+    std::mt19937 generator { 42 };
+    std::uniform_real_distribution<GLfloat> dist { -1.0f, 1.0f };
+    std::vector<GLfloat> s(n);
+    for (std::size_t i = 0;  i < n;  i++) { s[i] = dist(generator); }
+
+    section("transforms")
+        << " (" << iterations << " iterations):" << std::endl;
+
+    #define at(v, k) v[(i + k) & (n - 1)]
+    mat4 m;
+    affine a;
+    Result base { run("model matrix [mat4 products]", iterations,
+        [&] (std::size_t i) {
+            m =
+                mat4().load_rotation_fast(at(s, 0)*3, 0, 1, 0) *
+                mat4().load_translation(0, at(s, 1)*8, 65 + at(s, 2)*12) *
+                mat4().load_rotation_fast(-35 - at(s, 3)*16, 1, 0, 0) *
+                mat4().load_rotation_fast(at(s, 4)*22, 0, 1, 0);
+            do_not_optimize(m);
+        }
+    ) };
+    report(base);
+    report(run("model matrix [affine products]", iterations,
+        [&] (std::size_t i) {
+            a =
+                affine().load_rotation_fast(at(s, 0)*3, 0, 1, 0) *
+                affine().load_translation(0, at(s, 1)*8, 65 + at(s, 2)*12) *
+                affine().load_rotation_fast(-35 - at(s, 3)*16, 1, 0, 0) *
+                affine().load_rotation_fast(at(s, 4)*22, 0, 1, 0);
+            do_not_optimize(a);
+        }
+    ), &base);
+    report(run("model matrix [trs -> affine]", iterations,
+        [&] (std::size_t i) {
+            a = (
+                transform().load_rotation_fast(at(s, 0)*3, 0, 1, 0) *
+                transform().load_translation(0, at(s, 1)*8, 65 + at(s, 2)*12) *
+                transform().load_rotation_fast(-35 - at(s, 3)*16, 1, 0, 0) *
+                transform().load_rotation_fast(at(s, 4)*22, 0, 1, 0)
+            ).get_affine();
+            do_not_optimize(a);
+        }
+    ), &base);
+    report(run("model matrix [trs axis -> affine]", iterations,
+        [&] (std::size_t i) {
+            a = (
+                transform().load_rotation_y_fast(at(s, 0)*3) *
+                transform().load_translation(0, at(s, 1)*8, 65 + at(s, 2)*12) *
+                transform().load_rotation_x_fast(-35 - at(s, 3)*16) *
+                transform().load_rotation_y_fast(at(s, 4)*22)
+            ).get_affine();
+            do_not_optimize(a);
+        }
+    ), &base);
+    report(run("model matrix [trs -> mat4]", iterations,
+        [&] (std::size_t i) {
+            m = (
+                transform().load_rotation_fast(at(s, 0)*3, 0, 1, 0) *
+                transform().load_translation(0, at(s, 1)*8, 65 + at(s, 2)*12) *
+                transform().load_rotation_fast(-35 - at(s, 3)*16, 1, 0, 0) *
+                transform().load_rotation_fast(at(s, 4)*22, 0, 1, 0)
+            ).get_matrix();
+            do_not_optimize(m);
+        }
+    ), &base);
+    #undef at
+
+    std::cout << std::endl;
+}
+
+
+
+
+/**
+ *  Fast sine/cosine versus libm (accuracy and throughput).
+ */
+void trig (std::size_t iterations) {
+    using mat4 = GMatrix4<GLfloat>;
+
+    const std::size_t n { 1024 };
+    std::mt19937 generator { 42 };
+    std::uniform_real_distribution<GLfloat> dist { -8192.0f, 8192.0f };
+    std::vector<GLfloat> x(n), s(n), c(n);
+    for (std::size_t i = 0;  i < n;  i++) { x[i] = dist(generator); }
+
+    section("trigonometry")
+        << " (" << iterations << " iterations):" << std::endl;
+
+    // accuracy against double precision libm
+    double error { 0.0 };
+    GLfloat fs { 0.0f }, fc { 0.0f };
+    for (std::size_t i = 0;  i < iterations;  i++) {
+        const GLfloat a { dist(generator) };
+        fast_sincos(a, fs, fc);
+        error = std::max(error, std::max(
+            std::fabs(fs - std::sin(static_cast<double>(a))),
+            std::fabs(fc - std::cos(static_cast<double>(a)))
+        ));
+    }
+    std::cout
+        << "    fast_sincos max abs error (|x| <= 8192): "
+        << std::scientific << std::setprecision(2) << error
+        << std::endl;
+
+    #define at(v, k) v[(i + k) & (n - 1)]
+    Result base { run("std::sin + std::cos", iterations,
+        [&] (std::size_t i) {
+            GLfloat r[2] { std::sin(at(x, 0)), std::cos(at(x, 0)) };
+            do_not_optimize(r);
+        }
+    ) };
+    report(base);
+    report(run("m3d::sincos", iterations,
+        [&] (std::size_t i) {
+            GLfloat r[2];
+            sincos(at(x, 0), r[0], r[1]);
+            do_not_optimize(r);
+        }
+    ), &base);
+    report(run("m3d::fast_sincos", iterations,
+        [&] (std::size_t i) {
+            GLfloat r[2];
+            fast_sincos(at(x, 0), r[0], r[1]);
+            do_not_optimize(r);
+        }
+    ), &base);
+    report(run("kernels::fast_sincos (per element)", iterations / n + 1,
+        [&] (std::size_t) {
+            kernels::fast_sincos(s.data(), c.data(), x.data(), n);
+            do_not_optimize(s);
+            do_not_optimize(c);
+        }
+    ).per(n), &base);
+
+    // rotation builders
+    mat4 m;
+    base = run("mat4 load_rotation", iterations,
+        [&] (std::size_t i) {
+            m.load_rotation(at(x, 0), 1, 2, 3);
+            do_not_optimize(m);
+        }
+    );
+    report(base);
+    report(run("mat4 load_rotation_fast", iterations,
+        [&] (std::size_t i) {
+            m.load_rotation_fast(at(x, 0), 1, 2, 3);
+            do_not_optimize(m);
+        }
+    ), &base);
+    #undef at
+
+    std::cout << std::endl;
+}
+
+
+
+
+/**
+ *  Packed, padded and structure-of-arrays layouts
+ *  (per-vector cost of bulk transforms and conversions).
+ */
+void layouts (std::size_t iterations) {
+    using vec3 = GVector3<GLfloat>;
+    using vec3a = GVector3A<GLfloat>;
+    using mat4 = GMatrix4<GLfloat>;
+
+    const std::size_t n { 4096 }, rounds { iterations / n + 1 };
+    std::mt19937 generator { 42 };
+    std::uniform_real_distribution<GLfloat> dist { -10.0f, 10.0f };
+    std::vector<vec3> packed(n), packed_out(n);
+    for (vec3 &v : packed) {
+        v.assign(dist(generator), dist(generator), dist(generator));
+    }
+    aligned_vector<vec3a> padded;
+    kernels::pad(padded, packed);
+    GSoA3<GLfloat> soa, soa_out(n);
+    kernels::to_soa(soa, packed);
+    mat4 m;
+    m.load_rotation(30, 1, 2, 3);
+
+    section("layouts")
+        << " (" << rounds << " x " << n << " vectors):" << std::endl;
+
+    Result base { run("transform_points [packed]", rounds,
+        [&] (std::size_t) {
+            kernels::transform_points(packed_out.data(), m, packed.data(), n);
+            do_not_optimize(packed_out);
+        }
+    ).per(n) };
+    report(base);
+    report(run("transform_points [soa]", rounds,
+        [&] (std::size_t) {
+            kernels::transform_points(soa_out.view(), m, soa.view());
+            do_not_optimize(soa_out);
+        }
+    ).per(n), &base);
+    report(run("packed -> soa", rounds,
+        [&] (std::size_t) {
+            kernels::to_soa(soa_out.view(), packed.data());
+            do_not_optimize(soa_out);
+        }
+    ).per(n));
+    report(run("soa -> packed", rounds,
+        [&] (std::size_t) {
+            kernels::from_soa(packed_out.data(), soa.view());
+            do_not_optimize(packed_out);
+        }
+    ).per(n));
+    report(run("packed -> padded", rounds,
+        [&] (std::size_t) {
+            kernels::pad(padded.data(), packed.data(), n);
+            do_not_optimize(padded);
+        }
+    ).per(n));
+    report(run("padded -> packed", rounds,
+        [&] (std::size_t) {
+            kernels::unpad(packed_out.data(), padded.data(), n);
+            do_not_optimize(packed_out);
+        }
+    ).per(n));
+
+    std::cout << std::endl;
+}
+
+
+
+
+/**
+ *  Vertex attribute encoders - per-vertex cost of the scalar
+ *  codecs and of the bulk kernels (half floats: 2 floats per
+ *  vertex, unorm8: 4, snorm16: 3, octahedral and quantized: vec3).
+ */
+void codecs (std::size_t iterations) {
+    using vec3 = GVector3<GLfloat>;
+
+    const std::size_t n { 4096 }, rounds { iterations / n + 1 };
+    std::mt19937 generator { 42 };
+    std::uniform_real_distribution<GLfloat> dist { -1.0f, 1.0f };
+    std::vector<vec3> normals(n);
+    for (vec3 &v : normals) {
+        v.assign(dist(generator), dist(generator), dist(generator));
+        v.normalize();
+    }
+    std::vector<GLfloat> flat(n*4);
+    for (GLfloat &f : flat) { f = dist(generator); }
+    std::vector<std::uint16_t> halves(n*2);
+    std::vector<std::uint8_t> bytes(n*4);
+    std::vector<std::int16_t> shorts(n*3);
+    std::vector<snorm16x2> octahedral(n);
+    std::vector<unorm16x4> quantized(n);
+    const vec3 min { -1.0f, -1.0f, -1.0f }, max { 1.0f, 1.0f, 1.0f };
+
+    section("codecs")
+        << " (" << rounds << " x " << n << " vertices):" << std::endl;
+
+    #define codec_pair(label, scalar, kernel) { \
+        Result base { run(label " [scalar]", rounds, \
+            [&] (std::size_t) { scalar; do_not_optimize(flat); } \
+        ).per(n) }; \
+        report(base); \
+        report(run(label " [kernel]", rounds, \
+            [&] (std::size_t) { kernel; do_not_optimize(flat); } \
+        ).per(n), &base); \
+    }
+    codec_pair("to_half x2",
+        for (std::size_t i = 0;  i < n*2;  i++) {
+            halves[i] = to_half(flat[i]);
+        },
+        kernels::to_half(halves.data(), flat.data(), n*2)
+    )
+    codec_pair("to_unorm8 x4",
+        for (std::size_t i = 0;  i < n*4;  i++) {
+            bytes[i] = to_unorm8(flat[i]);
+        },
+        kernels::to_unorm8(bytes.data(), flat.data(), n*4)
+    )
+    codec_pair("to_snorm16 x3",
+        for (std::size_t i = 0;  i < n*3;  i++) {
+            shorts[i] = to_snorm16(flat[i]);
+        },
+        kernels::to_snorm16(shorts.data(), flat.data(), n*3)
+    )
+    codec_pair("to_octahedral",
+        for (std::size_t i = 0;  i < n;  i++) {
+            octahedral[i] = to_octahedral(normals[i]);
+        },
+        kernels::to_octahedral(octahedral.data(), normals.data(), n)
+    )
+    codec_pair("quantize",
+        for (std::size_t i = 0;  i < n;  i++) {
+            quantized[i] = quantize(normals[i], min, max);
+        },
+        kernels::quantize(quantized.data(), normals.data(), n, min, max)
+    )
+    #undef codec_pair
+
+    std::cout << std::endl;
+}
+
+
+
+
+/**
+ *  Dispatched kernels on every code path the cpu supports
+ *  (relative to the baseline path).
+ */
+void dispatch (std::size_t iterations) {
+    using vec3 = GVector3<GLfloat>;
+    using mat4 = GMatrix4<GLfloat>;
+
+    const std::size_t n { 4096 }, rounds { iterations / n + 1 };
+    std::mt19937 generator { 42 };
+    std::uniform_real_distribution<GLfloat> dist { -10.0f, 10.0f };
+    std::vector<vec3> vectors(n), vectors_out(n);
+    for (vec3 &v : vectors) {
+        v.assign(dist(generator), dist(generator), dist(generator));
+    }
+    std::vector<mat4> matrices(n), matrices_out(n);
+    for (mat4 &m : matrices) {
+        for (std::size_t i = 0;  i < 16;  i++) { m[i] = dist(generator); }
+    }
+    mat4 m;
+    m.load_rotation(30, 1, 2, 3);
+
+    const kernels::isa
+        initial { kernels::active_isa() },
+        paths[] { kernels::isa::baseline, kernels::isa::avx2_fma };
+    Result base[3];
+
+    section("dispatch")
+        << " (" << rounds << " x " << n << " elements, "
+        << "detected: " << kernels::isa_name(initial) << "):" << std::endl;
+
+    for (const kernels::isa path : paths) {
+        if (!kernels::select_isa(path)) { continue; }
+        const std::string suffix {
+            std::string(" [") + kernels::isa_name(path) + "]"
+        };
+        const bool first { path == kernels::isa::baseline };
+        Result r[3] {
+            run("multiply" + suffix, rounds,
+                [&] (std::size_t) {
+                    kernels::multiply(
+                        matrices_out.data(), m, matrices.data(), n
+                    );
+                    do_not_optimize(matrices_out);
+                }
+            ).per(n),
+            run("transform_points" + suffix, rounds,
+                [&] (std::size_t) {
+                    kernels::transform_points(
+                        vectors_out.data(), m, vectors.data(), n
+                    );
+                    do_not_optimize(vectors_out);
+                }
+            ).per(n),
+            run("normalize" + suffix, rounds,
+                [&] (std::size_t) {
+                    kernels::normalize(vectors_out.data(), vectors.data(), n);
+                    do_not_optimize(vectors_out);
+                }
+            ).per(n)
+        };
+        for (std::size_t i = 0;  i < 3;  i++) {
+            if (first) { base[i] = r[i]; }
+            report(r[i], first ? nullptr : &base[i]);
+        }
+    }
+    kernels::select_isa(initial);
+
+    std::cout << std::endl;
+}
+
+
+
+
+/**
+ *  Bounding volume batch tests against a plane set
+ *  (per-volume cost, packets versus one volume at a time).
+ */
+void bounds (std::size_t iterations) {
+    using vec3 = GVector3<GLfloat>;
+    using aabb = GAABB<GLfloat>;
+    using sphere = GSphere<GLfloat>;
+    using plane = GPlane<GLfloat>;
+
+    const std::size_t n { 4096 }, rounds { iterations / n + 1 };
+    std::mt19937 generator { 42 };
+    std::uniform_real_distribution<GLfloat> dist { -100.0f, 100.0f };
+    std::vector<aabb> boxes(n);
+    std::vector<sphere> spheres(n);
+    for (std::size_t i = 0;  i < n;  i++) {
+        const vec3
+            c { dist(generator), dist(generator), dist(generator) },
+            e { std::fabs(dist(generator)) * 0.05f, 1.0f, 2.0f };
+        boxes[i] = aabb(c - e, c + e);
+        spheres[i] = sphere(c, e.length());
+    }
+    std::vector<plane> planes;
+    for (std::size_t i = 0;  i < 6;  i++) {
+        planes.push_back(plane(
+            dist(generator), dist(generator), dist(generator), dist(generator)
+        ).normalize());
+    }
+    std::vector<containment> result(n);
+
+    section("bounds")
+        << " (" << rounds << " x " << n << " volumes, "
+        << planes.size() << " planes):" << std::endl;
+
+    Result base { run("aabb::classify", rounds,
+        [&] (std::size_t) {
+            for (std::size_t i = 0;  i < n;  i++) {
+                result[i] = boxes[i].classify(planes.data(), planes.size());
+            }
+            do_not_optimize(result);
+        }
+    ).per(n) };
+    report(base);
+    report(run("classify boxes [batch]", rounds,
+        [&] (std::size_t) {
+            classify(
+                result.data(), planes.data(), planes.size(),
+                boxes.data(), n
+            );
+            do_not_optimize(result);
+        }
+    ).per(n), &base);
+    aligned_vector<GBoxP<GLfloat>> packed;
+    GBoxP<GLfloat>::pack(packed, boxes.data(), n);
+    report(run("classify boxes [packed]", rounds,
+        [&] (std::size_t) {
+            classify(
+                result.data(), planes.data(), planes.size(),
+                packed.data(), n
+            );
+            do_not_optimize(result);
+        }
+    ).per(n), &base);
+    base = run("sphere::classify", rounds,
+        [&] (std::size_t) {
+            for (std::size_t i = 0;  i < n;  i++) {
+                result[i] = spheres[i].classify(planes.data(), planes.size());
+            }
+            do_not_optimize(result);
+        }
+    ).per(n);
+    report(base);
+    report(run("classify spheres [batch]", rounds,
+        [&] (std::size_t) {
+            classify(
+                result.data(), planes.data(), planes.size(),
+                spheres.data(), n
+            );
+            do_not_optimize(result);
+        }
+    ).per(n), &base);
+
+    std::cout << std::endl;
+}
+
+
+
+
+/**
+ *  Closest-hit ray casting against a height field mesh (scalar
+ *  versus packet triangle tests) and ray - box tests against
+ *  a set of BVH node boxes. Results are per ray.
+ */
+void rays (std::size_t iterations) {
+    using vec3 = GVector3<GLfloat>;
+    using mat4 = GMatrix4<GLfloat>;
+    using aabb = GAABB<GLfloat>;
+    using ray = GRay<GLfloat>;
+    using hit = GRayHit<GLfloat>;
+    constexpr std::size_t W { native_width<GLfloat>::value };
+    using packet = GPacket<GLfloat, W>;
+
+    // 32 x 32 quads, 2048 triangles
+    const std::size_t side { 33 }, screen { 64 }, k { 64 };
+    std::mt19937 generator { 42 };
+    std::uniform_real_distribution<GLfloat> dist { -1.0f, 1.0f };
+    std::vector<vec3> vertices;
+    std::vector<GLushort> indices;
+    for (std::size_t i = 0;  i < side;  i++) {
+        for (std::size_t j = 0;  j < side;  j++) {
+            vertices.push_back(vec3(
+                static_cast<GLfloat>(i) - 16.0f, static_cast<GLfloat>(j) - 16.0f,
+                dist(generator)
+            ));
+        }
+    }
+    for (std::size_t i = 0;  i + 1 < side;  i++) {
+        for (std::size_t j = 0;  j + 1 < side;  j++) {
+            const GLushort a {
+                static_cast<GLushort>(i*side + j)
+            };
+            const GLushort quad[6] {
+                a, static_cast<GLushort>(a + side), static_cast<GLushort>(a + 1),
+                static_cast<GLushort>(a + 1), static_cast<GLushort>(a + side),
+                static_cast<GLushort>(a + side + 1)
+            };
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+    const std::size_t triangles { indices.size() / 3 };
+    const aligned_vector<GTriangleP<GLfloat, W>> packets {
+        pack_triangles<GLfloat, W>(vertices.data(), indices.data(), triangles)
+    };
+
+    // camera rays through a "screen" x "screen" pixel grid
+    mat4 projection, view;
+    projection.load_perspective(60.0f, 1.0f, 1.0f, 100.0f);
+    view.load_translation(0.0f, 0.0f, -30.0f);
+    const mat4 clip { projection * view };
+    std::vector<ray> camera_rays;
+    for (std::size_t y = 0;  y < screen;  y++) {
+        for (std::size_t x = 0;  x < screen;  x++) {
+            camera_rays.push_back(unproject(clip,
+                static_cast<GLfloat>(x) + 0.5f, static_cast<GLfloat>(y) + 0.5f,
+                static_cast<GLfloat>(screen), static_cast<GLfloat>(screen)
+            ));
+        }
+    }
+    const std::size_t n { camera_rays.size() };
+
+    // boxes (as stored by a "W"-wide BVH)
+    std::vector<aabb> boxes(k);
+    for (aabb &b : boxes) {
+        const vec3
+            c { dist(generator) * 16.0f, dist(generator) * 16.0f, 0.0f },
+            e { 1.0f, 1.0f, 1.0f };
+        b = aabb(c - e, c + e);
+    }
+    aligned_vector<GAABBP<GLfloat, W>> nodes;
+    for (std::size_t i = 0;  i < k;  i += W) {
+        nodes.push_back(GAABBP<GLfloat, W>::gather(&boxes[i], W));
+    }
+
+    std::vector<hit> hits(n);
+    std::vector<GLfloat> entries(n);
+    const std::size_t
+        cast_rounds { iterations / (n * triangles / 64) + 1 },
+        box_rounds { iterations / (n * k / 64) + 1 };
+
+    section("rays")
+        << " (per ray, " << n << " rays, " << triangles << " triangles, "
+        << k << " boxes):" << std::endl;
+
+    Result base { run("closest hit [scalar]", cast_rounds,
+        [&] (std::size_t) {
+            for (std::size_t r = 0;  r < n;  r++) {
+                hit h;
+                for (std::size_t i = 0;  i < triangles;  i++) {
+                    if (intersect(camera_rays[r],
+                        vertices[indices[i*3]], vertices[indices[i*3 + 1]],
+                        vertices[indices[i*3 + 2]], h
+                    )) { h.index = i; }
+                }
+                hits[r] = h;
+            }
+            do_not_optimize(hits);
+        }
+    ).per(n) };
+    report(base);
+    Result result { run("closest hit [packet, indexed]", cast_rounds,
+        [&] (std::size_t) {
+            for (std::size_t r = 0;  r < n;  r++) {
+                hit h;
+                intersect(camera_rays[r],
+                    vertices.data(), indices.data(), triangles, h
+                );
+                hits[r] = h;
+            }
+            do_not_optimize(hits);
+        }
+    ).per(n) };
+    report(result, &base);
+    result = run("closest hit [packet, packed]", cast_rounds,
+        [&] (std::size_t) {
+            for (std::size_t r = 0;  r < n;  r++) {
+                hit h;
+                intersect(camera_rays[r], packets.data(), packets.size(), h);
+                hits[r] = h;
+            }
+            do_not_optimize(hits);
+        }
+    ).per(n);
+    report(result, &base);
+
+    base = run("ray/box [scalar]", box_rounds,
+        [&] (std::size_t) {
+            for (std::size_t r = 0;  r < n;  r++) {
+                const vec3 inv { camera_rays[r].inv_direction() };
+                GLfloat nearest { std::numeric_limits<GLfloat>::infinity() };
+                for (const aabb &b : boxes) {
+                    GLfloat t;
+                    if (intersect(camera_rays[r], inv, b, t, nearest)) { nearest = t; }
+                }
+                entries[r] = nearest;
+            }
+            do_not_optimize(entries);
+        }
+    ).per(n);
+    report(base);
+    result = run("ray/box [packet]", box_rounds,
+        [&] (std::size_t) {
+            for (std::size_t r = 0;  r < n;  r++) {
+                const GRayP<GLfloat, W> rp { camera_rays[r] };
+                packet nearest { std::numeric_limits<GLfloat>::infinity() };
+                for (const GAABBP<GLfloat, W> &node : nodes) {
+                    packet t;
+                    nearest = select(
+                        intersect(rp, node, nearest, t), t, nearest
+                    );
+                }
+                GLfloat lanes[W];
+                nearest.store(lanes);
+                entries[r] = *std::min_element(lanes, lanes + W);
+            }
+            do_not_optimize(entries);
+        }
+    ).per(n);
+    report(result, &base);
+
+    std::cout << std::endl;
+}
+
+
+
+
+/**
+ *  Scene graph updates per frame - a static "stage" of
+ *  32 groups x 31 nodes and a group of 12 animated leaves
+ *  (everything changed, leaves changed, nothing changed).
+ */
+void scene (std::size_t iterations) {
+    using affine = GAffine<GLfloat>;
+    using machina::Scene;
+
+    const std::size_t rounds { iterations / 64 + 1 };
+    std::mt19937 generator { 42 };
+    std::uniform_real_distribution<GLfloat> dist { -100.0f, 100.0f };
+    auto placement = [&] () {
+        return affine().load_translation(
+            dist(generator), dist(generator), dist(generator)
+        ) * affine().load_rotation_y(dist(generator));
+    };
+
+    Scene graph;
+    for (std::size_t i = 0;  i < 32;  i++) {
+        const Scene::node group { graph.add(Scene::root, nullptr, placement()) };
+        for (std::size_t j = 0;  j < 31;  j++) {
+            graph.add(group, nullptr, placement());
+        }
+    }
+    const Scene::node ring { graph.add(Scene::root) };
+    Scene::node leaves[12];
+    for (std::size_t i = 0;  i < 12;  i++) {
+        leaves[i] = graph.add(ring);
+    }
+    std::vector<affine> locals(64);
+    for (auto &l : locals) { l = placement(); }
+    graph.update();
+
+    section("scene")
+        << " (" << rounds << " frames, " << graph.size()
+        << " nodes):" << std::endl;
+
+    #define at(v, k) v[(i + k) & 63]
+    Result base { run("update [root changed]", rounds,
+        [&] (std::size_t i) {
+            graph.set_local(Scene::root, at(locals, 0));
+            do_not_optimize(graph.update());
+        }
+    ) };
+    report(base);
+    report(run("update [12 leaves changed]", rounds,
+        [&] (std::size_t i) {
+            for (std::size_t j = 0;  j < 12;  j++) {
+                graph.set_local(leaves[j], at(locals, j));
+            }
+            do_not_optimize(graph.update());
+        }
+    ), &base);
+    report(run("update [nothing changed]", rounds,
+        [&] (std::size_t) {
+            do_not_optimize(graph.update());
+        }
+    ), &base);
+    #undef at
+
+    std::cout << std::endl;
+}
+
+
+
+
+    } // namespace bench
+} // namespace m3d
+
+
+
+
+/**
+ *  Benchmark entry-point
+ *  ("m3d_bench [iterations] [--samples n] [--json file]").
+ */
+int main (int argc, char *argv[]) {
+    std::size_t iterations { 2000000 };
+    std::string json;
+    try {
+        for (int i = 1;  i < argc;  i++) {
+            const std::string arg { argv[i] };
+            if (arg == "--samples"  &&  i + 1 < argc) {
+                m3d::bench::settings().samples = m3d::bench::count(argv[++i]);
+            } else if (arg == "--json"  &&  i + 1 < argc) {
+                json = argv[++i];
+            } else {
+                iterations = m3d::bench::count(arg);
+            }
+        }
+    } catch (const std::logic_error &) {
+        std::cerr
+            << "usage: m3d_bench [iterations] [--samples n] [--json file]"
+            << std::endl;
+        return 1;
+    }
+
+    m3d::bench::primitives(iterations);
+    m3d::bench::expressions(iterations);
+    m3d::bench::transforms(iterations);
+    m3d::bench::trig(iterations);
+    m3d::bench::layouts(iterations);
+    m3d::bench::codecs(iterations);
+    m3d::bench::dispatch(iterations);
+    m3d::bench::bounds(iterations);
+    m3d::bench::rays(iterations);
+    m3d::bench::scene(iterations);
+
+    if (!json.empty()) {
+        std::ofstream out { json };
+        m3d::bench::write_json(out, iterations);
+        if (!out) {
+            std::cerr << "cannot write " << json << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+
+
+#endif
@@ -0,0 +1,229 @@
+/**
+ *  machina
+ *
+ *  Copyright (c) 2015, drmats
+ *  All rights reserved.
+ *
+ *  https://github.com/drmats/machina
+ */
+
+#ifndef __M3D_BENCH_HPP_
+#define __M3D_BENCH_HPP_ 1
+
+#include "m3d.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace m3d {
+    namespace bench {
+
+
+
+
+/**
+ *  Keep a value (and the memory it points to) alive,
+ *  so the optimizer cannot drop the measured computation.
+ */
+template <typename T>
+inline void do_not_optimize (const T &value) {
+#if defined(__GNUC__)
+    __asm__ __volatile__ ("" : : "r"(&value) : "memory");
+#else
+    static const volatile T *sink { nullptr };
+    sink = &value;
+#endif
+}
+
+
+
+
+/**
+ *  User-space retired instructions counter
+ *  (Linux perf events - unavailable elsewhere or when not permitted).
+ */
+class InstructionCounter {
+
+private:
+
+    /**
+     *  Perf event file descriptor.
+     */
+    int fd { -1 };
+
+
+public:
+
+    /**
+     *  Open the counter (silently disabled on failure).
+     */
+    InstructionCounter ();
+
+
+    /**
+     *  Clean-up.
+     */
+    ~InstructionCounter ();
+
+
+    /**
+     *  Can instructions be counted?
+     */
+    bool available () const { return this->fd >= 0; }
+
+
+    /**
+     *  Reset and start counting.
+     */
+    void start ();
+
+
+    /**
+     *  Stop counting and return the number of instructions
+     *  retired since "start()" (zero when unavailable).
+     */
+    std::uint64_t stop ();
+
+};
+
+
+
+
+/**
+ *  Benchmark settings (command line).
+ */
+struct Settings {
+    std::size_t samples { 5 };  // timed repetitions of every measurement
+};
+
+
+Settings& settings ();
+
+
+
+
+/**
+ *  Measurement result (times of the median, fastest and slowest
+ *  sample, relative standard deviation of samples).
+ */
+struct Result {
+    std::string name;
+    double ns_per_op;
+    double instructions_per_op;  // negative when unavailable
+    double ns_min, ns_max;
+    double deviation;
+
+    /**
+     *  Per-element result of an operation processing "n" elements.
+     */
+    Result per (std::size_t n) const {
+        const double d { static_cast<double>(n) };
+        return Result {
+            this->name, this->ns_per_op / d,
+            this->instructions_per_op < 0 ?
+                this->instructions_per_op : this->instructions_per_op / d,
+            this->ns_min / d, this->ns_max / d, this->deviation
+        };
+    }
+
+    /**
+     *  Operations per second (median sample).
+     */
+    double throughput () const {
+        return this->ns_per_op > 0 ? 1e9 / this->ns_per_op : 0.0;
+    }
+};
+
+
+
+
+/**
+ *  Measure "f(i)" for i in [0, iterations) after a short warm-up,
+ *  split into "settings().samples" timed samples.
+ */
+template <typename F>
+Result run (const std::string &name, std::size_t iterations, F f) {
+    using clock = std::chrono::steady_clock;
+    InstructionCounter counter;
+    const std::size_t
+        samples { std::max<std::size_t>(settings().samples, 1) },
+        chunk { std::max<std::size_t>((iterations + samples - 1) / samples, 1) };
+    std::vector<double> ns(samples);
+
+    for (std::size_t i = 0;  i < iterations / 10;  i++) { f(i); }
+
+    counter.start();
+    for (std::size_t s = 0, i = 0;  s < samples;  s++) {
+        const clock::time_point start { clock::now() };
+        for (std::size_t j = 0;  j < chunk;  j++, i++) { f(i); }
+        const clock::time_point end { clock::now() };
+        ns[s] =
+            std::chrono::duration<double, std::nano>(end - start).count() /
+            static_cast<double>(chunk);
+    }
+    const std::uint64_t instructions { counter.stop() };
+
+    double mean { 0.0 }, variance { 0.0 };
+    for (const double x : ns) { mean += x / static_cast<double>(samples); }
+    for (const double x : ns) {
+        variance += (x - mean) * (x - mean) / static_cast<double>(samples);
+    }
+    std::sort(ns.begin(), ns.end());
+
+    return Result {
+        name,
+        samples % 2 == 1 ?
+            ns[samples / 2] : (ns[samples / 2 - 1] + ns[samples / 2]) * 0.5,
+        counter.available() ?
+            static_cast<double>(instructions) /
+                static_cast<double>(chunk * samples) : -1.0,
+        ns.front(), ns.back(),
+        mean > 0 ? std::sqrt(variance) / mean : 0.0
+    };
+}
+
+
+
+
+/**
+ *  Start a section of results: print its name (the caller
+ *  continues the header line) and tag following reports with it.
+ */
+std::ostream& section (const std::string &);
+
+
+
+
+/**
+ *  Print a result line (relative to "baseline", if given)
+ *  and keep it for the JSON summary.
+ */
+void report (const Result &, const Result *baseline = nullptr);
+
+
+
+
+/**
+ *  Parse a positive count argument (iterations, samples).
+ */
+std::size_t count (const std::string &);
+
+
+
+
+/**
+ *  Write all reported results as JSON.
+ */
+void write_json (std::ostream &, std::size_t iterations);
+
+
+
+
+    } // namespace bench
+} // namespace m3d
+
+#endif
@@ -0,0 +1,258 @@
+/**
+ *  machina
+ *
+ *  Copyright (c) 2015, drmats
+ *  All rights reserved.
+ *
+ *  https://github.com/drmats/machina
+ */
+
+#ifndef __M3D_CODEC_HPP_
+#define __M3D_CODEC_HPP_ 1
+
+#include "m3d.hpp"
+#include "gaffine.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+namespace m3d {
+
+
+
+
+/**
+ *  Packed vertex attribute types (layouts match normalized
+ *  "glVertexAttribPointer" formats):
+ *      half2      -- two half floats (GL_HALF_FLOAT)
+ *      unorm8x4   -- four bytes mapped to [0, 1] (GL_UNSIGNED_BYTE)
+ *      snorm16x2  -- two shorts mapped to [-1, 1] (GL_SHORT)
+ *      unorm16x4  -- four unsigned shorts mapped to [0, 1]
+ *                    (GL_UNSIGNED_SHORT, quantized positions use
+ *                    the first three)
+ */
+using half2 = GArray<std::uint16_t, 2>;
+using unorm8x4 = GArray<std::uint8_t, 4>;
+using snorm16x2 = GArray<std::int16_t, 2>;
+using unorm16x4 = GArray<std::uint16_t, 4>;
+
+
+
+
+namespace codec {
+
+    /**
+     *  Bit casts between float and its representation.
+     */
+    inline std::uint32_t bits (float f) {
+        std::uint32_t u;
+        std::memcpy(&u, &f, sizeof(u));
+        return u;
+    }
+
+
+    inline float from_bits (std::uint32_t u) {
+        float f;
+        std::memcpy(&f, &u, sizeof(f));
+        return f;
+    }
+
+
+    /**
+     *  Clamp to [lo, hi] with NaN mapped to "lo" (the order of
+     *  comparisons is the one of SSE "max" followed by "min").
+     */
+    constexpr float clamp (float x, float lo, float hi) {
+        return x > lo ? (x < hi ? x : hi) : lo;
+    }
+
+}
+
+
+
+
+/**
+ *  Float to half float (round to nearest even, overflow to
+ *  infinity, NaN preserved as quiet NaN, subnormals kept).
+ */
+inline std::uint16_t to_half (float f) {
+    const std::uint32_t
+        x { codec::bits(f) },
+        sign { (x >> 16) & 0x8000u },
+        a { x & 0x7fffffffu };
+
+    // too large (or inf/nan)
+    if (a >= 0x47800000u) {
+        return static_cast<std::uint16_t>(
+            sign | (a > 0x7f800000u ? 0x7e00u : 0x7c00u)
+        );
+    }
+
+    // subnormal half (float addition does the rounding)
+    if (a < 0x38800000u) {
+        const float denormal_magic { codec::from_bits(0x3f000000u) };
+        return static_cast<std::uint16_t>(sign | (
+            codec::bits(codec::from_bits(a) + denormal_magic) - 0x3f000000u
+        ));
+    }
+
+    // normal half (rebias exponent, round mantissa)
+    return static_cast<std::uint16_t>(sign | (
+        (a + 0xc8000fffu + ((a >> 13) & 1u)) >> 13
+    ));
+}
+
+
+
+
+/**
+ *  Half float to float (exact).
+ */
+inline float from_half (std::uint16_t h) {
+    const std::uint32_t
+        shifted_exp { 0x7c00u << 13 },
+        m { (h & 0x7fffu) << 13u },
+        exp { m & shifted_exp };
+    std::uint32_t u { m + 0x38000000u };
+
+    if (exp == shifted_exp) {
+        u += 0x38000000u;
+    } else if (exp == 0) {
+        u = codec::bits(
+            codec::from_bits(u + 0x00800000u) - codec::from_bits(0x38800000u)
+        );
+    }
+    u |= static_cast<std::uint32_t>(h & 0x8000u) << 16;
+    return codec::from_bits(u);
+}
+
+
+
+
+/**
+ *  Normalized integers (values are clamped, rounding is to nearest
+ *  even, decoding follows the OpenGL conversion rules).
+ */
+inline std::uint8_t to_unorm8 (float f) {
+    return static_cast<std::uint8_t>(
+        std::lrint(codec::clamp(f, 0.0f, 1.0f) * 255.0f)
+    );
+}
+
+
+constexpr float from_unorm8 (std::uint8_t c) {
+    return static_cast<float>(c) / 255.0f;
+}
+
+
+inline std::uint16_t to_unorm16 (float f) {
+    return static_cast<std::uint16_t>(
+        std::lrint(codec::clamp(f, 0.0f, 1.0f) * 65535.0f)
+    );
+}
+
+
+constexpr float from_unorm16 (std::uint16_t c) {
+    return static_cast<float>(c) / 65535.0f;
+}
+
+
+inline std::int16_t to_snorm16 (float f) {
+    return static_cast<std::int16_t>(
+        std::lrint(codec::clamp(f, -1.0f, 1.0f) * 32767.0f)
+    );
+}
+
+
+constexpr float from_snorm16 (std::int16_t c) {
+    return std::max(static_cast<float>(c) / 32767.0f, -1.0f);
+}
+
+
+
+
+/**
+ *  Octahedral encoding of a unit vector - projection onto the
+ *  octahedron |x| + |y| + |z| = 1, lower half folded over the
+ *  diagonals, stored as two snorm16 (zero vector maps to [0, 0]).
+ */
+inline snorm16x2 to_octahedral (const GArray<float, 3> &n) {
+    const float l1 { std::fabs(n[0]) + std::fabs(n[1]) + std::fabs(n[2]) };
+    float u { 0.0f }, v { 0.0f };
+    if (l1 > 0.0f) {
+        u = n[0] / l1;
+        v = n[1] / l1;
+        if (n[2] < 0.0f) {
+            const float fu { 1.0f - std::fabs(v) }, fv { 1.0f - std::fabs(u) };
+            u = std::copysign(fu, u);
+            v = std::copysign(fv, v);
+        }
+    }
+    snorm16x2 e;
+    e[0] = to_snorm16(u);
+    e[1] = to_snorm16(v);
+    return e;
+}
+
+
+inline GVector3<float> from_octahedral (const snorm16x2 &e) {
+    const float u { from_snorm16(e[0]) }, v { from_snorm16(e[1]) };
+    GVector3<float> n { u, v, 1.0f - std::fabs(u) - std::fabs(v) };
+    if (n[2] < 0.0f) {
+        n[0] = std::copysign(1.0f - std::fabs(v), u);
+        n[1] = std::copysign(1.0f - std::fabs(u), v);
+    }
+    return n.normalize();
+}
+
+
+
+
+/**
+ *  Position quantization relative to a bounding box ("min", "max")
+ *  - every component is mapped to [0, 1] over the box and stored
+ *  as unorm16 (4th component is zero). "dequantization" is the
+ *  affine transformation from normalized attributes back to the
+ *  box (to be folded into the model matrix).
+ */
+inline GVector3<float> quantization_scale (
+    const GArray<float, 3> &min, const GArray<float, 3> &max
+) {
+    GVector3<float> s;
+    for (std::size_t i = 0;  i < 3;  i++) {
+        const float extent { max[i] - min[i] };
+        s[i] = extent > 0.0f ? 1.0f / extent : 0.0f;
+    }
+    return s;
+}
+
+
+inline unorm16x4 quantize (
+    const GArray<float, 3> &p,
+    const GArray<float, 3> &min, const GArray<float, 3> &max
+) {
+    const GVector3<float> s { quantization_scale(min, max) };
+    unorm16x4 q;
+    for (std::size_t i = 0;  i < 3;  i++) {
+        q[i] = to_unorm16((p[i] - min[i]) * s[i]);
+    }
+    return q;
+}
+
+
+inline GAffine<float> dequantization (
+    const GArray<float, 3> &min, const GArray<float, 3> &max
+) {
+    return
+        GAffine<float>().load_translation(min) *
+        GAffine<float>().load_scale(
+            max[0] - min[0], max[1] - min[1], max[2] - min[2]
+        );
+}
+
+
+
+} // namespace m3d
+
+#endif
@@ -0,0 +1,1090 @@
+/**
+ *  machina
+ *
+ *  Copyright (c) 2015, drmats
+ *  All rights reserved.
+ *
+ *  https://github.com/drmats/machina
+ */
+
+#ifndef __M3D_KERNELS_CPP_
+#define __M3D_KERNELS_CPP_ 1
+
+#include "m3d_kernels.hpp"
+#include "m3d_packet.hpp"
+#include "m3d_kernels_avx2.hpp"
+#include <limits>
+
+namespace m3d {
+    namespace kernels {
+
+
+
+
+/**
+ *  Raw float access to packed vector arrays.
+ */
+inline GLfloat* raw (vec3 *v) { return reinterpret_cast<GLfloat*>(v); }
+inline const GLfloat* raw (const vec3 *v) {
+    return reinterpret_cast<const GLfloat*>(v);
+}
+
+
+
+
+/**
+ *  Scalar point/direction transform (w = 0 or 1),
+ *  same summation order as m3d::matrix_transform.
+ */
+inline void transform_one (
+    GLfloat *out, const GLfloat *m, const GLfloat *in, GLfloat w
+) {
+    const GLfloat x { in[0] }, y { in[1] }, z { in[2] };
+    GLfloat val;
+    for (std::size_t i = 0;  i < 3;  i++) {
+        val = 0.0f;
+        val += m[i] * x;
+        val += m[i + 4] * y;
+        val += m[i + 8] * z;
+        val += m[i + 12] * w;
+        out[i] = val;
+    }
+}
+
+
+
+
+#if defined(M3D_SSE2)
+
+/**
+ *  Load four packed 3-vectors (12 floats) as x, y and z registers.
+ */
+inline void load_soa (const GLfloat *p, __m128 &x, __m128 &y, __m128 &z) {
+    const __m128
+        r0 { _mm_loadu_ps(p) },        // x0 y0 z0 x1
+        r1 { _mm_loadu_ps(p + 4) },    // y1 z1 x2 y2
+        r2 { _mm_loadu_ps(p + 8) },    // z2 x3 y3 z3
+        t0 { _mm_shuffle_ps(r0, r1, _MM_SHUFFLE(1, 0, 2, 1)) },  // y0 z0 y1 z1
+        t1 { _mm_shuffle_ps(r1, r2, _MM_SHUFFLE(2, 1, 3, 2)) };  // x2 y2 x3 y3
+    x = _mm_shuffle_ps(r0, t1, _MM_SHUFFLE(2, 0, 3, 0));
+    y = _mm_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 1, 2, 0));
+    z = _mm_shuffle_ps(t0, r2, _MM_SHUFFLE(3, 0, 3, 1));
+}
+
+
+
+
+/**
+ *  Store x, y and z registers as four packed 3-vectors.
+ */
+inline void store_soa (GLfloat *p, __m128 x, __m128 y, __m128 z) {
+    const __m128
+        r0 { _mm_shuffle_ps(
+            _mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 0, 0, 0)),   // x0 x0 y0 y0
+            _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0)),   // z0 z0 x1 x1
+            _MM_SHUFFLE(2, 0, 2, 0)
+        ) },
+        r1 { _mm_shuffle_ps(
+            _mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1)),   // y1 y1 z1 z1
+            _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2)),   // x2 x2 y2 y2
+            _MM_SHUFFLE(2, 0, 2, 0)
+        ) },
+        r2 { _mm_shuffle_ps(
+            _mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)),   // z2 z2 x3 x3
+            _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)),   // y3 y3 z3 z3
+            _MM_SHUFFLE(2, 0, 2, 0)
+        ) };
+    _mm_storeu_ps(p, r0);
+    _mm_storeu_ps(p + 4, r1);
+    _mm_storeu_ps(p + 8, r2);
+}
+
+
+
+
+/**
+ *  Transform four points/directions held in x, y, z registers
+ *  (same summation order as the scalar path).
+ */
+inline void transform_soa (
+    const GLfloat *m, __m128 &x, __m128 &y, __m128 &z, bool point
+) {
+    __m128 r[3];
+    for (std::size_t i = 0;  i < 3;  i++) {
+        r[i] = _mm_setzero_ps();
+        r[i] = _mm_add_ps(r[i], _mm_mul_ps(_mm_set1_ps(m[i]), x));
+        r[i] = _mm_add_ps(r[i], _mm_mul_ps(_mm_set1_ps(m[i + 4]), y));
+        r[i] = _mm_add_ps(r[i], _mm_mul_ps(_mm_set1_ps(m[i + 8]), z));
+        if (point) {
+            r[i] = _mm_add_ps(r[i], _mm_set1_ps(m[i + 12]));
+        }
+    }
+    x = r[0];  y = r[1];  z = r[2];
+}
+
+#endif
+
+
+
+
+/**
+ *  Shared body of transform_points and transform_directions.
+ */
+inline void transform_vec3 (
+    vec3 *out, const mat4 &m, const vec3 *in, std::size_t n, bool point
+) {
+    const GLfloat *mm { *m };
+    const GLfloat *src { raw(in) };
+    GLfloat *dst { raw(out) };
+    std::size_t i { 0 };
+
+#if defined(M3D_SSE2)
+    __m128 x, y, z;
+    for (;  i + 4 <= n;  i += 4) {
+        load_soa(src + i*3, x, y, z);
+        transform_soa(mm, x, y, z, point);
+        store_soa(dst + i*3, x, y, z);
+    }
+#endif
+
+    for (;  i < n;  i++) {
+        GLfloat tmp[3];
+        transform_one(tmp, mm, src + i*3, point ? 1.0f : 0.0f);
+        dst[i*3] = tmp[0];  dst[i*3 + 1] = tmp[1];  dst[i*3 + 2] = tmp[2];
+    }
+}
+
+
+
+
+/**
+ *  Transform four component vectors by a matrix.
+ */
+void transform (vec4 *out, const mat4 &m, const vec4 *in, std::size_t n) {
+    GLfloat tmp[4];
+    for (std::size_t i = 0;  i < n;  i++) {
+        matrix_transform<GLfloat, 4>(tmp, *m, *in[i]);
+        out[i].assign(tmp);
+    }
+}
+
+
+
+
+/**
+ *  Transform points by a (model-)view-projection matrix, perform
+ *  perspective divide and map the result to the window coordinates.
+ */
+void project_points (
+    vec3 *out, const mat4 &mvp, const vec3 *in, std::size_t n,
+    const vec4 &viewport
+) {
+    const GLfloat *m { *mvp };
+    const GLfloat *src { raw(in) };
+    GLfloat *dst { raw(out) };
+    const GLfloat
+        vx { viewport[0] }, vy { viewport[1] },
+        hw { viewport[2] * 0.5f }, hh { viewport[3] * 0.5f };
+    std::size_t i { 0 };
+
+#if defined(M3D_SSE2)
+    const __m128 one { _mm_set1_ps(1.0f) }, half { _mm_set1_ps(0.5f) };
+    __m128 x, y, z, w;
+    for (;  i + 4 <= n;  i += 4) {
+        load_soa(src + i*3, x, y, z);
+        w = _mm_add_ps(
+            _mm_add_ps(
+                _mm_add_ps(
+                    _mm_mul_ps(_mm_set1_ps(m[3]), x),
+                    _mm_mul_ps(_mm_set1_ps(m[7]), y)
+                ),
+                _mm_mul_ps(_mm_set1_ps(m[11]), z)
+            ),
+            _mm_set1_ps(m[15])
+        );
+        transform_soa(m, x, y, z, true);
+        w = _mm_div_ps(one, w);
+        x = _mm_add_ps(
+            _mm_set1_ps(vx),
+            _mm_mul_ps(_mm_add_ps(_mm_mul_ps(x, w), one), _mm_set1_ps(hw))
+        );
+        y = _mm_add_ps(
+            _mm_set1_ps(vy),
+            _mm_mul_ps(_mm_add_ps(_mm_mul_ps(y, w), one), _mm_set1_ps(hh))
+        );
+        z = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(z, w), one), half);
+        store_soa(dst + i*3, x, y, z);
+    }
+#endif
+
+    for (;  i < n;  i++) {
+        const GLfloat *p { src + i*3 };
+        GLfloat tmp[3];
+        const GLfloat inv_w {
+            1.0f / (m[3]*p[0] + m[7]*p[1] + m[11]*p[2] + m[15])
+        };
+        transform_one(tmp, m, p, 1.0f);
+        dst[i*3] = vx + (tmp[0]*inv_w + 1.0f) * hw;
+        dst[i*3 + 1] = vy + (tmp[1]*inv_w + 1.0f) * hh;
+        dst[i*3 + 2] = (tmp[2]*inv_w + 1.0f) * 0.5f;
+    }
+}
+
+
+
+
+/**
+ *  Shared body of normalize (baseline path).
+ */
+inline void normalize_vec3 (vec3 *out, const vec3 *in, std::size_t n) {
+    std::size_t i { 0 };
+
+#if defined(M3D_SSE2)
+    const GLfloat *src { raw(in) };
+    GLfloat *dst { raw(out) };
+    const __m128
+        one { _mm_set1_ps(1.0f) },
+        epsilon { _mm_set1_ps(static_cast<GLfloat>(m3d_epsilon)) };
+    __m128 x, y, z, l, s;
+    for (;  i + 4 <= n;  i += 4) {
+        load_soa(src + i*3, x, y, z);
+        l = _mm_sqrt_ps(_mm_add_ps(
+            _mm_add_ps(
+                _mm_add_ps(_mm_setzero_ps(), _mm_mul_ps(x, x)),
+                _mm_mul_ps(y, y)
+            ),
+            _mm_mul_ps(z, z)
+        ));
+        s = _mm_andnot_ps(_mm_cmplt_ps(l, epsilon), _mm_div_ps(one, l));
+        store_soa(
+            dst + i*3, _mm_mul_ps(x, s), _mm_mul_ps(y, s), _mm_mul_ps(z, s)
+        );
+    }
+#endif
+
+    for (;  i < n;  i++) {
+        out[i] = vec3(in[i]).normalize();
+    }
+}
+
+
+
+
+/**
+ *  Shared body of multiply (baseline path).
+ */
+inline void multiply_mat4 (
+    mat4 *out, const mat4 &a, const mat4 *b, std::size_t n
+) {
+    const mat4 left { a };
+    for (std::size_t i = 0;  i < n;  i++) {
+        out[i].multiply(left, b[i]);
+    }
+}
+
+
+
+
+/**
+ *  Transform points stored as structure-of-arrays (baseline).
+ */
+inline void transform_points_soa (
+    const soa3_view &out, const mat4 &m, const const_soa3_view &in
+) {
+    const GLfloat *mm { *m };
+    std::size_t i { 0 };
+
+#if defined(M3D_SSE2)
+    const mat4_x4 mp { m };
+    for (;  i + 4 <= in.size;  i += 4) {
+        mp.transform_point(vec3x4::load(in, i)).store(out, i);
+    }
+#endif
+
+    GLfloat p[3];
+    for (;  i < in.size;  i++) {
+        const GLfloat v[3] { in.x[i], in.y[i], in.z[i] };
+        transform_one(p, mm, v, 1.0f);
+        out.x[i] = p[0];
+        out.y[i] = p[1];
+        out.z[i] = p[2];
+    }
+}
+
+
+
+
+/**
+ *  Hot kernels bound per instruction set.
+ */
+struct kernel_table {
+    isa path;
+    void (*multiply) (mat4 *, const mat4 &, const mat4 *, std::size_t);
+    void (*transform_vec3) (
+        vec3 *, const mat4 &, const vec3 *, std::size_t, bool
+    );
+    void (*normalize) (vec3 *, const vec3 *, std::size_t);
+    void (*transform_soa) (
+        const soa3_view &, const mat4 &, const const_soa3_view &
+    );
+};
+
+
+const kernel_table baseline_kernels {
+    isa::baseline, multiply_mat4, transform_vec3, normalize_vec3,
+    transform_points_soa
+};
+
+
+#if defined(M3D_DISPATCH_AVX2)
+
+const kernel_table avx2_kernels {
+    isa::avx2_fma,
+    [] (mat4 *out, const mat4 &a, const mat4 *b, std::size_t n) {
+        avx2::multiply(
+            reinterpret_cast<GLfloat*>(out), *a,
+            reinterpret_cast<const GLfloat*>(b), n
+        );
+    },
+    [] (vec3 *out, const mat4 &m, const vec3 *in, std::size_t n, bool point) {
+        avx2::transform_vec3(raw(out), *m, raw(in), n, point);
+    },
+    [] (vec3 *out, const vec3 *in, std::size_t n) {
+        avx2::normalize(
+            raw(out), raw(in), n, static_cast<GLfloat>(m3d_epsilon)
+        );
+    },
+    [] (const soa3_view &out, const mat4 &m, const const_soa3_view &in) {
+        avx2::transform_points_soa(
+            out.x, out.y, out.z, *m, in.x, in.y, in.z, in.size
+        );
+    }
+};
+
+#endif
+
+
+
+
+/**
+ *  Kernel table of a given path (nullptr when the cpu lacks support).
+ */
+inline const kernel_table* table_of (isa path) {
+    switch (path) {
+        case isa::baseline:
+            return &baseline_kernels;
+        case isa::avx2_fma:
+#if defined(M3D_DISPATCH_AVX2)
+            __builtin_cpu_init();
+            if (
+                __builtin_cpu_supports("avx2")  &&
+                __builtin_cpu_supports("fma")
+            ) {
+                return &avx2_kernels;
+            }
+#endif
+            return nullptr;
+    }
+    return nullptr;
+}
+
+
+
+
+/**
+ *  Best path supported by the cpu.
+ */
+inline const kernel_table* detect () {
+    const kernel_table *best { table_of(isa::avx2_fma) };
+    return best != nullptr ? best : table_of(isa::baseline);
+}
+
+
+
+
+/**
+ *  Currently bound kernels (detected on first use).
+ */
+inline const kernel_table*& active () {
+    static const kernel_table *kernels { detect() };
+    return kernels;
+}
+
+
+
+
+/**
+ *  Path of the dispatched kernels.
+ */
+isa active_isa () {
+    return active()->path;
+}
+
+
+
+
+/**
+ *  Bind kernels of a given path.
+ */
+bool select_isa (isa path) {
+    const kernel_table *kernels { table_of(path) };
+    if (kernels == nullptr) { return false; }
+    active() = kernels;
+    return true;
+}
+
+
+
+
+/**
+ *  Human-readable name of a path.
+ */
+const char* isa_name (isa path) {
+    switch (path) {
+        case isa::baseline:
+#if defined(M3D_AVX)
+            return "avx";
+#elif defined(M3D_SSE2)
+            return "sse2";
+#else
+            return "generic";
+#endif
+        case isa::avx2_fma:
+            return "avx2+fma";
+    }
+    return "unknown";
+}
+
+
+
+
+/**
+ *  Multiply matrices: out[i] = a * b[i].
+ */
+void multiply (mat4 *out, const mat4 &a, const mat4 *b, std::size_t n) {
+    active()->multiply(out, a, b, n);
+}
+
+
+
+
+/**
+ *  Transform points (w = 1) by a matrix (no perspective divide).
+ */
+void transform_points (
+    vec3 *out, const mat4 &m, const vec3 *in, std::size_t n
+) {
+    active()->transform_vec3(out, m, in, n, true);
+}
+
+
+
+
+/**
+ *  Transform directions (w = 0) by a matrix.
+ */
+void transform_directions (
+    vec3 *out, const mat4 &m, const vec3 *in, std::size_t n
+) {
+    active()->transform_vec3(out, m, in, n, false);
+}
+
+
+
+
+/**
+ *  Normalize vectors (vectors of length close to zero become zero).
+ */
+void normalize (vec3 *out, const vec3 *in, std::size_t n) {
+    active()->normalize(out, in, n);
+}
+
+
+
+
+/**
+ *  Compute dot products of corresponding vectors.
+ */
+void dot (GLfloat *out, const vec3 *a, const vec3 *b, std::size_t n) {
+    std::size_t i { 0 };
+
+#if defined(M3D_SSE2)
+    __m128 ax, ay, az, bx, by, bz;
+    for (;  i + 4 <= n;  i += 4) {
+        load_soa(raw(a + i), ax, ay, az);
+        load_soa(raw(b + i), bx, by, bz);
+        _mm_storeu_ps(out + i, _mm_add_ps(
+            _mm_add_ps(
+                _mm_add_ps(_mm_setzero_ps(), _mm_mul_ps(ax, bx)),
+                _mm_mul_ps(ay, by)
+            ),
+            _mm_mul_ps(az, bz)
+        ));
+    }
+#endif
+
+    for (;  i < n;  i++) {
+        out[i] = a[i].dot(b[i]);
+    }
+}
+
+
+
+
+/**
+ *  Compute cross products of corresponding vectors.
+ */
+void cross (vec3 *out, const vec3 *a, const vec3 *b, std::size_t n) {
+    std::size_t i { 0 };
+
+#if defined(M3D_SSE2)
+    __m128 ax, ay, az, bx, by, bz;
+    for (;  i + 4 <= n;  i += 4) {
+        load_soa(raw(a + i), ax, ay, az);
+        load_soa(raw(b + i), bx, by, bz);
+        store_soa(
+            raw(out + i),
+            _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(by, az)),
+            _mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(bz, ax)),
+            _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(bx, ay))
+        );
+    }
+#endif
+
+    for (;  i < n;  i++) {
+        out[i] = vec3().cross(a[i], b[i]);
+    }
+}
+
+
+
+
+/**
+ *  Compute component-wise minimum and maximum of all vectors.
+ */
+void min_max (vec3 &min, vec3 &max, const vec3 *in, std::size_t n) {
+    const GLfloat *src { raw(in) };
+    GLfloat
+        lo[3] {
+            std::numeric_limits<GLfloat>::infinity(),
+            std::numeric_limits<GLfloat>::infinity(),
+            std::numeric_limits<GLfloat>::infinity()
+        },
+        hi[3] { -lo[0], -lo[1], -lo[2] };
+    std::size_t i { 0 };
+
+#if defined(M3D_SSE2)
+    if (n >= 4) {
+        // three registers hold (x y z x) (y z x y) (z x y z) phases
+        __m128
+            mn0 { _mm_set1_ps(lo[0]) }, mn1 { mn0 }, mn2 { mn0 },
+            mx0 { _mm_set1_ps(hi[0]) }, mx1 { mx0 }, mx2 { mx0 },
+            r;
+        GLfloat a[12];
+        for (;  i + 4 <= n;  i += 4) {
+            r = _mm_loadu_ps(src + i*3);
+            mn0 = _mm_min_ps(mn0, r);  mx0 = _mm_max_ps(mx0, r);
+            r = _mm_loadu_ps(src + i*3 + 4);
+            mn1 = _mm_min_ps(mn1, r);  mx1 = _mm_max_ps(mx1, r);
+            r = _mm_loadu_ps(src + i*3 + 8);
+            mn2 = _mm_min_ps(mn2, r);  mx2 = _mm_max_ps(mx2, r);
+        }
+        _mm_storeu_ps(a, mn0);  _mm_storeu_ps(a + 4, mn1);
+        _mm_storeu_ps(a + 8, mn2);
+        for (std::size_t j = 0;  j < 12;  j++) {
+            lo[j % 3] = std::min(lo[j % 3], a[j]);
+        }
+        _mm_storeu_ps(a, mx0);  _mm_storeu_ps(a + 4, mx1);
+        _mm_storeu_ps(a + 8, mx2);
+        for (std::size_t j = 0;  j < 12;  j++) {
+            hi[j % 3] = std::max(hi[j % 3], a[j]);
+        }
+    }
+#endif
+
+    for (;  i < n;  i++) {
+        for (std::size_t j = 0;  j < 3;  j++) {
+            lo[j] = std::min(lo[j], src[i*3 + j]);
+            hi[j] = std::max(hi[j], src[i*3 + j]);
+        }
+    }
+
+    min.assign(lo);
+    max.assign(hi);
+}
+
+
+
+
+/**
+ *  Fast sine and cosine of angles in radians.
+ */
+void fast_sincos (GLfloat *s, GLfloat *c, const GLfloat *in, std::size_t n) {
+    std::size_t i { 0 };
+
+#if defined(M3D_SSE2)
+    using trig = fast_trig<GLfloat>;
+    const __m128
+        round { _mm_set1_ps(trig::round) },
+        two_over_pi { _mm_set1_ps(trig::two_over_pi) },
+        pi2_a { _mm_set1_ps(trig::pi2_a) },
+        pi2_b { _mm_set1_ps(trig::pi2_b) },
+        pi2_c { _mm_set1_ps(trig::pi2_c) },
+        s1 { _mm_set1_ps(-1.6666654611e-1f) },
+        s2 { _mm_set1_ps(8.3321608736e-3f) },
+        s3 { _mm_set1_ps(-1.9515295891e-4f) },
+        c1 { _mm_set1_ps(4.166664568298827e-2f) },
+        c2 { _mm_set1_ps(-1.388731625493765e-3f) },
+        c3 { _mm_set1_ps(2.443315711809948e-5f) },
+        one { _mm_set1_ps(1.0f) },
+        half { _mm_set1_ps(0.5f) };
+    const __m128i one_i { _mm_set1_epi32(1) }, two_i { _mm_set1_epi32(2) };
+    __m128 x, q, r, z, ps, pc, swap;
+    __m128i k;
+    for (;  i + 4 <= n;  i += 4) {
+        x = _mm_loadu_ps(in + i);
+        q = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(x, two_over_pi), round), round);
+        r = _mm_sub_ps(
+            _mm_sub_ps(
+                _mm_sub_ps(x, _mm_mul_ps(q, pi2_a)), _mm_mul_ps(q, pi2_b)
+            ),
+            _mm_mul_ps(q, pi2_c)
+        );
+        z = _mm_mul_ps(r, r);
+        ps = _mm_add_ps(r, _mm_mul_ps(
+            _mm_mul_ps(r, z),
+            _mm_add_ps(s1, _mm_mul_ps(z, _mm_add_ps(s2, _mm_mul_ps(z, s3))))
+        ));
+        pc = _mm_add_ps(
+            _mm_sub_ps(one, _mm_mul_ps(half, z)),
+            _mm_mul_ps(
+                _mm_mul_ps(z, z),
+                _mm_add_ps(c1, _mm_mul_ps(z, _mm_add_ps(c2, _mm_mul_ps(z, c3))))
+            )
+        );
+
+        // quadrant: swap sine and cosine for odd, flip signs
+        k = _mm_cvttps_epi32(q);
+        swap = _mm_castsi128_ps(
+            _mm_cmpeq_epi32(_mm_and_si128(k, one_i), one_i)
+        );
+        _mm_storeu_ps(s + i, _mm_xor_ps(
+            _mm_or_ps(_mm_and_ps(swap, pc), _mm_andnot_ps(swap, ps)),
+            _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(k, two_i), 30))
+        ));
+        _mm_storeu_ps(c + i, _mm_xor_ps(
+            _mm_or_ps(_mm_and_ps(swap, ps), _mm_andnot_ps(swap, pc)),
+            _mm_castsi128_ps(_mm_slli_epi32(
+                _mm_and_si128(_mm_add_epi32(k, one_i), two_i), 30
+            ))
+        ));
+    }
+#endif
+
+    for (;  i < n;  i++) {
+        m3d::fast_sincos(in[i], s[i], c[i]);
+    }
+}
+
+
+
+
+/**
+ *  Packed to padded vectors.
+ */
+void pad (vec3a *out, const vec3 *in, std::size_t n) {
+    std::size_t i { 0 };
+
+#if defined(M3D_SSE2)
+    const GLfloat *src { raw(in) };
+    GLfloat *dst { reinterpret_cast<GLfloat*>(out) };
+    const __m128 xyz { _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0)) };
+    __m128 last;
+    for (;  i + 4 <= n;  i += 4) {
+        // vectors 0-2 with overlapping loads, 3 shifted out of the last
+        last = _mm_loadu_ps(src + i*3 + 8);
+        for (std::size_t j = 0;  j < 3;  j++) {
+            _mm_store_ps(
+                dst + (i + j)*4,
+                _mm_and_ps(_mm_loadu_ps(src + (i + j)*3), xyz)
+            );
+        }
+        _mm_store_ps(dst + i*4 + 12, _mm_and_ps(
+            _mm_shuffle_ps(last, last, _MM_SHUFFLE(3, 3, 2, 1)), xyz
+        ));
+    }
+#endif
+
+    for (;  i < n;  i++) {
+        out[i] = in[i];
+    }
+}
+
+
+
+
+/**
+ *  Padded to packed vectors.
+ */
+void unpad (vec3 *out, const vec3a *in, std::size_t n) {
+    std::size_t i { 0 };
+
+#if defined(M3D_SSE2)
+    const GLfloat *src { reinterpret_cast<const GLfloat*>(in) };
+    GLfloat *dst { raw(out) };
+    __m128 a0, a1, a2, a3, a01, a23;
+    for (;  i + 4 <= n;  i += 4) {
+        a0 = _mm_load_ps(src + i*4);
+        a1 = _mm_load_ps(src + i*4 + 4);
+        a2 = _mm_load_ps(src + i*4 + 8);
+        a3 = _mm_load_ps(src + i*4 + 12);
+        a01 = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(0, 0, 2, 2));  // z0 z0 x1 x1
+        a23 = _mm_shuffle_ps(a2, a3, _MM_SHUFFLE(0, 0, 2, 2));  // z2 z2 x3 x3
+        _mm_storeu_ps(
+            dst + i*3, _mm_shuffle_ps(a0, a01, _MM_SHUFFLE(2, 0, 1, 0))
+        );
+        _mm_storeu_ps(
+            dst + i*3 + 4, _mm_shuffle_ps(a1, a2, _MM_SHUFFLE(1, 0, 2, 1))
+        );
+        _mm_storeu_ps(
+            dst + i*3 + 8, _mm_shuffle_ps(a23, a3, _MM_SHUFFLE(2, 1, 2, 0))
+        );
+    }
+#endif
+
+    for (;  i < n;  i++) {
+        out[i] = in[i];
+    }
+}
+
+
+
+
+/**
+ *  Packed vectors to structure-of-arrays.
+ */
+void to_soa (const soa3_view &out, const vec3 *in) {
+    std::size_t i { 0 };
+
+#if defined(M3D_SSE2)
+    const GLfloat *src { raw(in) };
+    __m128 x, y, z;
+    for (;  i + 4 <= out.size;  i += 4) {
+        load_soa(src + i*3, x, y, z);
+        _mm_storeu_ps(out.x + i, x);
+        _mm_storeu_ps(out.y + i, y);
+        _mm_storeu_ps(out.z + i, z);
+    }
+#endif
+
+    for (;  i < out.size;  i++) {
+        out.x[i] = in[i][0];
+        out.y[i] = in[i][1];
+        out.z[i] = in[i][2];
+    }
+}
+
+
+
+
+/**
+ *  Structure-of-arrays to packed vectors.
+ */
+void from_soa (vec3 *out, const const_soa3_view &in) {
+    std::size_t i { 0 };
+
+#if defined(M3D_SSE2)
+    GLfloat *dst { raw(out) };
+    for (;  i + 4 <= in.size;  i += 4) {
+        store_soa(
+            dst + i*3,
+            _mm_loadu_ps(in.x + i), _mm_loadu_ps(in.y + i),
+            _mm_loadu_ps(in.z + i)
+        );
+    }
+#endif
+
+    for (;  i < in.size;  i++) {
+        out[i].assign(in.x[i], in.y[i], in.z[i]);
+    }
+}
+
+
+
+
+/**
+ *  Transform points stored as structure-of-arrays.
+ */
+void transform_points (
+    const soa3_view &out, const mat4 &m, const const_soa3_view &in
+) {
+    active()->transform_soa(out, m, in);
+}
+
+
+
+
+#if defined(M3D_SSE2)
+
+/**
+ *  Clamp four floats to [lo, hi] (NaN becomes "lo", same as
+ *  m3d::codec::clamp), scale and round to nearest even integers.
+ */
+inline __m128i to_normalized (
+    __m128 x, __m128 lo, __m128 hi, __m128 scale
+) {
+    return _mm_cvtps_epi32(
+        _mm_mul_ps(_mm_min_ps(_mm_max_ps(x, lo), hi), scale)
+    );
+}
+
+
+
+
+/**
+ *  Pack eight 32-bit integers (values fitting 16 bits, signed
+ *  or unsigned) to 16-bit lanes (SSE2 has only signed saturation,
+ *  so upper halves are sign-extended from the lower ones first).
+ */
+inline __m128i pack_16 (__m128i a, __m128i b) {
+    return _mm_packs_epi32(
+        _mm_srai_epi32(_mm_slli_epi32(a, 16), 16),
+        _mm_srai_epi32(_mm_slli_epi32(b, 16), 16)
+    );
+}
+
+#endif
+
+
+
+
+/**
+ *  Floats to half floats (four at a time, same steps
+ *  as the scalar m3d::to_half).
+ */
+void to_half (std::uint16_t *out, const GLfloat *in, std::size_t n) {
+    std::size_t i { 0 };
+
+#if defined(M3D_SSE2)
+    const __m128i
+        sign_mask { _mm_set1_epi32(static_cast<int>(0x80000000u)) },
+        f16_max { _mm_set1_epi32(0x47800000) },
+        min_normal { _mm_set1_epi32(0x38800000) },
+        denormal_magic { _mm_set1_epi32(0x3f000000) },
+        normal_bias { _mm_set1_epi32(static_cast<int>(0xc8000fffu)) },
+        one { _mm_set1_epi32(1) },
+        inf { _mm_set1_epi32(0x7c00) },
+        nan_bit { _mm_set1_epi32(0x0200) };
+    __m128i h[2];
+    for (;  i + 8 <= n;  i += 8) {
+        for (std::size_t j = 0;  j < 2;  j++) {
+            const __m128i
+                x { _mm_castps_si128(_mm_loadu_ps(in + i + j*4)) },
+                sign { _mm_and_si128(x, sign_mask) },
+                a { _mm_xor_si128(x, sign) },
+                is_nan { _mm_cmpgt_epi32(a, _mm_set1_epi32(0x7f800000)) },
+                is_regular { _mm_cmpgt_epi32(f16_max, a) },
+                is_subnormal { _mm_cmpgt_epi32(min_normal, a) },
+                subnormal { _mm_sub_epi32(
+                    _mm_castps_si128(_mm_add_ps(
+                        _mm_castsi128_ps(a), _mm_castsi128_ps(denormal_magic)
+                    )),
+                    denormal_magic
+                ) },
+                normal { _mm_srli_epi32(_mm_add_epi32(
+                    _mm_add_epi32(a, normal_bias),
+                    _mm_and_si128(_mm_srli_epi32(a, 13), one)
+                ), 13) },
+                special { _mm_or_si128(inf, _mm_and_si128(is_nan, nan_bit)) },
+                finite { _mm_or_si128(
+                    _mm_and_si128(is_subnormal, subnormal),
+                    _mm_andnot_si128(is_subnormal, normal)
+                ) };
+            h[j] = _mm_or_si128(
+                _mm_or_si128(
+                    _mm_and_si128(is_regular, finite),
+                    _mm_andnot_si128(is_regular, special)
+                ),
+                _mm_srli_epi32(sign, 16)
+            );
+        }
+        _mm_storeu_si128(
+            reinterpret_cast<__m128i*>(out + i), pack_16(h[0], h[1])
+        );
+    }
+#endif
+
+    for (;  i < n;  i++) {
+        out[i] = m3d::to_half(in[i]);
+    }
+}
+
+
+
+
+/**
+ *  Floats to unorm8 (sixteen at a time).
+ */
+void to_unorm8 (std::uint8_t *out, const GLfloat *in, std::size_t n) {
+    std::size_t i { 0 };
+
+#if defined(M3D_SSE2)
+    const __m128
+        lo { _mm_setzero_ps() }, hi { _mm_set1_ps(1.0f) },
+        scale { _mm_set1_ps(255.0f) };
+    __m128i q[4];
+    for (;  i + 16 <= n;  i += 16) {
+        for (std::size_t j = 0;  j < 4;  j++) {
+            q[j] = to_normalized(_mm_loadu_ps(in + i + j*4), lo, hi, scale);
+        }
+        _mm_storeu_si128(
+            reinterpret_cast<__m128i*>(out + i),
+            _mm_packus_epi16(
+                _mm_packs_epi32(q[0], q[1]), _mm_packs_epi32(q[2], q[3])
+            )
+        );
+    }
+#endif
+
+    for (;  i < n;  i++) {
+        out[i] = m3d::to_unorm8(in[i]);
+    }
+}
+
+
+
+
+/**
+ *  Floats to snorm16 (eight at a time).
+ */
+void to_snorm16 (std::int16_t *out, const GLfloat *in, std::size_t n) {
+    std::size_t i { 0 };
+
+#if defined(M3D_SSE2)
+    const __m128
+        lo { _mm_set1_ps(-1.0f) }, hi { _mm_set1_ps(1.0f) },
+        scale { _mm_set1_ps(32767.0f) };
+    for (;  i + 8 <= n;  i += 8) {
+        _mm_storeu_si128(
+            reinterpret_cast<__m128i*>(out + i),
+            _mm_packs_epi32(
+                to_normalized(_mm_loadu_ps(in + i), lo, hi, scale),
+                to_normalized(_mm_loadu_ps(in + i + 4), lo, hi, scale)
+            )
+        );
+    }
+#endif
+
+    for (;  i < n;  i++) {
+        out[i] = m3d::to_snorm16(in[i]);
+    }
+}
+
+
+
+
+/**
+ *  Unit vectors to octahedral encoding (four at a time).
+ */
+void to_octahedral (snorm16x2 *out, const vec3 *in, std::size_t n) {
+    std::size_t i { 0 };
+
+#if defined(M3D_SSE2)
+    const GLfloat *src { raw(in) };
+    const __m128
+        sign_mask { _mm_set1_ps(-0.0f) },
+        zero { _mm_setzero_ps() },
+        lo { _mm_set1_ps(-1.0f) }, one { _mm_set1_ps(1.0f) },
+        scale { _mm_set1_ps(32767.0f) };
+    auto abs = [&sign_mask] (__m128 a) { return _mm_andnot_ps(sign_mask, a); };
+    auto copysign = [&sign_mask, &abs] (__m128 a, __m128 b) {
+        return _mm_or_ps(abs(a), _mm_and_ps(sign_mask, b));
+    };
+    __m128 x, y, z;
+    for (;  i + 4 <= n;  i += 4) {
+        load_soa(src + i*3, x, y, z);
+        const __m128
+            l1 { _mm_add_ps(_mm_add_ps(abs(x), abs(y)), abs(z)) },
+            valid { _mm_cmpgt_ps(l1, zero) },
+            u { _mm_and_ps(valid, _mm_div_ps(x, l1)) },
+            v { _mm_and_ps(valid, _mm_div_ps(y, l1)) },
+            fold { _mm_and_ps(valid, _mm_cmplt_ps(z, zero)) },
+            fu { copysign(_mm_sub_ps(one, abs(v)), u) },
+            fv { copysign(_mm_sub_ps(one, abs(u)), v) },
+            eu { _mm_or_ps(_mm_and_ps(fold, fu), _mm_andnot_ps(fold, u)) },
+            ev { _mm_or_ps(_mm_and_ps(fold, fv), _mm_andnot_ps(fold, v)) };
+        const __m128i
+            qu { to_normalized(eu, lo, one, scale) },
+            qv { to_normalized(ev, lo, one, scale) };
+        _mm_storeu_si128(
+            reinterpret_cast<__m128i*>(out + i),
+            _mm_packs_epi32(
+                _mm_unpacklo_epi32(qu, qv), _mm_unpackhi_epi32(qu, qv)
+            )
+        );
+    }
+#endif
+
+    for (;  i < n;  i++) {
+        out[i] = m3d::to_octahedral(in[i]);
+    }
+}
+
+
+
+
+/**
+ *  Quantize positions relative to a bounding box (four at a time).
+ */
+void quantize (
+    unorm16x4 *out, const vec3 *in, std::size_t n,
+    const vec3 &min, const vec3 &max
+) {
+    const vec3 s { m3d::quantization_scale(min, max) };
+    std::size_t i { 0 };
+
+#if defined(M3D_SSE2)
+    const GLfloat *src { raw(in) };
+    const __m128
+        lo { _mm_setzero_ps() }, hi { _mm_set1_ps(1.0f) },
+        scale { _mm_set1_ps(65535.0f) },
+        min_x { _mm_set1_ps(min[0]) }, s_x { _mm_set1_ps(s[0]) },
+        min_y { _mm_set1_ps(min[1]) }, s_y { _mm_set1_ps(s[1]) },
+        min_z { _mm_set1_ps(min[2]) }, s_z { _mm_set1_ps(s[2]) };
+    const __m128i zero { _mm_setzero_si128() };
+    auto unorm16 = [&lo, &hi, &scale] (__m128 a, __m128 m, __m128 s) {
+        return to_normalized(_mm_mul_ps(_mm_sub_ps(a, m), s), lo, hi, scale);
+    };
+    __m128 x, y, z;
+    for (;  i + 4 <= n;  i += 4) {
+        load_soa(src + i*3, x, y, z);
+        const __m128i
+            qx { unorm16(x, min_x, s_x) },
+            qy { unorm16(y, min_y, s_y) },
+            qz { unorm16(z, min_z, s_z) },
+            xy_lo { _mm_unpacklo_epi32(qx, qy) },     // x0 y0 x1 y1
+            xy_hi { _mm_unpackhi_epi32(qx, qy) },     // x2 y2 x3 y3
+            zw_lo { _mm_unpacklo_epi32(qz, zero) },   // z0 0 z1 0
+            zw_hi { _mm_unpackhi_epi32(qz, zero) };   // z2 0 z3 0
+        __m128i *dst { reinterpret_cast<__m128i*>(out + i) };
+        _mm_storeu_si128(dst, pack_16(
+            _mm_unpacklo_epi64(xy_lo, zw_lo), _mm_unpackhi_epi64(xy_lo, zw_lo)
+        ));
+        _mm_storeu_si128(dst + 1, pack_16(
+            _mm_unpacklo_epi64(xy_hi, zw_hi), _mm_unpackhi_epi64(xy_hi, zw_hi)
+        ));
+    }
+#endif
+
+    for (;  i < n;  i++) {
+        out[i] = m3d::quantize(in[i], min, max);
+    }
+}
+
+
+
+
+    } // namespace kernels
+} // namespace m3d
+
+#endif
@@ -0,0 +1,365 @@
+/**
+ *  machina
+ *
+ *  Copyright (c) 2015, drmats
+ *  All rights reserved.
+ *
+ *  https://github.com/drmats/machina
+ */
+
+#ifndef __M3D_KERNELS_HPP_
+#define __M3D_KERNELS_HPP_ 1
+
+#include "m3d.hpp"
+#include "m3d_storage.hpp"
+#include "m3d_codec.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace m3d {
+    namespace kernels {
+
+
+
+
+using vec2 = GVector2<GLfloat>;
+using vec3 = GVector3<GLfloat>;
+using vec4 = GVector4<GLfloat>;
+using mat4 = GMatrix4<GLfloat>;
+using vec3a = GVector3A<GLfloat>;
+using soa3 = GSoA3<GLfloat>;
+using soa3_view = GSoA3View<GLfloat>;
+using const_soa3_view = GSoA3View<const GLfloat>;
+
+
+
+
+/**
+ *  Array-at-a-time kernels operate directly on tightly packed
+ *  arrays of vectors (the same layout uploaded by Batch::prepare).
+ *  Every kernel accepts "out == in" (in-place operation).
+ */
+static_assert(
+    sizeof(vec3) == 3*sizeof(GLfloat)  &&  sizeof(vec4) == 4*sizeof(GLfloat)  &&
+    sizeof(mat4) == 16*sizeof(GLfloat),
+    "m3d::kernels: vectors and matrices have to be tightly packed."
+);
+static_assert(
+    sizeof(vec3a) == 4*sizeof(GLfloat)  &&  alignof(vec3a) == sizeof(vec3a),
+    "m3d::kernels: padded vectors have to be 16 bytes, 16-byte aligned."
+);
+static_assert(
+    sizeof(vec2) == 2*sizeof(GLfloat)  &&
+    sizeof(half2) == 4  &&  sizeof(unorm8x4) == 4  &&
+    sizeof(snorm16x2) == 4  &&  sizeof(unorm16x4) == 8,
+    "m3d::kernels: packed attributes have to be tightly packed."
+);
+
+
+
+
+/**
+ *  Code paths of the dispatched kernels (multiply, transform_points
+ *  - packed and structure-of-arrays, transform_directions and
+ *  normalize). The best path supported by the cpu is detected
+ *  on first use; "select_isa" rebinds the kernels (returns false
+ *  when the cpu lacks support) and is not thread-safe.
+ */
+enum class isa { baseline, avx2_fma };
+isa active_isa ();
+bool select_isa (isa);
+const char* isa_name (isa);
+
+
+
+
+/**
+ *  Multiply matrices: out[i] = a * b[i].
+ */
+void multiply (mat4 *, const mat4 &, const mat4 *, std::size_t);
+
+
+/**
+ *  Transform points (w = 1) by a matrix (no perspective divide).
+ */
+void transform_points (vec3 *, const mat4 &, const vec3 *, std::size_t);
+
+
+/**
+ *  Transform directions (w = 0) by a matrix.
+ */
+void transform_directions (vec3 *, const mat4 &, const vec3 *, std::size_t);
+
+
+/**
+ *  Transform four component vectors by a matrix.
+ */
+void transform (vec4 *, const mat4 &, const vec4 *, std::size_t);
+
+
+/**
+ *  Transform points by a (model-)view-projection matrix, perform
+ *  perspective divide and map the result to the window coordinates
+ *  (viewport is [x, y, width, height], depth is mapped to [0, 1]).
+ */
+void project_points (
+    vec3 *, const mat4 &, const vec3 *, std::size_t, const vec4 &
+);
+
+
+/**
+ *  Normalize vectors (vectors of length close to zero become zero).
+ */
+void normalize (vec3 *, const vec3 *, std::size_t);
+
+
+/**
+ *  Compute dot products of corresponding vectors.
+ */
+void dot (GLfloat *, const vec3 *, const vec3 *, std::size_t);
+
+
+/**
+ *  Compute cross products of corresponding vectors.
+ */
+void cross (vec3 *, const vec3 *, const vec3 *, std::size_t);
+
+
+/**
+ *  Compute component-wise minimum and maximum of all vectors
+ *  (for an empty array min is +inf and max is -inf).
+ */
+void min_max (vec3 &, vec3 &, const vec3 *, std::size_t);
+
+
+/**
+ *  Fast sine and cosine of angles in radians (results are
+ *  identical to m3d::fast_sincos, evaluated four at a time).
+ */
+void fast_sincos (GLfloat *, GLfloat *, const GLfloat *, std::size_t);
+
+
+
+/**
+ *  Layout conversions between tightly packed vectors (GPU upload
+ *  layout), padded aligned vectors and structure-of-arrays streams.
+ *  Conversions don't alias ("out" and "in" are distinct arrays).
+ */
+void pad (vec3a *, const vec3 *, std::size_t);
+void unpad (vec3 *, const vec3a *, std::size_t);
+void to_soa (const soa3_view &, const vec3 *);
+void from_soa (vec3 *, const const_soa3_view &);
+
+
+/**
+ *  Transform points (w = 1) stored as structure-of-arrays
+ *  (in-place operation is allowed, "out.size" has to match).
+ */
+void transform_points (
+    const soa3_view &, const mat4 &, const const_soa3_view &
+);
+
+
+
+
+/**
+ *  Vertex attribute encoders (results are identical to the scalar
+ *  codecs of m3d_codec.hpp). Half floats, unorm8 and snorm16 work
+ *  on flat float arrays (any number of components per vertex),
+ *  octahedral normals and quantized positions (box "min", "max")
+ *  on 3-vectors.
+ */
+void to_half (std::uint16_t *, const GLfloat *, std::size_t);
+void to_unorm8 (std::uint8_t *, const GLfloat *, std::size_t);
+void to_snorm16 (std::int16_t *, const GLfloat *, std::size_t);
+void to_octahedral (snorm16x2 *, const vec3 *, std::size_t);
+void quantize (
+    unorm16x4 *, const vec3 *, std::size_t, const vec3 &, const vec3 &
+);
+
+
+
+
+/**
+ *  std::vector helpers ("out" is resized to match the input).
+ */
+inline std::vector<mat4>& multiply (
+    std::vector<mat4> &out, const mat4 &a, const std::vector<mat4> &b
+) {
+    out.resize(b.size());
+    multiply(out.data(), a, b.data(), b.size());
+    return out;
+}
+
+
+inline std::vector<vec3>& transform_points (
+    std::vector<vec3> &out, const mat4 &m, const std::vector<vec3> &in
+) {
+    out.resize(in.size());
+    transform_points(out.data(), m, in.data(), in.size());
+    return out;
+}
+
+
+inline std::vector<vec3>& transform_directions (
+    std::vector<vec3> &out, const mat4 &m, const std::vector<vec3> &in
+) {
+    out.resize(in.size());
+    transform_directions(out.data(), m, in.data(), in.size());
+    return out;
+}
+
+
+inline std::vector<vec4>& transform (
+    std::vector<vec4> &out, const mat4 &m, const std::vector<vec4> &in
+) {
+    out.resize(in.size());
+    transform(out.data(), m, in.data(), in.size());
+    return out;
+}
+
+
+inline std::vector<vec3>& project_points (
+    std::vector<vec3> &out, const mat4 &mvp, const std::vector<vec3> &in,
+    const vec4 &viewport
+) {
+    out.resize(in.size());
+    project_points(out.data(), mvp, in.data(), in.size(), viewport);
+    return out;
+}
+
+
+inline std::vector<vec3>& normalize (
+    std::vector<vec3> &out, const std::vector<vec3> &in
+) {
+    out.resize(in.size());
+    normalize(out.data(), in.data(), in.size());
+    return out;
+}
+
+
+inline std::vector<GLfloat>& dot (
+    std::vector<GLfloat> &out,
+    const std::vector<vec3> &a, const std::vector<vec3> &b
+) {
+    out.resize(std::min(a.size(), b.size()));
+    dot(out.data(), a.data(), b.data(), out.size());
+    return out;
+}
+
+
+inline std::vector<vec3>& cross (
+    std::vector<vec3> &out,
+    const std::vector<vec3> &a, const std::vector<vec3> &b
+) {
+    const std::size_t n { std::min(a.size(), b.size()) };
+    out.resize(n);
+    cross(out.data(), a.data(), b.data(), n);
+    return out;
+}
+
+
+inline void min_max (vec3 &min, vec3 &max, const std::vector<vec3> &in) {
+    min_max(min, max, in.data(), in.size());
+}
+
+
+inline void fast_sincos (
+    std::vector<GLfloat> &s, std::vector<GLfloat> &c,
+    const std::vector<GLfloat> &in
+) {
+    s.resize(in.size());
+    c.resize(in.size());
+    fast_sincos(s.data(), c.data(), in.data(), in.size());
+}
+
+
+inline aligned_vector<vec3a>& pad (
+    aligned_vector<vec3a> &out, const std::vector<vec3> &in
+) {
+    out.resize(in.size());
+    pad(out.data(), in.data(), in.size());
+    return out;
+}
+
+
+inline std::vector<vec3>& unpad (
+    std::vector<vec3> &out, const aligned_vector<vec3a> &in
+) {
+    out.resize(in.size());
+    unpad(out.data(), in.data(), in.size());
+    return out;
+}
+
+
+inline soa3& to_soa (soa3 &out, const std::vector<vec3> &in) {
+    out.resize(in.size());
+    to_soa(out.view(), in.data());
+    return out;
+}
+
+
+inline std::vector<vec3>& from_soa (std::vector<vec3> &out, const soa3 &in) {
+    out.resize(in.size());
+    from_soa(out.data(), in.view());
+    return out;
+}
+
+
+inline soa3& transform_points (soa3 &out, const mat4 &m, const soa3 &in) {
+    out.resize(in.size());
+    transform_points(out.view(), m, in.view());
+    return out;
+}
+
+
+
+inline std::vector<half2>& to_half (
+    std::vector<half2> &out, const std::vector<vec2> &in
+) {
+    out.resize(in.size());
+    to_half(
+        reinterpret_cast<std::uint16_t*>(out.data()),
+        reinterpret_cast<const GLfloat*>(in.data()), in.size()*2
+    );
+    return out;
+}
+
+
+inline std::vector<unorm8x4>& to_unorm8 (
+    std::vector<unorm8x4> &out, const std::vector<vec4> &in
+) {
+    out.resize(in.size());
+    to_unorm8(
+        reinterpret_cast<std::uint8_t*>(out.data()),
+        reinterpret_cast<const GLfloat*>(in.data()), in.size()*4
+    );
+    return out;
+}
+
+
+inline std::vector<snorm16x2>& to_octahedral (
+    std::vector<snorm16x2> &out, const std::vector<vec3> &in
+) {
+    out.resize(in.size());
+    to_octahedral(out.data(), in.data(), in.size());
+    return out;
+}
+
+
+inline std::vector<unorm16x4>& quantize (
+    std::vector<unorm16x4> &out, const std::vector<vec3> &in,
+    const vec3 &min, const vec3 &max
+) {
+    out.resize(in.size());
+    quantize(out.data(), in.data(), in.size(), min, max);
+    return out;
+}
+
+
+
+
+    } // namespace kernels
+} // namespace m3d
+
+#endif
@@ -0,0 +1,247 @@
+/**
+ *  machina
+ *
+ *  Copyright (c) 2015, drmats
+ *  All rights reserved.
+ *
+ *  https://github.com/drmats/machina
+ */
+
+#ifndef __M3D_KERNELS_AVX2_CPP_
+#define __M3D_KERNELS_AVX2_CPP_ 1
+
+#include "m3d_kernels_avx2.hpp"
+
+/**
+ *  This translation unit is compiled with "-mavx2 -mfma" and must not
+ *  include m3d (or any other) headers with inline functions or
+ *  templates - the linker could pick their AVX2 copies for the rest
+ *  of the program. Everything here works on raw floats.
+ */
+#if defined(M3D_DISPATCH_AVX2)  &&  defined(__AVX2__)  &&  defined(__FMA__)
+
+#include <immintrin.h>
+
+namespace m3d {
+    namespace kernels {
+        namespace avx2 {
+
+
+
+
+namespace {
+
+
+/**
+ *  Load eight packed 3-vectors (24 floats) as x, y and z registers
+ *  (every 128-bit lane is handled as in the SSE2 "load_soa").
+ */
+inline void load_soa (const float *p, __m256 &x, __m256 &y, __m256 &z) {
+    const __m256
+        q0 { _mm256_loadu_ps(p) },        // x0 y0 z0 x1 | y1 z1 x2 y2
+        q1 { _mm256_loadu_ps(p + 8) },    // z2 x3 y3 z3 | x4 y4 z4 x5
+        q2 { _mm256_loadu_ps(p + 16) },   // y5 z5 x6 y6 | z6 x7 y7 z7
+        r0 { _mm256_permute2f128_ps(q0, q1, 0x30) },  // x0 y0 z0 x1 | x4 y4 z4 x5
+        r1 { _mm256_permute2f128_ps(q0, q2, 0x21) },  // y1 z1 x2 y2 | y5 z5 x6 y6
+        r2 { _mm256_permute2f128_ps(q1, q2, 0x30) },  // z2 x3 y3 z3 | z6 x7 y7 z7
+        t0 { _mm256_shuffle_ps(r0, r1, _MM_SHUFFLE(1, 0, 2, 1)) },
+        t1 { _mm256_shuffle_ps(r1, r2, _MM_SHUFFLE(2, 1, 3, 2)) };
+    x = _mm256_shuffle_ps(r0, t1, _MM_SHUFFLE(2, 0, 3, 0));
+    y = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 1, 2, 0));
+    z = _mm256_shuffle_ps(t0, r2, _MM_SHUFFLE(3, 0, 3, 1));
+}
+
+
+
+
+/**
+ *  Store x, y and z registers as eight packed 3-vectors.
+ */
+inline void store_soa (float *p, __m256 x, __m256 y, __m256 z) {
+    const __m256
+        r0 { _mm256_shuffle_ps(
+            _mm256_shuffle_ps(x, y, _MM_SHUFFLE(0, 0, 0, 0)),
+            _mm256_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0)),
+            _MM_SHUFFLE(2, 0, 2, 0)
+        ) },
+        r1 { _mm256_shuffle_ps(
+            _mm256_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1)),
+            _mm256_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2)),
+            _MM_SHUFFLE(2, 0, 2, 0)
+        ) },
+        r2 { _mm256_shuffle_ps(
+            _mm256_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)),
+            _mm256_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)),
+            _MM_SHUFFLE(2, 0, 2, 0)
+        ) };
+    _mm256_storeu_ps(p, _mm256_permute2f128_ps(r0, r1, 0x20));
+    _mm256_storeu_ps(p + 8, _mm256_permute2f128_ps(r2, r0, 0x30));
+    _mm256_storeu_ps(p + 16, _mm256_permute2f128_ps(r1, r2, 0x31));
+}
+
+
+
+
+/**
+ *  Run "f" over eight-vector blocks of "n" packed 3-vectors,
+ *  the last partial block goes through a zero-padded buffer.
+ */
+template <typename F>
+inline void for_blocks (
+    float *out, const float *in, std::size_t n, F f
+) {
+    std::size_t i { 0 };
+    for (;  i + 8 <= n;  i += 8) {
+        f(out + i*3, in + i*3);
+    }
+    if (i < n) {
+        float tmp[8*3] { 0 };
+        const std::size_t rest { (n - i)*3 };
+        for (std::size_t j = 0;  j < rest;  j++) { tmp[j] = in[i*3 + j]; }
+        f(tmp, tmp);
+        for (std::size_t j = 0;  j < rest;  j++) { out[i*3 + j] = tmp[j]; }
+    }
+}
+
+
+} // namespace
+
+
+
+
+/**
+ *  out[i] = a * b[i] (column-major 4x4 matrices).
+ */
+void multiply (float *out, const float *a, const float *b, std::size_t n) {
+    const __m256
+        a0 { _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a)) },
+        a1 { _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 4)) },
+        a2 { _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 8)) },
+        a3 { _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 12)) };
+    for (std::size_t i = 0;  i < n;  i++, out += 16, b += 16) {
+        const __m256 b01 { _mm256_loadu_ps(b) }, b23 { _mm256_loadu_ps(b + 8) };
+        __m256 r01, r23;
+
+        r01 = _mm256_mul_ps(a0, _mm256_shuffle_ps(b01, b01, 0x00));
+        r23 = _mm256_mul_ps(a0, _mm256_shuffle_ps(b23, b23, 0x00));
+        #define mad(r, ac, bc, i) \
+            r = _mm256_fmadd_ps(ac, _mm256_shuffle_ps(bc, bc, i), r)
+        mad(r01, a1, b01, 0x55);  mad(r23, a1, b23, 0x55);
+        mad(r01, a2, b01, 0xAA);  mad(r23, a2, b23, 0xAA);
+        mad(r01, a3, b01, 0xFF);  mad(r23, a3, b23, 0xFF);
+        #undef mad
+
+        _mm256_storeu_ps(out, r01);
+        _mm256_storeu_ps(out + 8, r23);
+    }
+}
+
+
+
+
+/**
+ *  Transform packed points (w = 1) or directions (w = 0).
+ */
+void transform_vec3 (
+    float *out, const float *m, const float *in, std::size_t n, bool point
+) {
+    __m256 c[12], t[3];
+    for (std::size_t i = 0;  i < 12;  i++) { c[i] = _mm256_set1_ps(m[i]); }
+    for (std::size_t i = 0;  i < 3;  i++) {
+        t[i] = _mm256_set1_ps(point ? m[i + 12] : 0.0f);
+    }
+    for_blocks(out, in, n, [&] (float *dst, const float *src) {
+        __m256 x, y, z, r[3];
+        load_soa(src, x, y, z);
+        for (std::size_t i = 0;  i < 3;  i++) {
+            r[i] = _mm256_fmadd_ps(c[i], x, t[i]);
+            r[i] = _mm256_fmadd_ps(c[i + 4], y, r[i]);
+            r[i] = _mm256_fmadd_ps(c[i + 8], z, r[i]);
+        }
+        store_soa(dst, r[0], r[1], r[2]);
+    });
+}
+
+
+
+
+/**
+ *  Normalize packed vectors (shorter than "epsilon" become zero).
+ */
+void normalize (float *out, const float *in, std::size_t n, float epsilon) {
+    const __m256 one { _mm256_set1_ps(1.0f) }, eps { _mm256_set1_ps(epsilon) };
+    for_blocks(out, in, n, [&] (float *dst, const float *src) {
+        __m256 x, y, z, l, s;
+        load_soa(src, x, y, z);
+        l = _mm256_sqrt_ps(_mm256_fmadd_ps(
+            z, z, _mm256_fmadd_ps(y, y, _mm256_mul_ps(x, x))
+        ));
+        s = _mm256_andnot_ps(
+            _mm256_cmp_ps(l, eps, _CMP_LT_OQ), _mm256_div_ps(one, l)
+        );
+        store_soa(dst, _mm256_mul_ps(x, s), _mm256_mul_ps(y, s),
+            _mm256_mul_ps(z, s));
+    });
+}
+
+
+
+
+/**
+ *  Transform points (w = 1) stored as structure-of-arrays
+ *  (x, y and z streams, in-place operation is allowed). The last
+ *  partial block is loaded and stored under a mask.
+ */
+void transform_points_soa (
+    float *ox, float *oy, float *oz, const float *m,
+    const float *ix, const float *iy, const float *iz, std::size_t n
+) {
+    __m256 c[12], t[3];
+    for (std::size_t i = 0;  i < 12;  i++) { c[i] = _mm256_set1_ps(m[i]); }
+    for (std::size_t i = 0;  i < 3;  i++) { t[i] = _mm256_set1_ps(m[i + 12]); }
+    const auto transform = [&] (
+        __m256 x, __m256 y, __m256 z, __m256 *r
+    ) {
+        for (std::size_t i = 0;  i < 3;  i++) {
+            r[i] = _mm256_fmadd_ps(c[i], x, t[i]);
+            r[i] = _mm256_fmadd_ps(c[i + 4], y, r[i]);
+            r[i] = _mm256_fmadd_ps(c[i + 8], z, r[i]);
+        }
+    };
+
+    std::size_t i { 0 };
+    __m256 r[3];
+    for (;  i + 8 <= n;  i += 8) {
+        transform(
+            _mm256_loadu_ps(ix + i), _mm256_loadu_ps(iy + i),
+            _mm256_loadu_ps(iz + i), r
+        );
+        _mm256_storeu_ps(ox + i, r[0]);
+        _mm256_storeu_ps(oy + i, r[1]);
+        _mm256_storeu_ps(oz + i, r[2]);
+    }
+    if (i < n) {
+        const __m256i mask { _mm256_cmpgt_epi32(
+            _mm256_set1_epi32(static_cast<int>(n - i)),
+            _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)
+        ) };
+        transform(
+            _mm256_maskload_ps(ix + i, mask), _mm256_maskload_ps(iy + i, mask),
+            _mm256_maskload_ps(iz + i, mask), r
+        );
+        _mm256_maskstore_ps(ox + i, mask, r[0]);
+        _mm256_maskstore_ps(oy + i, mask, r[1]);
+        _mm256_maskstore_ps(oz + i, mask, r[2]);
+    }
+}
+
+
+
+
+        } // namespace avx2
+    } // namespace kernels
+} // namespace m3d
+
+#endif
+
+#endif
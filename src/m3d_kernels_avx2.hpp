@@ -0,0 +1,55 @@
+/**
+ *  machina
+ *
+ *  Copyright (c) 2015, drmats
+ *  All rights reserved.
+ *
+ *  https://github.com/drmats/machina
+ */
+
+#ifndef __M3D_KERNELS_AVX2_HPP_
+#define __M3D_KERNELS_AVX2_HPP_ 1
+
+#include <cstddef>
+
+/**
+ *  AVX2/FMA kernels are built only with GCC-compatible compilers
+ *  for x86 (cpu detection relies on "__builtin_cpu_supports").
+ *  Windows targets are excluded - GCC does not realign the stack
+ *  there, so spilled 32-byte registers could fault.
+ */
+#if defined(__GNUC__)  &&  (defined(__x86_64__) || defined(__i386__))  &&  \
+    !defined(_WIN32)
+#define M3D_DISPATCH_AVX2 1
+#endif
+
+namespace m3d {
+    namespace kernels {
+        namespace avx2 {
+
+
+
+
+/**
+ *  Raw float kernels compiled with "-mavx2 -mfma" (call them only
+ *  when the cpu supports both). Layouts and aliasing rules are
+ *  the ones of their m3d::kernels counterparts. Mul/add pairs
+ *  are fused, so results may differ from the baseline path
+ *  in the last bit.
+ */
+void multiply (float *, const float *, const float *, std::size_t);
+void transform_vec3 (float *, const float *, const float *, std::size_t, bool);
+void normalize (float *, const float *, std::size_t, float);
+void transform_points_soa (
+    float *, float *, float *, const float *,
+    const float *, const float *, const float *, std::size_t
+);
+
+
+
+
+        } // namespace avx2
+    } // namespace kernels
+} // namespace m3d
+
+#endif
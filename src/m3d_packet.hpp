@@ -0,0 +1,849 @@
+/**
+ *  machina
+ *
+ *  Copyright (c) 2015, drmats
+ *  All rights reserved.
+ *
+ *  https://github.com/drmats/machina
+ */
+
+#ifndef __M3D_PACKET_HPP_
+#define __M3D_PACKET_HPP_ 1
+
+#include "m3d.hpp"
+#include "m3d_storage.hpp"
+
+namespace m3d {
+
+
+
+
+/**
+ *  Packets hold W independent values of type T (one per SIMD lane)
+ *  and mirror scalar arithmetic lane by lane, so algorithms written
+ *  against m3d vectors can run 4 or 8 wide. The generic template
+ *  is a plain array (compilers may vectorize it), float packets
+ *  of width 4 (SSE2) and 8 (AVX) map directly to registers.
+ *  Comparisons yield masks (one boolean per lane) consumed
+ *  by "select", "any", "all" and "bits".
+ */
+template <typename T, std::size_t W>
+struct GPacketMask {
+
+    bool m[W];
+
+    static constexpr std::size_t width { W };
+
+    inline bool operator[] (std::size_t i) const { return this->m[i]; }
+
+    inline int bits () const {
+        int r { 0 };
+        for (std::size_t i = 0;  i < W;  i++) {
+            r |= static_cast<int>(this->m[i]) << i;
+        }
+        return r;
+    }
+
+};
+
+
+template <typename T, std::size_t W>
+struct GPacket {
+
+    T v[W];
+
+    static constexpr std::size_t width { W };
+
+    inline GPacket () {}
+    inline GPacket (T s) {
+        for (std::size_t i = 0;  i < W;  i++) { this->v[i] = s; }
+    }
+
+    static inline GPacket load (const T *p) {
+        GPacket r;
+        for (std::size_t i = 0;  i < W;  i++) { r.v[i] = p[i]; }
+        return r;
+    }
+
+    inline void store (T *p) const {
+        for (std::size_t i = 0;  i < W;  i++) { p[i] = this->v[i]; }
+    }
+
+    inline T operator[] (std::size_t i) const { return this->v[i]; }
+
+};
+
+
+
+
+/**
+ *  Generic lane-wise operations.
+ */
+#define m3d_packet_binary(op) \
+    template <typename T, std::size_t W> \
+    inline GPacket<T, W> operator op ( \
+        const GPacket<T, W> &a, const GPacket<T, W> &b \
+    ) { \
+        GPacket<T, W> r; \
+        for (std::size_t i = 0;  i < W;  i++) { r.v[i] = a.v[i] op b.v[i]; } \
+        return r; \
+    }
+m3d_packet_binary(+)
+m3d_packet_binary(-)
+m3d_packet_binary(*)
+m3d_packet_binary(/)
+#undef m3d_packet_binary
+
+
+#define m3d_packet_compare(op) \
+    template <typename T, std::size_t W> \
+    inline GPacketMask<T, W> operator op ( \
+        const GPacket<T, W> &a, const GPacket<T, W> &b \
+    ) { \
+        GPacketMask<T, W> r; \
+        for (std::size_t i = 0;  i < W;  i++) { r.m[i] = a.v[i] op b.v[i]; } \
+        return r; \
+    }
+m3d_packet_compare(<)
+m3d_packet_compare(<=)
+m3d_packet_compare(>)
+m3d_packet_compare(>=)
+m3d_packet_compare(==)
+m3d_packet_compare(!=)
+#undef m3d_packet_compare
+
+
+#define m3d_packet_mask_binary(op) \
+    template <typename T, std::size_t W> \
+    inline GPacketMask<T, W> operator op ( \
+        const GPacketMask<T, W> &a, const GPacketMask<T, W> &b \
+    ) { \
+        GPacketMask<T, W> r; \
+        for (std::size_t i = 0;  i < W;  i++) { r.m[i] = a.m[i] op b.m[i]; } \
+        return r; \
+    }
+m3d_packet_mask_binary(&)
+m3d_packet_mask_binary(|)
+#undef m3d_packet_mask_binary
+
+
+template <typename T, std::size_t W>
+inline GPacketMask<T, W> operator! (const GPacketMask<T, W> &a) {
+    GPacketMask<T, W> r;
+    for (std::size_t i = 0;  i < W;  i++) { r.m[i] = !a.m[i]; }
+    return r;
+}
+
+
+template <typename T, std::size_t W>
+inline GPacket<T, W> operator- (const GPacket<T, W> &a) {
+    GPacket<T, W> r;
+    for (std::size_t i = 0;  i < W;  i++) { r.v[i] = -a.v[i]; }
+    return r;
+}
+
+
+template <typename T, std::size_t W>
+inline GPacket<T, W> min (const GPacket<T, W> &a, const GPacket<T, W> &b) {
+    GPacket<T, W> r;
+    for (std::size_t i = 0;  i < W;  i++) {
+        r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i];
+    }
+    return r;
+}
+
+
+template <typename T, std::size_t W>
+inline GPacket<T, W> max (const GPacket<T, W> &a, const GPacket<T, W> &b) {
+    GPacket<T, W> r;
+    for (std::size_t i = 0;  i < W;  i++) {
+        r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i];
+    }
+    return r;
+}
+
+
+template <typename T, std::size_t W>
+inline GPacket<T, W> sqrt (const GPacket<T, W> &a) {
+    GPacket<T, W> r;
+    for (std::size_t i = 0;  i < W;  i++) { r.v[i] = std::sqrt(a.v[i]); }
+    return r;
+}
+
+
+template <typename T, std::size_t W>
+inline GPacket<T, W> abs (const GPacket<T, W> &a) {
+    GPacket<T, W> r;
+    for (std::size_t i = 0;  i < W;  i++) { r.v[i] = std::fabs(a.v[i]); }
+    return r;
+}
+
+
+template <typename T, std::size_t W>
+inline GPacket<T, W> select (
+    const GPacketMask<T, W> &m, const GPacket<T, W> &a, const GPacket<T, W> &b
+) {
+    GPacket<T, W> r;
+    for (std::size_t i = 0;  i < W;  i++) { r.v[i] = m.m[i] ? a.v[i] : b.v[i]; }
+    return r;
+}
+
+
+template <typename T, std::size_t W>
+inline bool any (const GPacketMask<T, W> &m) { return m.bits() != 0; }
+
+
+template <typename T, std::size_t W>
+inline bool all (const GPacketMask<T, W> &m) {
+    return m.bits() == (1 << W) - 1;
+}
+
+
+
+
+#if defined(M3D_SSE2)
+
+/**
+ *  4 x float (SSE2).
+ */
+template <>
+struct GPacketMask<float, 4> {
+
+    __m128 m;
+
+    static constexpr std::size_t width { 4 };
+
+    inline bool operator[] (std::size_t i) const {
+        return (this->bits() >> i) & 1;
+    }
+
+    inline int bits () const { return _mm_movemask_ps(this->m); }
+
+};
+
+
+template <>
+struct GPacket<float, 4> {
+
+    __m128 v;
+
+    static constexpr std::size_t width { 4 };
+
+    inline GPacket () {}
+    inline GPacket (float s): v { _mm_set1_ps(s) } {}
+    inline GPacket (__m128 v): v { v } {}
+
+    static inline GPacket load (const float *p) {
+        return GPacket(_mm_loadu_ps(p));
+    }
+
+    inline void store (float *p) const { _mm_storeu_ps(p, this->v); }
+
+    inline float operator[] (std::size_t i) const {
+        float lanes[4];
+        this->store(lanes);
+        return lanes[i];
+    }
+
+};
+
+
+#define m3d_packet_sse(op, f) \
+    inline GPacket<float, 4> operator op ( \
+        const GPacket<float, 4> &a, const GPacket<float, 4> &b \
+    ) { return GPacket<float, 4>(f(a.v, b.v)); }
+m3d_packet_sse(+, _mm_add_ps)
+m3d_packet_sse(-, _mm_sub_ps)
+m3d_packet_sse(*, _mm_mul_ps)
+m3d_packet_sse(/, _mm_div_ps)
+#undef m3d_packet_sse
+
+
+#define m3d_packet_sse_compare(op, f) \
+    inline GPacketMask<float, 4> operator op ( \
+        const GPacket<float, 4> &a, const GPacket<float, 4> &b \
+    ) { return GPacketMask<float, 4> { f(a.v, b.v) }; }
+m3d_packet_sse_compare(<, _mm_cmplt_ps)
+m3d_packet_sse_compare(<=, _mm_cmple_ps)
+m3d_packet_sse_compare(>, _mm_cmpgt_ps)
+m3d_packet_sse_compare(>=, _mm_cmpge_ps)
+m3d_packet_sse_compare(==, _mm_cmpeq_ps)
+m3d_packet_sse_compare(!=, _mm_cmpneq_ps)
+#undef m3d_packet_sse_compare
+
+
+inline GPacketMask<float, 4> operator& (
+    const GPacketMask<float, 4> &a, const GPacketMask<float, 4> &b
+) { return { _mm_and_ps(a.m, b.m) }; }
+
+
+inline GPacketMask<float, 4> operator| (
+    const GPacketMask<float, 4> &a, const GPacketMask<float, 4> &b
+) { return { _mm_or_ps(a.m, b.m) }; }
+
+
+inline GPacketMask<float, 4> operator! (const GPacketMask<float, 4> &a) {
+    return { _mm_xor_ps(a.m, _mm_castsi128_ps(_mm_set1_epi32(-1))) };
+}
+
+
+inline GPacket<float, 4> operator- (const GPacket<float, 4> &a) {
+    return GPacket<float, 4>(_mm_xor_ps(a.v, _mm_set1_ps(-0.0f)));
+}
+
+
+inline GPacket<float, 4> min (
+    const GPacket<float, 4> &a, const GPacket<float, 4> &b
+) { return GPacket<float, 4>(_mm_min_ps(a.v, b.v)); }
+
+
+inline GPacket<float, 4> max (
+    const GPacket<float, 4> &a, const GPacket<float, 4> &b
+) { return GPacket<float, 4>(_mm_max_ps(a.v, b.v)); }
+
+
+inline GPacket<float, 4> sqrt (const GPacket<float, 4> &a) {
+    return GPacket<float, 4>(_mm_sqrt_ps(a.v));
+}
+
+
+inline GPacket<float, 4> abs (const GPacket<float, 4> &a) {
+    return GPacket<float, 4>(_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v));
+}
+
+
+inline GPacket<float, 4> select (
+    const GPacketMask<float, 4> &m,
+    const GPacket<float, 4> &a, const GPacket<float, 4> &b
+) {
+    return GPacket<float, 4>(
+        _mm_or_ps(_mm_and_ps(m.m, a.v), _mm_andnot_ps(m.m, b.v))
+    );
+}
+
+#endif
+
+
+
+
+#if defined(M3D_AVX)
+
+/**
+ *  8 x float (AVX).
+ */
+template <>
+struct GPacketMask<float, 8> {
+
+    __m256 m;
+
+    static constexpr std::size_t width { 8 };
+
+    inline bool operator[] (std::size_t i) const {
+        return (this->bits() >> i) & 1;
+    }
+
+    inline int bits () const { return _mm256_movemask_ps(this->m); }
+
+};
+
+
+template <>
+struct GPacket<float, 8> {
+
+    __m256 v;
+
+    static constexpr std::size_t width { 8 };
+
+    inline GPacket () {}
+    inline GPacket (float s): v { _mm256_set1_ps(s) } {}
+    inline GPacket (__m256 v): v { v } {}
+
+    static inline GPacket load (const float *p) {
+        return GPacket(_mm256_loadu_ps(p));
+    }
+
+    inline void store (float *p) const { _mm256_storeu_ps(p, this->v); }
+
+    inline float operator[] (std::size_t i) const {
+        float lanes[8];
+        this->store(lanes);
+        return lanes[i];
+    }
+
+};
+
+
+#define m3d_packet_avx(op, f) \
+    inline GPacket<float, 8> operator op ( \
+        const GPacket<float, 8> &a, const GPacket<float, 8> &b \
+    ) { return GPacket<float, 8>(f(a.v, b.v)); }
+m3d_packet_avx(+, _mm256_add_ps)
+m3d_packet_avx(-, _mm256_sub_ps)
+m3d_packet_avx(*, _mm256_mul_ps)
+m3d_packet_avx(/, _mm256_div_ps)
+#undef m3d_packet_avx
+
+
+#define m3d_packet_avx_compare(op, p) \
+    inline GPacketMask<float, 8> operator op ( \
+        const GPacket<float, 8> &a, const GPacket<float, 8> &b \
+    ) { return GPacketMask<float, 8> { _mm256_cmp_ps(a.v, b.v, p) }; }
+m3d_packet_avx_compare(<, _CMP_LT_OQ)
+m3d_packet_avx_compare(<=, _CMP_LE_OQ)
+m3d_packet_avx_compare(>, _CMP_GT_OQ)
+m3d_packet_avx_compare(>=, _CMP_GE_OQ)
+m3d_packet_avx_compare(==, _CMP_EQ_OQ)
+m3d_packet_avx_compare(!=, _CMP_NEQ_UQ)
+#undef m3d_packet_avx_compare
+
+
+inline GPacketMask<float, 8> operator& (
+    const GPacketMask<float, 8> &a, const GPacketMask<float, 8> &b
+) { return { _mm256_and_ps(a.m, b.m) }; }
+
+
+inline GPacketMask<float, 8> operator| (
+    const GPacketMask<float, 8> &a, const GPacketMask<float, 8> &b
+) { return { _mm256_or_ps(a.m, b.m) }; }
+
+
+inline GPacketMask<float, 8> operator! (const GPacketMask<float, 8> &a) {
+    return { _mm256_xor_ps(a.m, _mm256_castsi256_ps(_mm256_set1_epi32(-1))) };
+}
+
+
+inline GPacket<float, 8> operator- (const GPacket<float, 8> &a) {
+    return GPacket<float, 8>(_mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f)));
+}
+
+
+inline GPacket<float, 8> min (
+    const GPacket<float, 8> &a, const GPacket<float, 8> &b
+) { return GPacket<float, 8>(_mm256_min_ps(a.v, b.v)); }
+
+
+inline GPacket<float, 8> max (
+    const GPacket<float, 8> &a, const GPacket<float, 8> &b
+) { return GPacket<float, 8>(_mm256_max_ps(a.v, b.v)); }
+
+
+inline GPacket<float, 8> sqrt (const GPacket<float, 8> &a) {
+    return GPacket<float, 8>(_mm256_sqrt_ps(a.v));
+}
+
+
+inline GPacket<float, 8> abs (const GPacket<float, 8> &a) {
+    return GPacket<float, 8>(_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v));
+}
+
+
+inline GPacket<float, 8> select (
+    const GPacketMask<float, 8> &m,
+    const GPacket<float, 8> &a, const GPacket<float, 8> &b
+) {
+    return GPacket<float, 8>(_mm256_blendv_ps(b.v, a.v, m.m));
+}
+
+#endif
+
+
+
+
+/**
+ *  Packet and scalar mixed arithmetic (scalar is broadcast).
+ */
+#define m3d_packet_scalar(op) \
+    template <typename T, std::size_t W> \
+    inline GPacket<T, W> operator op (const GPacket<T, W> &a, T s) { \
+        return a op GPacket<T, W>(s); \
+    } \
+    template <typename T, std::size_t W> \
+    inline GPacket<T, W> operator op (T s, const GPacket<T, W> &a) { \
+        return GPacket<T, W>(s) op a; \
+    }
+m3d_packet_scalar(+)
+m3d_packet_scalar(-)
+m3d_packet_scalar(*)
+m3d_packet_scalar(/)
+#undef m3d_packet_scalar
+
+
+
+
+/**
+ *  W 3-component vectors (one per lane), GVector3 API counterpart.
+ */
+template <typename T, std::size_t W>
+struct GVector3P {
+
+    using packet = GPacket<T, W>;
+
+    packet x, y, z;
+
+    static constexpr std::size_t width { W };
+
+
+    /**
+     *  ...
+     */
+    inline GVector3P () {}
+    inline GVector3P (const packet &x, const packet &y, const packet &z):
+        x { x }, y { y }, z { z } {}
+
+
+    /**
+     *  The same vector in every lane.
+     */
+    inline explicit GVector3P (const GArray<T, 3> &v):
+        x { v[0] }, y { v[1] }, z { v[2] } {}
+
+
+    /**
+     *  Load/store W consecutive vectors of structure-of-arrays storage.
+     */
+    static inline GVector3P load (
+        const GSoA3View<const T> &s, std::size_t i
+    ) {
+        return GVector3P(
+            packet::load(s.x + i), packet::load(s.y + i), packet::load(s.z + i)
+        );
+    }
+
+
+    inline void store (const GSoA3View<T> &s, std::size_t i) const {
+        this->x.store(s.x + i);
+        this->y.store(s.y + i);
+        this->z.store(s.z + i);
+    }
+
+
+    /**
+     *  Gather/scatter W consecutive (array of structures) vectors.
+     */
+    static inline GVector3P gather (const GVector3<T> *v) {
+        T lanes[3][W];
+        for (std::size_t i = 0;  i < W;  i++) {
+            lanes[0][i] = v[i][0];
+            lanes[1][i] = v[i][1];
+            lanes[2][i] = v[i][2];
+        }
+        return GVector3P(
+            packet::load(lanes[0]), packet::load(lanes[1]),
+            packet::load(lanes[2])
+        );
+    }
+
+
+    inline void scatter (GVector3<T> *v) const {
+        T lanes[3][W];
+        this->x.store(lanes[0]);
+        this->y.store(lanes[1]);
+        this->z.store(lanes[2]);
+        for (std::size_t i = 0;  i < W;  i++) {
+            v[i].assign(lanes[0][i], lanes[1][i], lanes[2][i]);
+        }
+    }
+
+
+    /**
+     *  Vector of a given lane.
+     */
+    inline GVector3<T> operator[] (std::size_t i) const {
+        return GVector3<T>(this->x[i], this->y[i], this->z[i]);
+    }
+
+};
+
+
+template <typename T, std::size_t W>
+inline GVector3P<T, W> operator+ (
+    const GVector3P<T, W> &a, const GVector3P<T, W> &b
+) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+
+
+template <typename T, std::size_t W>
+inline GVector3P<T, W> operator- (
+    const GVector3P<T, W> &a, const GVector3P<T, W> &b
+) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+
+
+template <typename T, std::size_t W>
+inline GVector3P<T, W> operator* (
+    const GVector3P<T, W> &a, const GPacket<T, W> &s
+) { return { a.x * s, a.y * s, a.z * s }; }
+
+
+template <typename T, std::size_t W>
+inline GVector3P<T, W> operator* (const GVector3P<T, W> &a, T s) {
+    return a * GPacket<T, W>(s);
+}
+
+
+template <typename T, std::size_t W>
+inline GPacket<T, W> dot (const GVector3P<T, W> &a, const GVector3P<T, W> &b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+
+template <typename T, std::size_t W>
+inline GVector3P<T, W> cross (
+    const GVector3P<T, W> &a, const GVector3P<T, W> &b
+) {
+    return {
+        a.y * b.z - a.z * b.y,
+        a.z * b.x - a.x * b.z,
+        a.x * b.y - a.y * b.x
+    };
+}
+
+
+template <typename T, std::size_t W>
+inline GPacket<T, W> sqr_length (const GVector3P<T, W> &a) {
+    return dot(a, a);
+}
+
+
+template <typename T, std::size_t W>
+inline GPacket<T, W> length (const GVector3P<T, W> &a) {
+    return sqrt(dot(a, a));
+}
+
+
+/**
+ *  Vectors of length close to zero become zero (as in kernels::normalize).
+ */
+template <typename T, std::size_t W>
+inline GVector3P<T, W> normalize (const GVector3P<T, W> &a) {
+    const GPacket<T, W> l { length(a) }, zero { static_cast<T>(0) };
+    return a * select(
+        l < GPacket<T, W>(static_cast<T>(m3d_epsilon)),
+        zero, GPacket<T, W>(static_cast<T>(1)) / l
+    );
+}
+
+
+template <typename T, std::size_t W>
+inline GVector3P<T, W> select (
+    const GPacketMask<T, W> &m,
+    const GVector3P<T, W> &a, const GVector3P<T, W> &b
+) {
+    return { select(m, a.x, b.x), select(m, a.y, b.y), select(m, a.z, b.z) };
+}
+
+
+template <typename T, std::size_t W>
+inline GVector3P<T, W> min (
+    const GVector3P<T, W> &a, const GVector3P<T, W> &b
+) { return { min(a.x, b.x), min(a.y, b.y), min(a.z, b.z) }; }
+
+
+template <typename T, std::size_t W>
+inline GVector3P<T, W> max (
+    const GVector3P<T, W> &a, const GVector3P<T, W> &b
+) { return { max(a.x, b.x), max(a.y, b.y), max(a.z, b.z) }; }
+
+
+
+
+/**
+ *  W 4-component vectors (one per lane), GVector4 API counterpart.
+ */
+template <typename T, std::size_t W>
+struct GVector4P {
+
+    using packet = GPacket<T, W>;
+
+    packet x, y, z, w;
+
+    static constexpr std::size_t width { W };
+
+
+    /**
+     *  ...
+     */
+    inline GVector4P () {}
+    inline GVector4P (
+        const packet &x, const packet &y, const packet &z, const packet &w
+    ): x { x }, y { y }, z { z }, w { w } {}
+    inline GVector4P (const GVector3P<T, W> &v, const packet &w):
+        x { v.x }, y { v.y }, z { v.z }, w { w } {}
+
+
+    /**
+     *  The same vector in every lane.
+     */
+    inline explicit GVector4P (const GArray<T, 4> &v):
+        x { v[0] }, y { v[1] }, z { v[2] }, w { v[3] } {}
+
+
+    /**
+     *  First three components.
+     */
+    inline GVector3P<T, W> xyz () const {
+        return GVector3P<T, W>(this->x, this->y, this->z);
+    }
+
+
+    /**
+     *  Vector of a given lane.
+     */
+    inline GVector4<T> operator[] (std::size_t i) const {
+        return GVector4<T>(this->x[i], this->y[i], this->z[i], this->w[i]);
+    }
+
+};
+
+
+template <typename T, std::size_t W>
+inline GVector4P<T, W> operator+ (
+    const GVector4P<T, W> &a, const GVector4P<T, W> &b
+) { return { a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w }; }
+
+
+template <typename T, std::size_t W>
+inline GVector4P<T, W> operator- (
+    const GVector4P<T, W> &a, const GVector4P<T, W> &b
+) { return { a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w }; }
+
+
+template <typename T, std::size_t W>
+inline GVector4P<T, W> operator* (
+    const GVector4P<T, W> &a, const GPacket<T, W> &s
+) { return { a.x * s, a.y * s, a.z * s, a.w * s }; }
+
+
+template <typename T, std::size_t W>
+inline GVector4P<T, W> operator* (const GVector4P<T, W> &a, T s) {
+    return a * GPacket<T, W>(s);
+}
+
+
+template <typename T, std::size_t W>
+inline GPacket<T, W> dot (const GVector4P<T, W> &a, const GVector4P<T, W> &b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+}
+
+
+template <typename T, std::size_t W>
+inline GVector4P<T, W> select (
+    const GPacketMask<T, W> &m,
+    const GVector4P<T, W> &a, const GVector4P<T, W> &b
+) {
+    return {
+        select(m, a.x, b.x), select(m, a.y, b.y),
+        select(m, a.z, b.z), select(m, a.w, b.w)
+    };
+}
+
+
+
+
+/**
+ *  4x4 matrix broadcast to all lanes (the same transformation
+ *  applied to W vectors). Sums run in the same order as
+ *  m3d::matrix_transform, so every lane equals "m * v".
+ */
+template <typename T, std::size_t W>
+struct GMatrix4P {
+
+    using packet = GPacket<T, W>;
+
+    packet m[4*4];
+
+    static constexpr std::size_t width { W };
+
+
+    /**
+     *  ...
+     */
+    inline explicit GMatrix4P (const GArray<T, 4*4> &a) {
+        for (std::size_t i = 0;  i < 4*4;  i++) { this->m[i] = packet(a[i]); }
+    }
+
+
+    /**
+     *  Transform four component vectors.
+     */
+    inline GVector4P<T, W> transform (const GVector4P<T, W> &v) const {
+        packet r[4];
+        for (std::size_t i = 0;  i < 4;  i++) {
+            r[i] = packet(static_cast<T>(0));
+            r[i] = r[i] + this->m[i] * v.x;
+            r[i] = r[i] + this->m[i + 4] * v.y;
+            r[i] = r[i] + this->m[i + 8] * v.z;
+            r[i] = r[i] + this->m[i + 12] * v.w;
+        }
+        return { r[0], r[1], r[2], r[3] };
+    }
+
+
+    /**
+     *  Transform points (w = 1, no perspective divide).
+     */
+    inline GVector3P<T, W> transform_point (const GVector3P<T, W> &v) const {
+        packet r[3];
+        for (std::size_t i = 0;  i < 3;  i++) {
+            r[i] = packet(static_cast<T>(0));
+            r[i] = r[i] + this->m[i] * v.x;
+            r[i] = r[i] + this->m[i + 4] * v.y;
+            r[i] = r[i] + this->m[i + 8] * v.z;
+            r[i] = r[i] + this->m[i + 12];
+        }
+        return { r[0], r[1], r[2] };
+    }
+
+
+    /**
+     *  Transform directions (w = 0).
+     */
+    inline GVector3P<T, W> transform_direction (
+        const GVector3P<T, W> &v
+    ) const {
+        packet r[3];
+        for (std::size_t i = 0;  i < 3;  i++) {
+            r[i] = packet(static_cast<T>(0));
+            r[i] = r[i] + this->m[i] * v.x;
+            r[i] = r[i] + this->m[i + 4] * v.y;
+            r[i] = r[i] + this->m[i + 8] * v.z;
+        }
+        return { r[0], r[1], r[2] };
+    }
+
+};
+
+
+
+
+/**
+ *  Widest packet of T held in a single register
+ *  (generic packets default to four lanes).
+ */
+template <typename T>
+struct native_width { static constexpr std::size_t value { 4 }; };
+
+#if defined(M3D_AVX)
+template <>
+struct native_width<float> { static constexpr std::size_t value { 8 }; };
+#endif
+
+
+
+
+/**
+ *  Float packets of SSE and AVX width.
+ */
+using f32x4 = GPacket<GLfloat, 4>;
+using f32x8 = GPacket<GLfloat, 8>;
+using vec3x4 = GVector3P<GLfloat, 4>;
+using vec3x8 = GVector3P<GLfloat, 8>;
+using vec4x4 = GVector4P<GLfloat, 4>;
+using vec4x8 = GVector4P<GLfloat, 8>;
+using mat4_x4 = GMatrix4P<GLfloat, 4>;
+using mat4_x8 = GMatrix4P<GLfloat, 8>;
+
+
+
+
+} // namespace m3d
+
+#endif
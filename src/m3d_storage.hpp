@@ -0,0 +1,312 @@
+/**
+ *  machina
+ *
+ *  Copyright (c) 2015, drmats
+ *  All rights reserved.
+ *
+ *  https://github.com/drmats/machina
+ */
+
+#ifndef __M3D_STORAGE_HPP_
+#define __M3D_STORAGE_HPP_ 1
+
+#include "m3d.hpp"
+#include <cstdint>
+#include <new>
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+namespace m3d {
+
+
+
+
+/**
+ *  Alignment of SIMD-friendly storage (widest vector register - AVX).
+ */
+constexpr std::size_t simd_alignment { 32 };
+
+
+
+
+/**
+ *  Allocator returning memory aligned to "A" bytes ("A" has to be
+ *  a power of two). The original pointer is kept right before
+ *  the aligned block.
+ */
+template <typename T, std::size_t A = simd_alignment>
+class aligned_allocator {
+
+    static_assert(
+        A >= sizeof(void*)  &&  (A & (A - 1)) == 0,
+        "m3d::aligned_allocator: alignment has to be a power of two."
+    );
+
+
+public:
+
+    using value_type = T;
+
+
+    template <typename U>
+    struct rebind { using other = aligned_allocator<U, A>; };
+
+
+    /**
+     *  ...
+     */
+    aligned_allocator () noexcept {}
+    template <typename U>
+    aligned_allocator (const aligned_allocator<U, A> &) noexcept {}
+
+
+    /**
+     *  Allocate storage for "n" objects.
+     */
+    T* allocate (std::size_t n) {
+        if (n > (std::numeric_limits<std::size_t>::max() - A) / sizeof(T)) {
+            throw std::bad_alloc();
+        }
+        void *raw { ::operator new(n*sizeof(T) + A) };
+        const std::uintptr_t aligned {
+            (reinterpret_cast<std::uintptr_t>(raw) + A) & ~(A - 1)
+        };
+        reinterpret_cast<void**>(aligned)[-1] = raw;
+        return reinterpret_cast<T*>(aligned);
+    }
+
+
+    /**
+     *  Release storage obtained from "allocate".
+     */
+    void deallocate (T *p, std::size_t) noexcept {
+        ::operator delete(reinterpret_cast<void**>(p)[-1]);
+    }
+
+};
+
+
+template <typename T, typename U, std::size_t A>
+inline bool operator== (
+    const aligned_allocator<T, A> &, const aligned_allocator<U, A> &
+) {
+    return true;
+}
+
+
+template <typename T, typename U, std::size_t A>
+inline bool operator!= (
+    const aligned_allocator<T, A> &, const aligned_allocator<U, A> &
+) {
+    return false;
+}
+
+
+
+
+/**
+ *  std::vector with SIMD-aligned storage.
+ */
+template <typename T>
+using aligned_vector = std::vector<T, aligned_allocator<T>>;
+
+
+
+
+/**
+ *  3-component vector padded to four components and aligned
+ *  to their size (16 bytes for float), so it can be loaded
+ *  with a single aligned SIMD load. The padding is kept zero
+ *  (a direction in homogeneous coordinates).
+ */
+template <typename T>
+class alignas(4*sizeof(T)) GVector3A : public GVector3<T> {
+
+    T padding { static_cast<T>(0) };
+
+
+public:
+
+    /**
+     *  ...
+     */
+    constexpr GVector3A () {}
+    constexpr GVector3A (T x0, T x1, T x2): GVector3<T>(x0, x1, x2) {}
+    constexpr GVector3A (const GArray<T, 3> &a): GVector3<T>(a) {}
+    template <typename E>
+    constexpr GVector3A (const GExpr<E, T, 3> &e): GVector3<T>(e) {}
+
+
+    /**
+     *  ...
+     */
+    using GArray<T, 3>::operator=;
+
+};
+
+
+
+
+/**
+ *  Non-owning view of structure-of-arrays 3-vector storage
+ *  (T may be const-qualified for read-only views).
+ */
+template <typename T>
+struct GSoA3View {
+    T *x;
+    T *y;
+    T *z;
+    std::size_t size;
+
+    constexpr GSoA3View (T *x, T *y, T *z, std::size_t size):
+        x { x }, y { y }, z { z }, size { size } {}
+
+    // mutable to read-only view
+    template <typename U>
+    constexpr GSoA3View (const GSoA3View<U> &v):
+        x { v.x }, y { v.y }, z { v.z }, size { v.size } {}
+};
+
+
+
+
+/**
+ *  Structure-of-arrays 3-vector container: x, y and z streams in one
+ *  aligned buffer. Every stream is padded to a multiple of the SIMD
+ *  width ("padded_size", padding is zero) and starts aligned, so
+ *  kernels may process whole registers without a scalar tail.
+ */
+template <typename T>
+class GSoA3 {
+
+    using vec3 = GVector3<T>;
+
+
+public:
+
+    /**
+     *  Number of elements in one SIMD-aligned block.
+     */
+    static constexpr std::size_t lanes { simd_alignment / sizeof(T) };
+
+
+private:
+
+    aligned_vector<T> buffer;
+    std::size_t count { 0 }, stride { 0 };
+
+
+public:
+
+    /**
+     *  ...
+     */
+    GSoA3 () {}
+    explicit GSoA3 (std::size_t n) { this->resize(n); }
+
+
+    /**
+     *  Number of vectors.
+     */
+    inline std::size_t size () const { return this->count; }
+
+
+    /**
+     *  Length of every stream (size rounded up to SIMD width).
+     */
+    inline std::size_t padded_size () const { return this->stride; }
+
+
+    /**
+     *  Change the number of vectors (existing ones are kept,
+     *  new ones are zero).
+     */
+    void resize (std::size_t n) {
+        const std::size_t
+            padded { (n + lanes - 1) / lanes * lanes },
+            keep { std::min(n, this->count) };
+        if (padded != this->stride) {
+            aligned_vector<T> streams(3*padded, static_cast<T>(0));
+            for (std::size_t s = 0;  s < 3;  s++) {
+                std::copy(
+                    this->buffer.begin() + s*this->stride,
+                    this->buffer.begin() + s*this->stride + keep,
+                    streams.begin() + s*padded
+                );
+            }
+            this->buffer.swap(streams);
+            this->stride = padded;
+        } else {
+            for (std::size_t s = 0;  s < 3;  s++) {
+                std::fill(
+                    this->buffer.begin() + s*padded + keep,
+                    this->buffer.begin() + (s + 1)*padded,
+                    static_cast<T>(0)
+                );
+            }
+        }
+        this->count = n;
+    }
+
+
+    /**
+     *  Streams.
+     */
+    inline T* x () { return this->buffer.data(); }
+    inline T* y () { return this->buffer.data() + this->stride; }
+    inline T* z () { return this->buffer.data() + 2*this->stride; }
+    inline const T* x () const { return this->buffer.data(); }
+    inline const T* y () const { return this->buffer.data() + this->stride; }
+    inline const T* z () const {
+        return this->buffer.data() + 2*this->stride;
+    }
+
+
+    /**
+     *  Gather i-th vector.
+     */
+    inline vec3 get (std::size_t i) const {
+        return vec3(this->x()[i], this->y()[i], this->z()[i]);
+    }
+
+
+    /**
+     *  Scatter i-th vector.
+     */
+    inline void set (std::size_t i, const GArray<T, 3> &v) {
+        this->x()[i] = v[0];
+        this->y()[i] = v[1];
+        this->z()[i] = v[2];
+    }
+
+
+    /**
+     *  Zero-copy views of "n" vectors starting at "first" (streams
+     *  stay aligned when "first" is a multiple of "lanes").
+     */
+    inline GSoA3View<T> view (std::size_t first, std::size_t n) {
+        return { this->x() + first, this->y() + first, this->z() + first, n };
+    }
+
+
+    inline GSoA3View<const T> view (std::size_t first, std::size_t n) const {
+        return { this->x() + first, this->y() + first, this->z() + first, n };
+    }
+
+
+    inline GSoA3View<T> view () { return this->view(0, this->count); }
+
+
+    inline GSoA3View<const T> view () const {
+        return this->view(0, this->count);
+    }
+
+};
+
+
+
+
+} // namespace m3d
+
+#endif
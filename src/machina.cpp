@@ -11,6 +11,7 @@
 #define __MACHINA_CPP_ 1
 
 #include "machina.hpp"
+#include "m3d_kernels.hpp"
 #include <iostream>
 
 namespace machina {
@@ -191,6 +192,12 @@ void Machina::initialize_surface () {
         << reinterpret_cast<const char *>(glGetString(GL_SHADING_LANGUAGE_VERSION))
         << std::endl;
 
+    // m3d kernels code path
+    std::cout
+        << "m3d kernels: "
+        << m3d::kernels::isa_name(m3d::kernels::active_isa())
+        << std::endl;
+
     // GL extensions
     glGetIntegerv(GL_NUM_EXTENSIONS, &this->opengl_num_extensions);
     std::cout
@@ -14,6 +14,7 @@
 #include "machina.hpp"
 #include "primitives.hpp"
 #include "mesh_loader.hpp"
+#include "m3d_kernels.hpp"
 #include <tuple>
 #include <iostream>
 
@@ -310,6 +311,12 @@ void MainLoop::default_handler_t::keyboard (
                     << "      dist: " << ml->camera.dist << " "
                     << "yaw: " << ml->camera.yaw << " "
                     << "pitch: " << ml->camera.pitch
+                    << std::endl
+                    << "   culling: "
+                    << ml->cull_stats.drawn << " drawn, "
+                    << ml->cull_stats.culled << " culled (last frame), "
+                    << ml->cull_stats.total_drawn << " drawn, "
+                    << ml->cull_stats.total_culled << " culled (total)"
                     << std::endl;
             }
             break;
@@ -382,6 +389,15 @@ MainLoop::MainLoop (Machina *root):
             std::make_tuple("vert_position", Shader::attrib_index::vertex),
             std::make_tuple("vert_normal", Shader::attrib_index::normal),
             std::make_tuple("vert_uv", Shader::attrib_index::uv)
+    } },
+
+    // ... and its variant for packed attributes
+    packed_attrib_shader {
+        Shader::vs_packed_attrib,
+        Shader::fs_all_attrib, {
+            std::make_tuple("vert_position", Shader::attrib_index::vertex),
+            std::make_tuple("vert_normal", Shader::attrib_index::normal),
+            std::make_tuple("vert_uv", Shader::attrib_index::uv)
     } }
 {
     this->assign_default_handlers();
@@ -517,65 +533,179 @@ inline void MainLoop::process_events () {
 
 
 
+/**
+ *  Build the scene: static "stage" (already in world space) and
+ *  (if loaded) a ring of test meshes with the big one in the center.
+ */
+void MainLoop::setup_scene () {
+    this->nodes.axes = this->scene.add(
+        Scene::root, primitives::axes(160.0f, 10.0f)
+    );
+    this->nodes.grid = this->scene.add(
+        Scene::root,
+        primitives::grid(160.0f, 10.0f, vec4(0.15f, 0.15f, 0.25f, 1))
+    );
+    this->nodes.point_cube = this->scene.add(
+        Scene::root, primitives::point_cube(160.0f*64.0f, 640.0f, 0.6f)
+    );
+
+    // load model
+    try {
+        auto monkey = load_mesh("../models/monkey.ooo", true);
+        this->nodes.ring = this->scene.add(Scene::root);
+        for (int i = 0;  i < 12;  i++) {
+            this->nodes.test_mesh[i] =
+                this->scene.add(this->nodes.ring, monkey);
+        }
+        this->nodes.big_mesh = this->scene.add(
+            Scene::root, monkey, this->big_mesh_transform.get_affine()
+        );
+        this->nodes.model = true;
+    } catch (std::runtime_error &e) {
+        std::cout
+            << "MainLoop::setup_scene: "
+            << e.what()
+            << std::endl;
+    }
+
+    this->visibility.resize(this->scene.size());
+    this->scene.update();
+}
+
+
+
+
+/**
+ *  Animation (local transformations of scene nodes).
+ */
+inline void MainLoop::animate () {
+    if (this->nodes.model) {
+
+        // animation phases of all test meshes (time is wrapped once
+        // per frequency, sines are then evaluated in one batch)
+        static const double frequency[5] {
+            0.008, 0.006, 0.004, 0.010, 0.012
+        };
+        GLfloat phase[12*5], sine[12*5], cosine[12*5];
+        for (int j = 0;  j < 5;  j++) {
+            const double base {
+                m3d::positive_fmod(this->total_time*frequency[j], m3d_twopi)
+            };
+            for (int i = 0;  i < 12;  i++) {
+                phase[i*5 + j] = static_cast<GLfloat>(base + i);
+            }
+        }
+        m3d::kernels::fast_sincos(sine, cosine, phase, 12*5);
+
+        // test meshes in a circle around world origin
+        // (rebuilt every frame - the 3x4 chain is the cheapest one)
+        for (int i = 0;  i < 12;  i++) {
+            const GLfloat *s { sine + i*5 };
+            this->scene.set_local(
+                this->nodes.test_mesh[i],
+                affine().load_rotation_fast(i * 30 + s[0]*3, 0, 1, 0) *
+                affine().load_translation(
+                    0, 5.5f + s[1]*8+8, 65 + s[2]*12+12
+                ) *
+                affine().load_rotation_fast(-35 - (s[3]*16+16), 1, 0, 0) *
+                affine().load_rotation_fast(s[4]*22, 0, 1, 0)
+            );
+        }
+
+        // the big one in the center (rotated incrementally, kept
+        // as TRS so the rotation can be renormalized without drift)
+        if (this->elapsed_time != 0) {
+            this->big_mesh_transform =
+                transform().load_rotation(this->elapsed_time*0.1, 0, 1, 0) *
+                this->big_mesh_transform;
+            this->big_mesh_transform.rotation.normalize();
+            this->scene.set_local(
+                this->nodes.big_mesh, this->big_mesh_transform.get_affine()
+            );
+        }
+
+    }
+
+    // recompute changed subtrees only
+    this->scene.update();
+}
+
+
+
+
 /**
  *  Drawing.
  */
 inline void MainLoop::draw () const {
+    // model and view transformations are affine (3x4),
+    // only the final model-view matrices are expanded to 4x4
+    affine v_matrix { this->camera.transform.get_view() };
     mat4
-        v_matrix { this->camera.transform.get_view_matrix() },
         p_matrix { this->camera.projection.get_matrix() },
-        vp_matrix { this->camera.get_vp_matrix() },
-        m_matrix;
-    static mat4
-        big_mesh_m_matrix {
-            mat4().load_translation(0, 40, 0) *
-            mat4().load_scale(4, 4, 4)
-        };
+        vp_matrix { this->camera.get_vp_matrix() };
 
-    big_mesh_m_matrix =
-        mat4().load_rotation(this->elapsed_time*0.1, 0, 1, 0) *
-        big_mesh_m_matrix;
+    // cull all scene nodes at once (world-space bounding spheres)
+    const std::size_t drawn {
+        this->scene.classify(
+            this->visibility.data(), this->camera.get_frustum()
+        )
+    };
+    this->cull_stats.drawn = drawn;
+    this->cull_stats.culled = this->scene.drawable() - drawn;
+    this->cull_stats.total_drawn += this->cull_stats.drawn;
+    this->cull_stats.total_culled += this->cull_stats.culled;
+    auto visible = [this] (Scene::node n) {
+        return
+            this->visibility[this->scene.get_position(n)] !=
+                m3d::containment::outside;
+    };
 
     // drawing helper
-    auto draw_wire_stuff = [this] (
-        const std::vector<std::shared_ptr<Batch>> &scene,
-        const mat4 &mvp_matrix
-    ) {
-        // load first shader and ...
+    auto draw_wire_stuff = [this] (Scene::node n, const mat4 &vp_matrix) {
+        const mat4 mvp_matrix {
+            vp_matrix * this->scene.get_world(n).get_matrix()
+        };
+
+        // load shader and ... draw things with it
         this->vertex_color_attrib_shader.use({
             std::make_tuple("mvp_matrix", [&] (GLint location) {
                 glUniformMatrix4fv(location, 1, GL_FALSE, *mvp_matrix);
             })
         });
-
-        // ... draw things with it
-        glLineWidth(2.2f);
-        scene[0]->draw();
-        glLineWidth(1.4f);
-        scene[1]->draw();
-        glPointSize(1.0f);
-        scene[2]->draw();
+        this->scene.get_batch(n)->draw();
     };
 
-    // drawing helper
-    auto draw_test_mesh = [this] (
+    // drawing helper (stored positions are mapped to model
+    // space first, normals don't need that mapping)
+    auto draw_test_mesh = [this, &v_matrix, &p_matrix] (
         const std::shared_ptr<Batch> &batch,
-        const mat4 &mv_matrix,
-        const mat4 &p_matrix,
+        const affine &m_matrix,
         vec4 color
     ) {
         static const vec3 light_direction { 0, 0, 1 };
+        const affine mv { v_matrix * m_matrix };
+        const mat4
+            mv_matrix { (mv * batch->get_decode()).get_matrix() },
+            normal_source { mv.get_matrix() };
+        const mat3 normal_matrix { normal_source.inverse_transpose3x3() };
+        const Shader &shader {
+            batch->is_packed() ?
+                this->packed_attrib_shader : this->all_attrib_shader
+        };
 
         color[3] = 1;
 
         // load shader and ... draw things with it
-        this->all_attrib_shader.use({
+        shader.use({
             std::make_tuple("mv_matrix", [&] (GLint location) {
                 glUniformMatrix4fv(location, 1, GL_FALSE, *mv_matrix);
             }),
             std::make_tuple("p_matrix", [&] (GLint location) {
                 glUniformMatrix4fv(location, 1, GL_FALSE, *p_matrix);
             }),
+            std::make_tuple("normal_matrix", [&] (GLint location) {
+                glUniformMatrix3fv(location, 1, GL_FALSE, *normal_matrix);
+            }),
             std::make_tuple("color", [&] (GLint location) {
                 glUniform4fv(location, 1, *color);
             }),
@@ -590,49 +720,42 @@ inline void MainLoop::draw () const {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     // draw some stuff
-    draw_wire_stuff(this->scene, vp_matrix);
-
-    // (fourth element in the scene should be loaded model)
-    if (this->scene.size() == 4) {
+    glLineWidth(2.2f);
+    if (visible(this->nodes.axes)) {
+        draw_wire_stuff(this->nodes.axes, vp_matrix);
+    }
+    glLineWidth(1.4f);
+    if (visible(this->nodes.grid)) {
+        draw_wire_stuff(this->nodes.grid, vp_matrix);
+    }
+    glPointSize(1.0f);
+    if (visible(this->nodes.point_cube)) {
+        draw_wire_stuff(this->nodes.point_cube, vp_matrix);
+    }
 
-        // draw test meshes in a circle around world origin
+    // draw visible test meshes
+    if (this->nodes.model) {
         for (int i = 0;  i < 12;  i++) {
-            m_matrix =
-                mat4().load_rotation(
-                    i * 30 + std::sin(this->total_time*0.008+i)*3,
-                    0, 1, 0
-                ) *
-                mat4().load_translation(
-                    0,
-                    5.5 + std::sin(this->total_time*0.006+i)*8+8,
-                    65 + std::sin(this->total_time*0.004+i)*12+12
-                ) *
-                mat4().load_rotation(
-                    -35 - (std::sin(this->total_time*0.010+i)*16+16),
-                    1, 0, 0
-                ) *
-                mat4().load_rotation(
-                    std::sin(this->total_time*0.012+i)*22,
-                    0, 1, 0
-                );
+            const Scene::node n { this->nodes.test_mesh[i] };
+            if (!visible(n)) { continue; }
+            const affine &m_matrix { this->scene.get_world(n) };
             draw_test_mesh(
-                this->scene[3],
-                v_matrix * m_matrix,
-                p_matrix,
+                this->scene.get_batch(n),
+                m_matrix,
                 vec4(
-                    (m_matrix * vec4(1, 0, 0, 0)).normalize() * 0.5f +
+                    vec4(m_matrix.transform_direction(vec3(1, 0, 0)), 0)
+                        .normalize() * 0.5f +
                     vec4(1, 1, 1, 0)
                 ).normalize()
             );
         }
-
-        // draw test mesh in the center
-        draw_test_mesh(
-            this->scene[3],
-            v_matrix * big_mesh_m_matrix,
-            p_matrix,
-            vec4(0.2, 0.6, 0.8, 1.0)
-        );
+        if (visible(this->nodes.big_mesh)) {
+            draw_test_mesh(
+                this->scene.get_batch(this->nodes.big_mesh),
+                this->scene.get_world(this->nodes.big_mesh),
+                vec4(0.2, 0.6, 0.8, 1.0)
+            );
+        }
     }
 }
 
@@ -646,20 +769,7 @@ void MainLoop::run () {
     std::chrono::steady_clock::time_point time_mark;
 
     // prepare "stage"
-    this->scene.push_back(primitives::axes(160.0f, 10.0f));
-    this->scene.push_back(primitives::grid(160.0f, 10.0f, vec4(0.15f, 0.15f, 0.25f, 1)));
-    this->scene.push_back(primitives::point_cube(160.0f*64.0f, 640.0f, 0.6f));
-
-    // load model
-    try {
-        auto monkey = load_mesh("../models/monkey.ooo");
-        this->scene.push_back(monkey);
-    } catch (std::runtime_error &e) {
-        std::cout
-            << "MainLoop::run: "
-            << e.what()
-            << std::endl;
-    }
+    this->setup_scene();
 
     time_mark = std::chrono::steady_clock::now();
     this->running = true;
@@ -667,6 +777,7 @@ void MainLoop::run () {
         this->time_mark = time_mark;
         this->process_events();
         this->camera_transformer.update(this->elapsed_time, this->total_time);
+        this->animate();
         this->draw();
         SDL_GL_SwapWindow(this->root->main_window);
         if (this->update_time) {
@@ -16,7 +16,9 @@
 #include <memory>
 #include <chrono>
 #include "camera.hpp"
+#include "gtransform.hpp"
 #include "batch.hpp"
+#include "scene.hpp"
 #include "shader.hpp"
 
 namespace machina {
@@ -40,7 +42,10 @@ class MainLoop {
     using vec2 = m3d::GVector2<GLfloat>;
     using vec3 = m3d::GVector3<GLfloat>;
     using vec4 = m3d::GVector4<GLfloat>;
+    using mat3 = m3d::GMatrix<GLfloat, 3>;
     using mat4 = m3d::GMatrix4<GLfloat>;
+    using affine = m3d::GAffine<GLfloat>;
+    using transform = m3d::GTransform<GLfloat>;
 
 
 private:
@@ -94,14 +99,31 @@ private:
     CameraTransformer<GLfloat> camera_transformer;
 
 
-    // simple "scene"
-    std::vector<std::shared_ptr<Batch>> scene;
+    // scene graph (static "stage" first, animated nodes
+    // last - only their subtrees are recomputed per frame)
+    Scene scene;
+    struct {
+        Scene::node axes, grid, point_cube, ring, test_mesh[12], big_mesh;
+        bool model { false };
+    } nodes;
+    transform big_mesh_transform {
+        vec3(0, 40, 0), m3d::GQuaternion<GLfloat>(), vec3(4, 4, 4)
+    };
+    mutable std::vector<m3d::containment> visibility;
+
+
+    // frustum culling counters (objects drawn/culled
+    // in the last frame and since start)
+    mutable struct {
+        GLulong drawn, culled, total_drawn, total_culled;
+    } cull_stats { 0, 0, 0, 0 };
 
 
     // shaders
     Shader
         vertex_color_attrib_shader,
-        all_attrib_shader;
+        all_attrib_shader,
+        packed_attrib_shader;
 
 
     // loop sustaining variable
@@ -142,6 +164,18 @@ public:
     inline void process_events ();
 
 
+    /**
+     *  Build the scene (stage and loaded model).
+     */
+    void setup_scene ();
+
+
+    /**
+     *  Animation (local transformations of scene nodes).
+     */
+    inline void animate ();
+
+
     /**
      *  Drawing.
      */
@@ -11,6 +11,7 @@
 #define __MESH_LOADER_CPP_ 1
 
 #include "mesh_loader.hpp"
+#include "m3d_kernels.hpp"
 #include <vector>
 #include <fstream>
 #include <cstdint>
@@ -113,7 +114,7 @@ void read_bin_mesh (
  *  *.ooo file loader.
  */
 std::shared_ptr<TriangleBatch> load_mesh (
-    const std::string &path
+    const std::string &path, bool packed
 ) noexcept(false) {
     std::ifstream file_input;
     mesh geometry;
@@ -129,11 +130,15 @@ std::shared_ptr<TriangleBatch> load_mesh (
     read_bin_mesh(geometry, file_input);
     file_input.close();
 
+    // exported normals are not always of unit length
+    m3d::kernels::normalize(geometry.normals, geometry.normals);
+
     batch->prepare(
         geometry.verts,
         geometry.normals,
         geometry.uvs,
-        geometry.indices
+        geometry.indices,
+        packed
     );
 
     return batch;
@@ -21,10 +21,11 @@ namespace machina {
 
 
 /**
- *  *.ooo file loader.
+ *  *.ooo file loader (optionally uploads packed attributes,
+ *  see TriangleBatch::prepare).
  */
 std::shared_ptr<TriangleBatch> load_mesh (
-    const std::string &path
+    const std::string &path, bool packed = false
 ) noexcept(false);
 
 
@@ -127,7 +127,7 @@ std::shared_ptr<VertexColorBatch> point_cube (GLfloat dim, GLfloat s, GLfloat a)
         }
     }
 
-    batch->prepare(GL_POINTS, v, c);
+    batch->prepare(GL_POINTS, v, c, true);
 
     return batch;
 }
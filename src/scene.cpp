@@ -0,0 +1,165 @@
+/**
+ *  machina
+ *
+ *  Copyright (c) 2015, drmats
+ *  All rights reserved.
+ *
+ *  https://github.com/drmats/machina
+ */
+
+#ifndef __SCENE_CPP_
+#define __SCENE_CPP_ 1
+
+#include "scene.hpp"
+#include <stdexcept>
+
+namespace machina {
+
+
+
+
+/**
+ *  Root node handle (definition).
+ */
+constexpr Scene::node Scene::root;
+
+
+
+
+/**
+ *  Create a scene with the root node only.
+ */
+Scene::Scene ():
+    parent { 0 },
+    extent { 1 },
+    id { Scene::root },
+    local(1),
+    world(1),
+    bounds(1),
+    dirty { 0 },
+    batch(1),
+    position { 0 },
+    first_dirty { 1 },
+    drawable_count { 0 }
+{}
+
+
+
+
+/**
+ *  Position of a given node (throws std::out_of_range).
+ */
+std::size_t Scene::position_of (node n) const noexcept(false) {
+    if (n >= this->position.size()) {
+        throw std::out_of_range(m3d::msg::out_of_range);
+    }
+    return this->position[n];
+}
+
+
+
+
+/**
+ *  Add a new (last) child of a given node and return its handle.
+ *  New node is placed right after the subtree of its parent,
+ *  all nodes behind it are moved by one.
+ */
+Scene::node Scene::add (
+    node parent,
+    const std::shared_ptr<Batch> &batch,
+    const affine &local
+) {
+    const std::size_t
+        p { this->position_of(parent) },
+        at { p + this->extent[p] };
+    const node n { this->position.size() };
+
+    for (std::size_t i = at;  i < this->size();  i++) {
+        this->position[this->id[i]]++;
+        if (this->parent[i] >= at) { this->parent[i]++; }
+    }
+    for (std::size_t i = p;  ;  i = this->parent[i]) {
+        this->extent[i]++;
+        if (i == 0) { break; }
+    }
+
+    this->parent.insert(this->parent.begin() + at, p);
+    this->extent.insert(this->extent.begin() + at, 1);
+    this->id.insert(this->id.begin() + at, n);
+    this->local.insert(this->local.begin() + at, local);
+    this->world.insert(this->world.begin() + at, affine());
+    this->bounds.insert(this->bounds.begin() + at, sphere());
+    this->dirty.insert(this->dirty.begin() + at, 1);
+    this->batch.insert(this->batch.begin() + at, batch);
+    this->position.push_back(at);
+
+    if (this->first_dirty >= at) { this->first_dirty = at; }
+    if (batch) { this->drawable_count++; }
+    return n;
+}
+
+
+
+
+/**
+ *  Replace local transformation of a given node.
+ */
+void Scene::set_local (node n, const affine &local) {
+    const std::size_t i { this->position_of(n) };
+    this->local[i] = local;
+    this->dirty[i] = 1;
+    if (i < this->first_dirty) { this->first_dirty = i; }
+}
+
+
+
+
+/**
+ *  Recompute world transformations and bounds of all dirty
+ *  subtrees (parents are always already up to date).
+ */
+std::size_t Scene::update () {
+    const std::size_t n { this->size() };
+    std::size_t i { this->first_dirty }, updated { 0 };
+
+    while (i < n) {
+        if (!this->dirty[i]) { i++;  continue; }
+        for (const std::size_t end { i + this->extent[i] };  i < end;  i++) {
+            if (i == 0) {
+                this->world[0] = this->local[0];
+            } else {
+                this->world[i].multiply(
+                    this->world[this->parent[i]], this->local[i]
+                );
+            }
+            if (this->batch[i]) {
+                this->bounds[i] =
+                    this->batch[i]->get_sphere().transformed(this->world[i]);
+            }
+            this->dirty[i] = 0;
+            updated++;
+        }
+    }
+
+    this->first_dirty = n;
+    return updated;
+}
+
+
+
+
+/**
+ *  Classify bounds of all nodes against the frustum.
+ */
+std::size_t Scene::classify (
+    m3d::containment *out, const frustum &f
+) const {
+    return f.classify(out, this->bounds.data(), this->size());
+}
+
+
+
+
+} // namespace machina
+
+#endif
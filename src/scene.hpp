@@ -0,0 +1,176 @@
+/**
+ *  machina
+ *
+ *  Copyright (c) 2015, drmats
+ *  All rights reserved.
+ *
+ *  https://github.com/drmats/machina
+ */
+
+#ifndef __SCENE_HPP_
+#define __SCENE_HPP_ 1
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "m3d.hpp"
+#include "gaffine.hpp"
+#include "gbounds.hpp"
+#include "batch.hpp"
+
+namespace machina {
+
+
+
+
+/**
+ *  Scene graph - hierarchy of nodes with local transformations
+ *  (relative to the parent) and optional batches.
+ *
+ *  All per-node data is stored in flat arrays in depth-first
+ *  order (every subtree occupies a contiguous range, parents
+ *  always precede their children), so world transformations are
+ *  recomputed in one forward pass. Changed nodes are marked
+ *  dirty and only their subtrees are recomputed - nodes which
+ *  never change (and everything before the first dirty node)
+ *  cost nothing per frame.
+ *
+ *  Node handles are stable (insertion of new nodes moves the
+ *  data in the arrays, but not the handles).
+ */
+class Scene {
+
+    using affine = m3d::GAffine<GLfloat>;
+    using sphere = m3d::GSphere<GLfloat>;
+    using frustum = m3d::GFrustum<GLfloat>;
+
+
+public:
+
+    /**
+     *  Node handle.
+     */
+    using node = std::size_t;
+
+
+    /**
+     *  Root node (always present, identity by default).
+     */
+    static constexpr node root { 0 };
+
+
+private:
+
+    /**
+     *  Per-node data (depth-first order).
+     *
+     *  parent  -- position of the parent node (root: itself)
+     *  extent  -- number of nodes in the subtree (node included)
+     *  id      -- handle of the node at a given position
+     *  local   -- transformation relative to the parent
+     *  world   -- transformation relative to the root
+     *  bounds  -- world space bounding sphere of the batch
+     *  dirty   -- local transformation changed since last update
+     */
+    std::vector<std::size_t> parent, extent;
+    std::vector<node> id;
+    std::vector<affine> local, world;
+    std::vector<sphere> bounds;
+    std::vector<std::uint8_t> dirty;
+    std::vector<std::shared_ptr<Batch>> batch;
+
+
+    /**
+     *  Position of every node (indexed by handle).
+     */
+    std::vector<std::size_t> position;
+
+
+    /**
+     *  Position of the first dirty node (or "size()" if none)
+     *  and number of nodes with batches.
+     */
+    std::size_t first_dirty, drawable_count;
+
+
+    /**
+     *  Position of a given node (throws std::out_of_range).
+     */
+    std::size_t position_of (node) const noexcept(false);
+
+
+public:
+
+    /**
+     *  Create a scene with the root node only.
+     */
+    Scene ();
+
+
+    /**
+     *  Add a new (last) child of a given node and return its handle.
+     */
+    node add (
+        node parent,
+        const std::shared_ptr<Batch> &batch = nullptr,
+        const affine &local = affine()
+    );
+
+
+    /**
+     *  Replace local transformation of a given node
+     *  (world transformations are recomputed in "update").
+     */
+    void set_local (node, const affine &);
+
+
+    /**
+     *  Recompute world transformations and bounds of all
+     *  dirty subtrees. Returns the number of recomputed nodes.
+     */
+    std::size_t update ();
+
+
+    /**
+     *  Classify bounds of all nodes against the frustum, "out"
+     *  has to hold "size()" elements, indexed by position
+     *  (nodes without batches are always outside). Returns the
+     *  number of visible nodes.
+     */
+    std::size_t classify (m3d::containment *out, const frustum &) const;
+
+
+    /**
+     *  Node accessors (world data is valid after "update").
+     */
+    inline const affine& get_local (node n) const {
+        return this->local[this->position_of(n)];
+    }
+    inline const affine& get_world (node n) const {
+        return this->world[this->position_of(n)];
+    }
+    inline const sphere& get_bounds (node n) const {
+        return this->bounds[this->position_of(n)];
+    }
+    inline const std::shared_ptr<Batch>& get_batch (node n) const {
+        return this->batch[this->position_of(n)];
+    }
+    inline std::size_t get_position (node n) const {
+        return this->position_of(n);
+    }
+
+
+    /**
+     *  Number of all nodes and of nodes with batches.
+     */
+    inline std::size_t size () const { return this->id.size(); }
+    inline std::size_t drawable () const { return this->drawable_count; }
+
+};
+
+
+
+
+} // namespace machina
+
+#endif
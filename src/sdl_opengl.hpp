@@ -15,6 +15,20 @@
 
 
 
+/**
+ *  "M3D_NO_SDL" (headless builds, e.g. m3d_bench): no SDL/GLEW
+ *  headers, only the GL scalar types used by the m3d library
+ *  (same definitions as in "GL/gl.h" and "GL/glew.h").
+ */
+#if defined(M3D_NO_SDL)
+typedef unsigned int GLenum;
+typedef int GLint;
+typedef unsigned int GLuint;
+typedef unsigned short GLushort;
+typedef unsigned long GLulong;
+typedef float GLfloat;
+typedef double GLdouble;
+#else
 #ifdef __LINUX__
 #include <SDL2/SDL.h>
 #include <GL/glew.h>
@@ -25,6 +39,7 @@
 #include <SDL2/SDL.h>
 #include <GL/glew.h>
 #endif
+#endif
 
 
 
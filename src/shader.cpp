@@ -93,19 +93,15 @@ const std::string Shader::vs_all_attrib = GLSL(130,
 
     uniform mat4 mv_matrix;
     uniform mat4 p_matrix;
+    uniform mat3 normal_matrix;
 
     smooth out vec3 frag_normal;
     smooth out vec3 frag_position;
     smooth out vec3 frag_mv_position;
 
     vec4 mv_position = mv_matrix * vec4(vert_position, 1);
-    mat3 normal_matrix;
 
     void main (void) {
-        normal_matrix[0] = mv_matrix[0].xyz;
-        normal_matrix[1] = mv_matrix[1].xyz;
-        normal_matrix[2] = mv_matrix[2].xyz;
-
         frag_position = vert_position;
         frag_mv_position = mv_position.xyz;
         frag_normal = normalize(normal_matrix * vert_normal);
@@ -115,6 +111,46 @@ const std::string Shader::vs_all_attrib = GLSL(130,
 );
 
 
+// packed attrib vertex shader -- positions quantized (decoding
+// is folded into mv_matrix), normals octahedral-encoded
+const std::string Shader::vs_packed_attrib = GLSL(130,
+    precision highp float;
+
+    in vec3 vert_position;
+    in vec2 vert_normal;
+    in vec2 vert_uv;
+
+    uniform mat4 mv_matrix;
+    uniform mat4 p_matrix;
+    uniform mat3 normal_matrix;
+
+    smooth out vec3 frag_normal;
+    smooth out vec3 frag_position;
+    smooth out vec3 frag_mv_position;
+
+    vec4 mv_position = mv_matrix * vec4(vert_position, 1);
+
+    vec3 octahedral_decode (vec2 e) {
+        vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+        if (n.z < 0.0) {
+            n.xy = (1.0 - abs(e.yx)) * vec2(
+                e.x >= 0.0 ? 1.0 : -1.0,
+                e.y >= 0.0 ? 1.0 : -1.0
+            );
+        }
+        return normalize(n);
+    }
+
+    void main (void) {
+        frag_position = vert_position;
+        frag_mv_position = mv_position.xyz;
+        frag_normal = normalize(normal_matrix * octahedral_decode(vert_normal));
+
+        gl_Position = p_matrix * mv_position;
+    }
+);
+
+
 // all attrib fragment shader
 const std::string Shader::fs_all_attrib = GLSL(130,
     precision highp float;
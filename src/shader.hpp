@@ -69,6 +69,7 @@ public:
     static const std::string vs_basic_attribute_color;
     static const std::string fs_basic_color_in;
     static const std::string vs_all_attrib;
+    static const std::string vs_packed_attrib;
     static const std::string fs_all_attrib;
 
 